@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "timeHandling.h"
+#include "snap.h"
+#include "scheduler.h"
+#include "components.h"
+
+// Tarjan's algorithm with an explicit call stack, a recursive one would blow the C stack on
+// long road chains. Only edges of the profile's modes count. Returns the component count.
+static int strongComponents(unsigned modes, int *comp) {
+
+    int *index = malloc(sizeof(int) * (numNodes + 1));
+    int *low = malloc(sizeof(int) * (numNodes + 1));
+    int *stack = malloc(sizeof(int) * (numNodes + 1));
+    int *callNode = malloc(sizeof(int) * (numNodes + 1));
+    int *callEdge = malloc(sizeof(int) * (numNodes + 1));
+    char *onStack = calloc(numNodes + 1, 1);
+    int counter = 0, top = 0, count = 0;
+
+    for (int i = 0; i < numNodes; i++) index[i] = -1;
+
+    for (int s = 0; s < numNodes; s++) 
+    {
+        if (index[s] >= 0) continue;
+
+        int depth = 1;
+        callNode[0] = s;
+        callEdge[0] = adjStart[s];
+        index[s] = low[s] = counter++;
+        stack[top++] = s;
+        onStack[s] = 1;
+
+        while (depth > 0) 
+        {
+            int v = callNode[depth - 1];
+
+            if (callEdge[depth - 1] < adjStart[v + 1]) 
+            {
+                const Edge *e = &edges[adjList[callEdge[depth - 1]++]];
+                if (!(modes & MODE_BIT(e->mode))) continue;
+
+                int w = e->to;
+                if (index[w] < 0) 
+                {
+                    index[w] = low[w] = counter++;
+                    stack[top++] = w;
+                    onStack[w] = 1;
+                    callNode[depth] = w;
+                    callEdge[depth] = adjStart[w];
+                    depth++;
+                }
+                else if (onStack[w] && index[w] < low[v]) 
+                {
+                    low[v] = index[w];
+                }
+                continue;
+            }
+
+            if (low[v] == index[v])             // v roots a component, everything above it on the stack is in it
+            {
+                int w;
+                do 
+                {
+                    w = stack[--top];
+                    onStack[w] = 0;
+                    comp[w] = count;
+                } while (w != v);
+                count++;
+            }
+
+            depth--;
+            if (depth > 0 && low[v] < low[callNode[depth - 1]]) low[callNode[depth - 1]] = low[v];
+        }
+    }
+
+    free(index);
+    free(low);
+    free(stack);
+    free(callNode);
+    free(callEdge);
+    free(onStack);
+
+    return count;
+}
+
+static int findRoot(int *parent, int x) {
+
+    while (parent[x] != x) 
+    {
+        parent[x] = parent[parent[x]];          // path halving
+        x = parent[x];
+    }
+
+    return x;
+}
+
+// Union-find over the profile's edges, ignoring direction. Returns the component count.
+static int weakComponents(unsigned modes, int *comp) {
+
+    int *parent = malloc(sizeof(int) * (numNodes + 1));
+    for (int i = 0; i < numNodes; i++) parent[i] = i;
+
+    for (int i = 0; i < numEdges; i++) 
+    {
+        if (!(modes & MODE_BIT(edges[i].mode))) continue;
+
+        int a = findRoot(parent, edges[i].from);
+        int b = findRoot(parent, edges[i].to);
+        if (a != b) parent[a] = b;
+    }
+
+    int count = 0;
+    for (int i = 0; i < numNodes; i++) comp[i] = -1;
+
+    for (int i = 0; i < numNodes; i++) 
+    {
+        int root = findRoot(parent, i);
+        if (comp[root] < 0) comp[root] = count++;
+        comp[i] = comp[root];
+    }
+
+    free(parent);
+    return count;
+}
+
+// One task per profile, they only write their own slots
+static void profileComponents(void *arg, int p, SearchSpace *space) {
+
+    Components *c = (Components *)arg;
+    (void)space;
+
+    unsigned modes = profileModes((RouteProfile)p);
+
+    c->strong[p] = malloc(sizeof(int) * (numNodes + 1));
+    c->weak[p] = malloc(sizeof(int) * (numNodes + 1));
+    c->numStrong[p] = strongComponents(modes, c->strong[p]);
+    c->numWeak[p] = weakComponents(modes, c->weak[p]);
+    c->flags[p] = calloc(c->numStrong[p] + 1, 1);
+
+    for (int i = 0; i < numEdges; i++) 
+    {
+        if (!(modes & MODE_BIT(edges[i].mode))) continue;
+
+        int a = c->strong[p][edges[i].from];
+        int b = c->strong[p][edges[i].to];
+        if (a == b) continue;
+
+        c->flags[p][a] |= SCC_HAS_EXIT;
+        c->flags[p][b] |= SCC_HAS_ENTRY;
+    }
+
+    int *size = calloc(c->numStrong[p] + 1, sizeof(int));
+    for (int i = 0; i < numNodes; i++) size[c->strong[p][i]]++;
+    for (int k = 0; k < c->numStrong[p]; k++) 
+    {
+        if (size[k] > c->largestStrong[p]) c->largestStrong[p] = size[k];
+    }
+    free(size);
+}
+
+// Runs on g's views, after the adjacency is final
+void buildComponents(Graph *g) {
+
+    double startMs = monotonicMs();
+    Components *c = calloc(1, sizeof(Components));
+
+    runTasks(profileComponents, c, NUM_PROFILES, defaultWorkers(), NULL);
+
+    g->components = c;
+
+    printf("Components:");
+    for (int p = 0; p < NUM_PROFILES; p++) 
+    {
+        printf(" %s %d strong (largest %d nodes) / %d weak%s", getProfileName((RouteProfile)p), c->numStrong[p],
+               c->largestStrong[p], c->numWeak[p], p + 1 < NUM_PROFILES ? "," : "");
+    }
+    printf(" in %.1f ms\n", monotonicMs() - startMs);
+}
+
+void freeComponents(Graph *g) {
+
+    Components *c = g->components;
+    if (!c) return;
+
+    for (int p = 0; p < NUM_PROFILES; p++) 
+    {
+        free(c->strong[p]);
+        free(c->weak[p]);
+        free(c->flags[p]);
+    }
+
+    free(c);
+    g->components = NULL;
+}
+
+// 0 only when no route of the profile can lead from one node to the other: different weak
+// components, or a strong component nothing leaves or nothing enters. 1 means search.
+int mayReachNode(RouteProfile profile, int from, int to) {
+
+    const Components *c = activeGraph ? activeGraph->components : NULL;
+    if (!c || from == to) return 1;
+
+    if (c->weak[profile][from] != c->weak[profile][to]) return 0;
+
+    int a = c->strong[profile][from];
+    int b = c->strong[profile][to];
+    if (a == b) return 1;
+
+    return (c->flags[profile][a] & SCC_HAS_EXIT) && (c->flags[profile][b] & SCC_HAS_ENTRY);
+}
+
+// Some way onto the network has to be able to reach some way off it
+int mayReach(RouteProfile profile, const SnapPoint *from, const SnapPoint *to) {
+
+    SnapArc direct;
+    double directStart;
+
+    if (snapDirectRide(from, to, &direct, &directStart)) return 1;
+
+    for (int a = 0; a < from->numArcs; a++) 
+    {
+        for (int b = 0; b < to->numArcs; b++) 
+        {
+            if (mayReachNode(profile, from->arcs[a].node, to->arcs[b].node)) return 1;
+        }
+    }
+
+    return 0;
+}
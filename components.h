@@ -0,0 +1,29 @@
+#ifndef components_H
+#define components_H
+
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "snap.h"
+
+#define SCC_HAS_EXIT 1          // some profile edge leaves the component
+#define SCC_HAS_ENTRY 2         // some profile edge enters it
+
+// Connectivity of each routing profile, built once per graph version. Weak components
+// split the map into pieces no route crosses; strong ones catch the one-way pockets a
+// route can enter and never leave, or leave and never enter.
+typedef struct Components 
+{
+    int *strong[NUM_PROFILES];              // node -> strongly connected component
+    int *weak[NUM_PROFILES];                // node -> weakly connected component
+    unsigned char *flags[NUM_PROFILES];     // strong component -> SCC_HAS_EXIT | SCC_HAS_ENTRY
+    int numStrong[NUM_PROFILES];
+    int numWeak[NUM_PROFILES];
+    int largestStrong[NUM_PROFILES];        // nodes in the biggest strong component
+} Components;
+
+void buildComponents(Graph *g);
+void freeComponents(Graph *g);
+int mayReachNode(RouteProfile profile, int from, int to);
+int mayReach(RouteProfile profile, const SnapPoint *from, const SnapPoint *to);
+
+#endif
@@ -50,14 +50,15 @@ int is_number_token(const char *s) {
     return end && *end == '\0';
 }
 
-void parseRoadmapCSV(const char *filename) {
+// Each parser returns the rows it took, -1 when the file cannot be opened
+int parseRoadmapCSV(const char *filename) {
 
     FILE *f = fopen(filename, "r");
 
     if (!f) 
     { 
         printf("Error opening %s\n", filename); 
-        return; 
+        return -1; 
     }
 
     char line[MAX_LINE];
@@ -101,16 +102,17 @@ void parseRoadmapCSV(const char *filename) {
     }
 
     fclose(f);          // Close the file (^-^)
+    return roadCount;
 }
 
-void parseMetroCSV(const char *filename) {
+int parseMetroCSV(const char *filename) {
 
     FILE *f = fopen(filename, "r");
 
     if (!f) 
     { 
         printf("Error opening %s\n", filename); 
-        return; 
+        return -1; 
     }
 
     char line[MAX_LINE];
@@ -175,13 +177,14 @@ void parseMetroCSV(const char *filename) {
     }
 
     fclose(f);              // We close the file again
+    return routeCount;
 }
 
-void parseBusCSV(const char *filename, Mode busMode) {
+int parseBusCSV(const char *filename, Mode busMode) {
     FILE *f = fopen(filename, "r");
     if (!f) { 
         printf("Error opening %s\n", filename); 
-        return; 
+        return -1; 
     }
 
     char line[MAX_LINE];
@@ -246,36 +249,5 @@ void parseBusCSV(const char *filename, Mode busMode) {
     }
 
     fclose(f);
+    return routeCount;
 }
-
-void exportPathToKML(int path[], int pathLen, const char *filename) {
-
-    FILE *f = fopen(filename, "w");
-    if (!f) { 
-        printf("Failed to open %s\n", filename); 
-        return; 
-    }
-
-    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-    fprintf(f, "<kml xmlns=\"http://earth.google.com/kml/2.1\">\n");
-    fprintf(f, "<Document>\n");
-    fprintf(f, "<Placemark>\n");
-    fprintf(f, "<name>Route</name>\n");
-    fprintf(f, "<LineString>\n");
-    fprintf(f, "<tessellate>1</tessellate>\n");
-    fprintf(f, "<coordinates>\n");
-
-    for (int i = pathLen - 1; i >= 0; i--) {
-        int nodeId = path[i];
-        fprintf(f, "%.6f,%.6f,0\n", nodes[nodeId].lon, nodes[nodeId].lat);          // So that we dont accidently do rooftop parkour
-    }
-
-    fprintf(f, "</coordinates>\n");
-    fprintf(f, "</LineString>\n");
-    fprintf(f, "</Placemark>\n");
-    fprintf(f, "</Document>\n");
-    fprintf(f, "</kml>\n");
-    fclose(f);              // Yet again the file is closed
-
-    printf("Exported path to %s\n", filename);
-}
\ No newline at end of file
@@ -10,9 +10,8 @@
 void trim_in_place(char *s);
 int split_csv(char *line, char **tokens, int maxTokens);
 int is_number_token(const char *s);
-void parseRoadmapCSV(const char *filename);
-void parseMetroCSV(const char *filename);
-void parseBusCSV(const char *filename, Mode busMode);
-void exportPathToKML(int path[], int pathLen, const char *filename);
+int parseRoadmapCSV(const char *filename);
+int parseMetroCSV(const char *filename);
+int parseBusCSV(const char *filename, Mode busMode);
 
 #endif
\ No newline at end of file
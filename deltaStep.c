@@ -0,0 +1,383 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "timeHandling.h"
+#include "search.h"
+#include "snap.h"
+#include "deltaStep.h"
+
+// Delta-stepping (Meyer & Sanders): nodes wait in buckets of width delta and a whole bucket
+// is expanded at once, light edges first until the bucket stays empty, then the heavy ones.
+// Every thread owns its buckets and only ever appends to its own, so the only shared writes
+// are the distance updates, which go through a compare-and-swap.
+
+typedef struct 
+{
+    int *items;
+    int count;
+    int capacity;
+} NodeList;
+
+typedef struct 
+{
+    NodeList *buckets;          // bucket b holds nodes queued at a distance in [b*delta, (b+1)*delta)
+    int numBuckets;
+    NodeList settled;           // expanded in the current bucket, their heavy edges go last
+    QueryStats stats;
+} DeltaWorker;
+
+typedef struct 
+{
+    const Edge *edges;          // the caller's views, it keeps the graph pinned until we return
+    const int *carStart;
+    const int *carList;
+    const TrafficSnapshot *traffic;
+    double delta;
+    int numThreads;
+    double *dist;
+    double *expanded;           // distance a node's light edges were last scanned at
+    DeltaWorker *workers;
+    int *frontier;              // the current bucket gathered from every worker
+    int frontierSize;
+    int frontierCapacity;
+    int *offsets;
+    int nextChunk;
+    int bucket;                 // -1 once every bucket is empty
+    pthread_barrier_t barrier;
+} DeltaJob;
+
+// Helper threads outlive the tree they were started for: workers 1.. of every later tree,
+// so a batch of trees pays for thread creation once. One tree uses the pool at a time.
+typedef struct 
+{
+    pthread_mutex_t useLock;        // held by the tree running on the pool
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int numHelpers;
+    int capped;                     // thread creation failed once, the pool stays as it is
+    int generation;                 // bumped for every tree
+    DeltaJob *job;
+    int numThreads;                 // of the current tree, helpers past it sit it out
+    int running;                    // helpers not yet done with the current tree
+} DeltaPool;
+
+typedef struct 
+{
+    int t;
+    int generation;                 // the last tree it is not part of
+} HelperArg;
+
+static DeltaPool pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                          PTHREAD_COND_INITIALIZER, 0, 0, 0, NULL, 0, 0 };
+
+static void listPush(NodeList *list, int v) {
+
+    if (list->count == list->capacity) 
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = realloc(list->items, sizeof(int) * list->capacity);
+    }
+
+    list->items[list->count++] = v;
+}
+
+static void queueNode(DeltaJob *job, DeltaWorker *w, int v, double d) {
+
+    int b = (int)(d / job->delta);
+
+    if (b >= w->numBuckets) 
+    {
+        int grown = w->numBuckets ? w->numBuckets : 64;
+        while (grown <= b) grown *= 2;
+        w->buckets = realloc(w->buckets, sizeof(NodeList) * grown);
+        memset(w->buckets + w->numBuckets, 0, sizeof(NodeList) * (grown - w->numBuckets));
+        w->numBuckets = grown;
+    }
+
+    listPush(&w->buckets[b], v);
+}
+
+static inline double loadDist(const double *slot) {
+
+    double d;
+    __atomic_load(slot, &d, __ATOMIC_RELAXED);
+    return d;
+}
+
+// *slot = min(*slot, d); true when d won
+static inline int lowerDist(double *slot, double d) {
+
+    double seen = loadDist(slot);
+
+    while (d < seen) 
+    {
+        if (__atomic_compare_exchange(slot, &seen, &d, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return 1;
+    }
+
+    return 0;
+}
+
+// Relaxes u's light (heavy == 0) or heavy edges from distance du
+static void relaxEdges(DeltaJob *job, DeltaWorker *w, int u, double du, int heavy) {
+
+    for (int k = job->carStart[u]; k < job->carStart[u + 1]; k++) 
+    {
+        int i = job->carList[k];
+        double weight = job->edges[i].distance;
+
+        if ((weight > job->delta) != heavy) continue;
+        STAT_INC(&w->stats, edgesScanned);
+        if (isEdgeClosed(job->traffic, i)) continue;
+
+        int v = job->edges[i].to;
+        if (lowerDist(&job->dist[v], du + weight)) 
+        {
+            queueNode(job, w, v, du + weight);
+            STAT_INC(&w->stats, edgesRelaxed);
+        }
+    }
+}
+
+// Thread 0 only, between barriers: the lowest bucket any worker still has nodes in
+static int nextBucket(DeltaJob *job, int from) {
+
+    int best = -1;
+
+    for (int t = 0; t < job->numThreads; t++) 
+    {
+        DeltaWorker *w = &job->workers[t];
+        int limit = best >= 0 && best < w->numBuckets ? best : w->numBuckets;
+
+        for (int b = from; b < limit; b++) 
+        {
+            if (w->buckets[b].count == 0) continue;
+            best = b;
+            break;
+        }
+    }
+
+    return best;
+}
+
+// Thread 0 only: lays the workers' share of the bucket out in one array
+static void gatherOffsets(DeltaJob *job, int b) {
+
+    int total = 0;
+
+    for (int t = 0; t < job->numThreads; t++) 
+    {
+        job->offsets[t] = total;
+        if (b < job->workers[t].numBuckets) total += job->workers[t].buckets[b].count;
+    }
+
+    if (total > job->frontierCapacity) 
+    {
+        job->frontierCapacity = total * 2;
+        job->frontier = realloc(job->frontier, sizeof(int) * job->frontierCapacity);
+    }
+
+    job->frontierSize = total;
+    job->nextChunk = 0;
+}
+
+static void runWorker(DeltaJob *job, int t) {
+
+    DeltaWorker *w = &job->workers[t];
+    double delta = job->delta;
+    int b = 0;
+
+    while (1) 
+    {
+        pthread_barrier_wait(&job->barrier);            // heavy relaxations are all in
+        if (t == 0) job->bucket = nextBucket(job, b);
+        pthread_barrier_wait(&job->barrier);
+
+        b = job->bucket;
+        if (b < 0) break;
+        w->settled.count = 0;
+
+        while (1)                                       // light phases until the bucket stays empty
+        {
+            if (t == 0) gatherOffsets(job, b);
+            pthread_barrier_wait(&job->barrier);
+
+            if (b < w->numBuckets && w->buckets[b].count > 0) 
+            {
+                NodeList *mine = &w->buckets[b];
+                memcpy(job->frontier + job->offsets[t], mine->items, sizeof(int) * mine->count);
+                mine->count = 0;
+            }
+            pthread_barrier_wait(&job->barrier);
+
+            int size = job->frontierSize;
+            if (size == 0) break;
+
+            int start;
+            while ((start = __atomic_fetch_add(&job->nextChunk, DELTA_STEP_CHUNK, __ATOMIC_RELAXED)) < size) 
+            {
+                int end = start + DELTA_STEP_CHUNK < size ? start + DELTA_STEP_CHUNK : size;
+
+                for (int f = start; f < end; f++) 
+                {
+                    int u = job->frontier[f];
+                    double du = loadDist(&job->dist[u]);
+                    if ((int)(du / delta) != b) continue;                // queued before it got closer
+
+                    double before = loadDist(&job->expanded[u]);
+                    if (du >= before) continue;                          // a copy already did it
+                    __atomic_store(&job->expanded[u], &du, __ATOMIC_RELAXED);
+
+                    if (before >= (b + 1) * delta) 
+                    {
+                        listPush(&w->settled, u);
+                        STAT_INC(&w->stats, nodesSettled);
+                    }
+                    relaxEdges(job, w, u, du, 0);
+                }
+            }
+
+            pthread_barrier_wait(&job->barrier);        // nobody gathers while others still relax
+        }
+
+        for (int s = 0; s < w->settled.count; s++) 
+        {
+            int u = w->settled.items[s];
+            relaxEdges(job, w, u, loadDist(&job->dist[u]), 1);
+        }
+    }
+}
+
+static void *helperThread(void *arg) {
+
+    HelperArg a = *(HelperArg *)arg;
+    free(arg);
+
+    pthread_mutex_lock(&pool.lock);
+
+    while (1) 
+    {
+        while (pool.generation == a.generation) pthread_cond_wait(&pool.wake, &pool.lock);
+        a.generation = pool.generation;
+        if (a.t >= pool.numThreads) continue;
+
+        DeltaJob *job = pool.job;
+        pthread_mutex_unlock(&pool.lock);
+
+        runWorker(job, a.t);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.running == 0) pthread_cond_signal(&pool.done);
+    }
+
+    return NULL;
+}
+
+// Starts helpers until the pool has wanted of them or thread creation fails, and returns
+// how many there are. Caller holds useLock.
+static int growPool(int wanted) {
+
+    while (!pool.capped && pool.numHelpers < wanted) 
+    {
+        HelperArg *arg = malloc(sizeof(HelperArg));
+        arg->t = pool.numHelpers + 1;
+        arg->generation = pool.generation;
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, helperThread, arg) != 0) 
+        {
+            free(arg);
+            pool.capped = 1;
+            printf("Delta-stepping: only %d of %d threads could be started\n", pool.numHelpers + 1, wanted + 1);
+            break;
+        }
+
+        pthread_detach(thread);
+        pool.numHelpers++;
+    }
+
+    return pool.numHelpers;
+}
+
+// Car distance from a snapped point to every node, closures honoured, the same tree as
+// dijkstraTree. The caller's thread is worker 0, the rest come from the pool; when fewer
+// threads can be started the tree runs on those there are.
+void deltaStepTree(SearchSpace *space, const SnapPoint *from, double delta, int numThreads, double dist[]) {
+
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+
+    if (numThreads < 1) numThreads = 1;
+    if (delta <= 0.0) delta = DELTA_STEP_KM;
+
+    pthread_mutex_lock(&pool.useLock);
+    int helpers = numThreads > 1 ? growPool(numThreads - 1) : 0;
+    if (numThreads > helpers + 1) numThreads = helpers + 1;
+
+    DeltaJob job;
+    memset(&job, 0, sizeof(job));
+    job.edges = edges;
+    job.carStart = profileAdjStart[PROFILE_CAR];
+    job.carList = profileAdjList[PROFILE_CAR];
+    job.traffic = space->traffic;
+    job.delta = delta;
+    job.numThreads = numThreads;
+    job.dist = dist;
+    job.expanded = malloc(sizeof(double) * (numNodes + 1));
+    job.workers = calloc(numThreads, sizeof(DeltaWorker));
+    job.offsets = malloc(sizeof(int) * numThreads);
+    pthread_barrier_init(&job.barrier, NULL, numThreads);
+
+    for (int v = 0; v < numNodes; v++) 
+    {
+        dist[v] = INF;
+        job.expanded[v] = INF;
+    }
+
+    for (int a = 0; a < from->numArcs; a++) 
+    {
+        const SnapArc *arc = &from->arcs[a];
+        if (isArcClosed(space->traffic, arc)) continue;
+        if (lowerDist(&dist[arc->node], arcDistance(arc))) queueNode(&job, &job.workers[0], arc->node, arcDistance(arc));
+    }
+
+    if (numThreads > 1) 
+    {
+        pthread_mutex_lock(&pool.lock);
+        pool.job = &job;
+        pool.numThreads = numThreads;
+        pool.running = numThreads - 1;
+        pool.generation++;
+        pthread_cond_broadcast(&pool.wake);
+        pthread_mutex_unlock(&pool.lock);
+    }
+
+    runWorker(&job, 0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.running > 0) pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.useLock);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        DeltaWorker *w = &job.workers[t];
+        for (int b = 0; b < w->numBuckets; b++) free(w->buckets[b].items);
+        free(w->buckets);
+        free(w->settled.items);
+        addQueryStats(&space->stats, &w->stats);
+    }
+
+    pthread_barrier_destroy(&job.barrier);
+    free(job.workers);
+    free(job.offsets);
+    free(job.frontier);
+    free(job.expanded);
+
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+}
@@ -0,0 +1,12 @@
+#ifndef deltaStep_H
+#define deltaStep_H
+
+#include "search.h"
+#include "snap.h"
+
+#define DELTA_STEP_KM 0.5           // bucket width; edges up to this long are light
+#define DELTA_STEP_CHUNK 64         // frontier nodes a thread takes at a time
+
+void deltaStepTree(SearchSpace *space, const SnapPoint *from, double delta, int numThreads, double dist[]);
+
+#endif
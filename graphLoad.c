@@ -0,0 +1,379 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "csvParse.h"
+#include "graphSimplify.h"
+#include "walkTransfers.h"
+#include "speedProfile.h"
+#include "timeHandling.h"
+#include "timetable.h"
+#include "traffic.h"
+#include "snap.h"
+#include "components.h"
+#include "modeProfile.h"
+#include "hierarchy.h"
+#include "overlay.h"
+#include "graphLoad.h"
+#include "trace.h"
+
+#define NUM_INPUT_FILES 7
+
+static const char *inputFiles[NUM_INPUT_FILES] = {
+    "Roadmap-Dhaka.csv", "Routemap-DhakaMetroRail.csv", "Routemap-BikolpoBus.csv", "Routemap-UttaraBus.csv",
+    "SpeedProfile-Dhaka.csv", "Schedule-Dhaka.csv", "ModeProfiles-Dhaka.csv"
+};
+
+// The GTFS feed directory. Like the CSVs above it resolves against the working directory,
+// so run from the repo root or point ROUTE_GTFS at the feed
+static const char *timetableFeedDir() {
+
+    const char *dir = getenv("ROUTE_GTFS");
+    return (dir && dir[0]) ? dir : "GTFS-Dhaka";
+}
+
+static Graph *currentGraph = NULL;
+static Graph *retiredGraphs = NULL;
+static int nextGraphId = 1;
+static __thread Graph *pinnedGraph = NULL;
+static pthread_mutex_t graphLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t reloadLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Parsers append without bounds checks, so a build starts at full capacity; the pages
+// are only committed as they are written and trimGraph hands back the slack.
+static Graph *allocGraph() {
+
+    Graph *g = calloc(1, sizeof(Graph));
+    g->nodes = malloc(sizeof(Node) * MAX_NODES);
+    g->edges = malloc(sizeof(Edge) * MAX_NODES * 10);
+    g->shapePoints = malloc(sizeof(ShapePoint) * MAX_SHAPE_POINTS);
+    g->adjStart = malloc(sizeof(int) * (MAX_NODES + 1));
+    g->adjList = malloc(sizeof(int) * MAX_NODES * 10);
+    g->edgeProfile = calloc(MAX_NODES * 10, 1);
+    g->speedProfiles = calloc(MAX_SPEED_PROFILES, sizeof(SpeedProfile));
+
+    return g;
+}
+
+static void trimGraph(Graph *g) {
+
+    g->nodes = realloc(g->nodes, sizeof(Node) * (g->numNodes + 1));
+    g->edges = realloc(g->edges, sizeof(Edge) * (g->numEdges + 1));
+    g->shapePoints = realloc(g->shapePoints, sizeof(ShapePoint) * (g->numShapePoints + 1));
+    g->adjStart = realloc(g->adjStart, sizeof(int) * (g->numNodes + 1));
+    g->adjList = realloc(g->adjList, sizeof(int) * (g->numEdges + 1));
+    g->edgeProfile = realloc(g->edgeProfile, g->numEdges + 1);
+}
+
+static void freeGraph(Graph *g) {
+
+    releaseGraphTraffic(g);
+    freeTimetables(g);
+    freeSnapIndex(g);
+    freeComponents(g);
+    freeProfileViews(g);
+    freeModeProfiles(g);
+    freeHierarchy(g);
+    freeOverlay(g);
+    free(g->nodes);
+    free(g->edges);
+    free(g->shapePoints);
+    free(g->adjStart);
+    free(g->adjList);
+    free(g->edgeProfile);
+    free(g->speedProfiles);
+    free(g);
+}
+
+// Caller holds graphLock
+static void reclaimGraphs() {
+
+    Graph **link = &retiredGraphs;
+
+    while (*link) 
+    {
+        Graph *g = *link;
+        if (g->refs == 0) 
+        {
+            *link = g->retiredNext;
+            freeGraph(g);
+        }
+        else 
+        {
+            link = &g->retiredNext;
+        }
+    }
+}
+
+// Everything between the CSV files and a routable graph. Runs on the calling thread's
+// views and puts back whatever that thread had pinned when it is done. NULL when an
+// input is missing or came out empty, nothing half-built gets out.
+Graph *buildGraph() {
+
+    Graph *previous = activeGraph;
+    Graph *g = allocGraph();
+    useGraph(g);
+
+    TRACE_BEGIN("loadGraph", "ingest");
+
+    TRACE_BEGIN("parseRoadmapCSV", "ingest");
+    int roads = parseRoadmapCSV("Roadmap-Dhaka.csv");
+    TRACE_END("parseRoadmapCSV", "ingest");
+
+    TRACE_BEGIN("parseMetroCSV", "ingest");
+    int metro = parseMetroCSV("Routemap-DhakaMetroRail.csv");
+    TRACE_END("parseMetroCSV", "ingest");
+
+    TRACE_BEGIN("parseBusCSV bikolpo", "ingest");
+    int bikolpo = parseBusCSV("Routemap-BikolpoBus.csv", MODE_BIKOLPO);
+    TRACE_END("parseBusCSV bikolpo", "ingest");
+
+    TRACE_BEGIN("parseBusCSV uttara", "ingest");
+    int uttara = parseBusCSV("Routemap-UttaraBus.csv", MODE_UTTARA);
+    TRACE_END("parseBusCSV uttara", "ingest");
+
+    int schedules = loadSchedules(g, "Schedule-Dhaka.csv");
+    const char *broken = NULL;
+
+    if (roads <= 0) broken = "Roadmap-Dhaka.csv has no roads";
+    else if (metro <= 0) broken = "Routemap-DhakaMetroRail.csv has no routes";
+    else if (bikolpo <= 0) broken = "Routemap-BikolpoBus.csv has no routes";
+    else if (uttara <= 0) broken = "Routemap-UttaraBus.csv has no routes";
+    else if (schedules <= 0) broken = "Schedule-Dhaka.csv has no schedule rows";
+    else if (numNodes == 0 || numEdges == 0) broken = "the graph came out empty";
+
+    if (broken) 
+    {
+        printf("Graph build failed: %s\n", broken);
+        TRACE_END("loadGraph", "ingest");
+        useGraph(previous);
+        freeGraph(g);
+        return NULL;
+    }
+
+    TRACE_BEGIN("simplifyGraph", "ingest");
+    simplifyGraph();
+    TRACE_END("simplifyGraph", "ingest");
+
+    TRACE_BEGIN("buildWalkTransfers", "ingest");
+    buildWalkTransfers();
+    TRACE_END("buildWalkTransfers", "ingest");
+
+    TRACE_BEGIN("loadSpeedProfiles", "ingest");
+    int profiled = loadSpeedProfiles("SpeedProfile-Dhaka.csv");
+    if (profiled >= 0) printf("Speed profiles: %d loaded, %d edges time-dependent\n", numSpeedProfiles - 1, profiled);
+    TRACE_END("loadSpeedProfiles", "ingest");
+
+    TRACE_BEGIN("buildAdjacency", "ingest");
+    buildAdjacency();
+    TRACE_END("buildAdjacency", "ingest");
+
+    TRACE_BEGIN("loadTimetables", "ingest");
+    loadTimetables(g, timetableFeedDir());
+    TRACE_END("loadTimetables", "ingest");
+
+    TRACE_END("loadGraph", "ingest");
+
+    saveGraphCounts(g);
+    trimGraph(g);
+    useGraph(g);                // trimming moved the arrays
+
+    TRACE_BEGIN("buildProfileViews", "ingest");
+    buildProfileViews(g);
+    useGraph(g);                // pick the views up
+    TRACE_END("buildProfileViews", "ingest");
+
+    TRACE_BEGIN("loadModeProfiles", "ingest");
+    loadModeProfiles(g, "ModeProfiles-Dhaka.csv");
+    TRACE_END("loadModeProfiles", "ingest");
+
+    TRACE_BEGIN("buildSnapIndex", "ingest");
+    buildSnapIndex(g);
+    TRACE_END("buildSnapIndex", "ingest");
+
+    TRACE_BEGIN("buildComponents", "ingest");
+    buildComponents(g);
+    TRACE_END("buildComponents", "ingest");
+
+    if (overlayEnabled())           // partitioned here, not on the first car query
+    {
+        TRACE_BEGIN("carOverlay", "ingest");
+        carOverlay();
+        TRACE_END("carOverlay", "ingest");
+    }
+
+    useGraph(previous);
+
+    return g;
+}
+
+// Swaps g in as the version new queries pin; the old one goes once its last reader leaves
+void publishGraph(Graph *g) {
+
+    pthread_mutex_lock(&graphLock);
+
+    g->id = nextGraphId++;
+    Graph *old = currentGraph;
+    __atomic_store_n(&currentGraph, g, __ATOMIC_RELEASE);
+
+    if (old) 
+    {
+        old->retiredNext = retiredGraphs;
+        retiredGraphs = old;
+    }
+    reclaimGraphs();
+
+    pthread_mutex_unlock(&graphLock);
+
+    __atomic_fetch_add(&graphVersion, 1, __ATOMIC_RELEASE);        // nothing cached before this is valid for g
+}
+
+// Pins g, or the newest version when g is NULL, on this thread and points its views at
+// it. Whatever the thread had pinned before is let go. Re-pinning the same one is cheap.
+Graph *pinGraph(Graph *g) {
+
+    if ((g ? g : __atomic_load_n(&currentGraph, __ATOMIC_ACQUIRE)) == pinnedGraph) return pinnedGraph;
+
+    pthread_mutex_lock(&graphLock);
+
+    if (!g) g = currentGraph;               // read again under the lock, it cannot be freed from here on
+    g->refs++;
+    if (pinnedGraph) 
+    {
+        pinnedGraph->refs--;
+        reclaimGraphs();
+    }
+
+    pthread_mutex_unlock(&graphLock);
+
+    pinnedGraph = g;
+    useGraph(g);
+    return g;
+}
+
+void unpinGraph() {
+
+    if (!pinnedGraph) return;
+
+    pthread_mutex_lock(&graphLock);
+    pinnedGraph->refs--;
+    reclaimGraphs();
+    pthread_mutex_unlock(&graphLock);
+
+    pinnedGraph = NULL;
+    useGraph(NULL);
+}
+
+// Whether the calling thread holds a version, so a helper that pins one can tell if the
+// pin is its own to drop
+int isGraphPinned() {
+
+    return pinnedGraph != NULL;
+}
+
+// First version, published and pinned on the calling thread. Shared by main and the tools.
+void loadGraph() {
+
+    traceInit();
+
+    Graph *g = buildGraph();
+    if (!g) exit(1);              // nothing to serve yet
+
+    publishGraph(g);
+    pinGraph(NULL);
+}
+
+// Builds and publishes a new version from the current files. Queries keep running on
+// the old one meanwhile. Returns the new graph id, 0 if a reload was already running, or
+// -1 when the files did not make a usable graph and the current version stays.
+int reloadGraph() {
+
+    if (pthread_mutex_trylock(&reloadLock) != 0) return 0;
+
+    double startMs = monotonicMs();
+    Graph *g = buildGraph();
+    Graph *current = __atomic_load_n(&currentGraph, __ATOMIC_ACQUIRE);
+
+    if (g && current && g->numEdges < current->numEdges / 2)        // a file caught mid-write parses short
+    {
+        printf("Graph build failed: %d edges against %d in version %d, input looks truncated\n", g->numEdges,
+               current->numEdges, current->id);
+        freeGraph(g);             // never published, nobody can have it pinned
+        g = NULL;
+    }
+
+    if (!g) 
+    {
+        printf("Graph reload skipped, still serving version %d\n", current ? current->id : 0);
+        fflush(stdout);
+        pthread_mutex_unlock(&reloadLock);
+        return -1;
+    }
+
+    publishGraph(g);
+
+    printf("Graph reloaded: version %d, %d nodes, %d edges in %.0f ms\n", g->id, g->numNodes, g->numEdges,
+           monotonicMs() - startMs);
+    fflush(stdout);
+
+    pthread_mutex_unlock(&reloadLock);
+    return g->id;
+}
+
+static time_t newestInputMtime() {
+
+    struct stat st;
+    time_t newest = 0;
+
+    for (int i = 0; i < NUM_INPUT_FILES; i++) 
+    {
+        if (stat(inputFiles[i], &st) == 0 && st.st_mtime > newest) newest = st.st_mtime;
+    }
+
+    char feedFile[512];
+    snprintf(feedFile, sizeof(feedFile), "%s/stop_times.txt", timetableFeedDir());
+    if (stat(feedFile, &st) == 0 && st.st_mtime > newest) newest = st.st_mtime;
+
+    return newest;
+}
+
+static void *graphWatcher(void *arg) {
+
+    int intervalMs = *(int *)arg;
+    time_t seen = newestInputMtime();
+    free(arg);
+
+    while (1) 
+    {
+        usleep(intervalMs * 1000);
+
+        time_t newest = newestInputMtime();
+        if (newest == seen) continue;
+
+        usleep(intervalMs * 1000);              // let an editor or a copy finish writing
+        seen = newestInputMtime();
+        reloadGraph();
+    }
+
+    return NULL;
+}
+
+// Rebuilds whenever one of the input files changes, schedules included
+int startGraphWatcher(int intervalMs) {
+
+    int *arg = malloc(sizeof(int));
+    *arg = intervalMs > 0 ? intervalMs : 2000;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, graphWatcher, arg) != 0) 
+    {
+        free(arg);
+        return -1;
+    }
+
+    pthread_detach(thread);
+    return 0;
+}
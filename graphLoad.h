@@ -0,0 +1,19 @@
+#ifndef graphLoad_H
+#define graphLoad_H
+
+#include "nodesAndEdges.h"
+
+// Graph versions are built off to the side and published with a pointer swap. Queries
+// pin the version they start on and old versions are freed once nobody has them pinned,
+// so a reload never stalls or disturbs a running query (RCU with reference counts).
+
+void loadGraph();
+Graph *buildGraph();
+void publishGraph(Graph *g);
+Graph *pinGraph(Graph *g);
+void unpinGraph();
+int isGraphPinned();
+int reloadGraph();
+int startGraphWatcher(int intervalMs);
+
+#endif
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "graphSimplify.h"
+
+static int compareEdges(const void *a, const void *b) {
+
+    const Edge *x = (const Edge *)a;
+    const Edge *y = (const Edge *)b;
+
+    if (x->from != y->from) return x->from < y->from ? -1 : 1;
+    if (x->to != y->to) return x->to < y->to ? -1 : 1;
+    if (x->mode != y->mode) return x->mode < y->mode ? -1 : 1;
+    if (x->distance != y->distance) return x->distance < y->distance ? -1 : 1;
+    return 0;
+}
+
+int dedupeEdges(Edge list[], int count) {
+
+    qsort(list, count, sizeof(Edge), compareEdges);         // shortest copy of each (from, to, mode) comes first
+
+    int kept = 0;
+    for (int i = 0; i < count; i++) 
+    {
+        if (list[i].from == list[i].to) continue;           // the bus files repeat every point, so these are zero length loops
+
+        if (kept > 0 && list[kept - 1].from == list[i].from && list[kept - 1].to == list[i].to &&
+            list[kept - 1].mode == list[i].mode) continue;
+
+        list[kept++] = list[i];
+    }
+
+    return kept;
+}
+
+static void buildIncidence(int *start, int *list, int useFrom) {
+
+    for (int i = 0; i <= numNodes; i++) start[i] = 0;
+    for (int i = 0; i < numEdges; i++) start[(useFrom ? edges[i].from : edges[i].to) + 1]++;
+    for (int i = 0; i < numNodes; i++) start[i + 1] += start[i];
+
+    int *fill = malloc(sizeof(int) * numNodes);
+    memcpy(fill, start, sizeof(int) * numNodes);
+
+    for (int i = 0; i < numEdges; i++) list[fill[useFrom ? edges[i].from : edges[i].to]++] = i;
+
+    free(fill);
+}
+
+// A node can disappear when it has no station name, one mode, and is a plain pass-through:
+// either a two-way segment between two distinct neighbours or a one-way in/out pair.
+static int isChainInterior(int v, const int *outStart, const int *outList, const int *inStart, const int *inList) {
+
+    int outDeg = outStart[v + 1] - outStart[v];
+    int inDeg = inStart[v + 1] - inStart[v];
+
+    if (outDeg == 0 || inDeg == 0 || outDeg != inDeg || outDeg > 2) return 0;
+    if (isNamedStation(v)) return 0;
+
+    Mode mode = edges[outList[outStart[v]]].mode;
+
+    for (int k = outStart[v]; k < outStart[v + 1]; k++) if (edges[outList[k]].mode != mode) return 0;
+    for (int k = inStart[v]; k < inStart[v + 1]; k++) if (edges[inList[k]].mode != mode) return 0;
+
+    if (outDeg == 1) 
+    {
+        return edges[inList[inStart[v]]].from != edges[outList[outStart[v]]].to;
+    }
+
+    int b1 = edges[outList[outStart[v]]].to;
+    int b2 = edges[outList[outStart[v] + 1]].to;
+    int a1 = edges[inList[inStart[v]]].from;
+    int a2 = edges[inList[inStart[v] + 1]].from;
+
+    if (b1 == b2 || a1 == a2) return 0;
+
+    return (a1 == b1 && a2 == b2) || (a1 == b2 && a2 == b1);
+}
+
+static void appendShape(ShapePoint *shape, int *shapeLen, double lat, double lon) {
+
+    shape[*shapeLen].lat = lat;
+    shape[*shapeLen].lon = lon;
+    (*shapeLen)++;
+}
+
+// Walks one chain starting with edge e out of a kept node and emits the merged edge
+static void emitChain(int e, const int *interior, const int *outStart, const int *outList, int *used,
+                      Edge *newEdges, int *newCount, ShapePoint *shape, int *shapeLen) {
+
+    int from = edges[e].from;
+    int prevNode = from;
+    int cur = edges[e].to;
+    double distance = edges[e].distance;
+    int shapeBegin = *shapeLen;
+
+    used[e] = 1;
+    for (int s = 0; s < edges[e].shapeCount; s++)
+        appendShape(shape, shapeLen, shapePoints[edges[e].shapeStart + s].lat, shapePoints[edges[e].shapeStart + s].lon);
+
+    while (interior[cur]) 
+    {
+        appendShape(shape, shapeLen, nodes[cur].lat, nodes[cur].lon);
+
+        int next = outList[outStart[cur]];
+        if (outStart[cur + 1] - outStart[cur] == 2 && edges[next].to == prevNode) next = outList[outStart[cur] + 1];
+
+        used[next] = 1;
+        distance += edges[next].distance;
+        for (int s = 0; s < edges[next].shapeCount; s++)
+            appendShape(shape, shapeLen, shapePoints[edges[next].shapeStart + s].lat, shapePoints[edges[next].shapeStart + s].lon);
+
+        prevNode = cur;
+        cur = edges[next].to;
+    }
+
+    if (cur == from)            // loop back onto itself, never useful for a shortest path
+    {
+        *shapeLen = shapeBegin;
+        return;
+    }
+
+    Edge *out = &newEdges[(*newCount)++];
+    *out = edges[e];
+    out->to = cur;
+    out->distance = distance;
+    out->shapeStart = shapeBegin;
+    out->shapeCount = *shapeLen - shapeBegin;
+}
+
+static void emitChainsFrom(int u, const int *interior, const int *outStart, const int *outList, int *used,
+                           Edge *newEdges, int *newCount, ShapePoint *shape, int *shapeLen) {
+
+    for (int k = outStart[u]; k < outStart[u + 1]; k++) 
+    {
+        if (!used[outList[k]]) emitChain(outList[k], interior, outStart, outList, used, newEdges, newCount, shape, shapeLen);
+    }
+}
+
+void simplifyGraph() {
+
+    int oldNodes = numNodes;
+    int oldEdges = numEdges;
+
+    numEdges = dedupeEdges(edges, numEdges);
+
+    int *outStart = malloc(sizeof(int) * (numNodes + 1));
+    int *inStart = malloc(sizeof(int) * (numNodes + 1));
+    int *outList = malloc(sizeof(int) * (numEdges + 1));
+    int *inList = malloc(sizeof(int) * (numEdges + 1));
+    int *interior = malloc(sizeof(int) * (numNodes + 1));
+    int *used = calloc(numEdges + 1, sizeof(int));
+    int *newId = malloc(sizeof(int) * (numNodes + 1));
+    Edge *newEdges = malloc(sizeof(Edge) * (numEdges + 1));
+    ShapePoint *shape = malloc(sizeof(ShapePoint) * (numEdges + numShapePoints + 1));
+
+    buildIncidence(outStart, outList, 1);
+    buildIncidence(inStart, inList, 0);
+
+    for (int v = 0; v < numNodes; v++) interior[v] = isChainInterior(v, outStart, outList, inStart, inList);
+
+    int newCount = 0;
+    int shapeLen = 0;
+
+    for (int u = 0; u < numNodes; u++) 
+    {
+        if (!interior[u]) emitChainsFrom(u, interior, outStart, outList, used, newEdges, &newCount, shape, &shapeLen);
+    }
+
+    for (int v = 0; v < numNodes; v++)          // pure rings never touch a kept node, so keep one node per ring
+    {
+        if (interior[v] && !used[outList[outStart[v]]]) 
+        {
+            interior[v] = 0;
+            emitChainsFrom(v, interior, outStart, outList, used, newEdges, &newCount, shape, &shapeLen);
+        }
+    }
+
+    int keptNodes = 0;
+    for (int v = 0; v < numNodes; v++) 
+    {
+        if (interior[v]) 
+        {
+            newId[v] = -1;
+            continue;
+        }
+
+        int isDefault = !isNamedStation(v);
+        newId[v] = keptNodes;
+        nodes[keptNodes] = nodes[v];
+        nodes[keptNodes].id = keptNodes;
+        if (isDefault) sprintf(nodes[keptNodes].name, "Node%d", keptNodes);
+        keptNodes++;
+    }
+
+    for (int i = 0; i < newCount; i++) 
+    {
+        newEdges[i].from = newId[newEdges[i].from];
+        newEdges[i].to = newId[newEdges[i].to];
+    }
+
+    newCount = dedupeEdges(newEdges, newCount);
+
+    memcpy(edges, newEdges, sizeof(Edge) * newCount);
+    memcpy(shapePoints, shape, sizeof(ShapePoint) * shapeLen);
+    numNodes = keptNodes;
+    numEdges = newCount;
+    numShapePoints = shapeLen;
+
+    free(outStart);
+    free(inStart);
+    free(outList);
+    free(inList);
+    free(interior);
+    free(used);
+    free(newId);
+    free(newEdges);
+    free(shape);
+
+    printf("Simplified graph: %d -> %d nodes, %d -> %d edges\n", oldNodes, numNodes, oldEdges, numEdges);
+}
@@ -0,0 +1,9 @@
+#ifndef graphSimplify_H
+#define graphSimplify_H
+
+#include "nodesAndEdges.h"
+
+int dedupeEdges(Edge list[], int count);
+void simplifyGraph();
+
+#endif
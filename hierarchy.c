@@ -0,0 +1,381 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "timeHandling.h"
+#include "search.h"
+#include "hierarchy.h"
+
+// Contraction works on a graph that grows shortcuts, so it keeps its own arc lists
+typedef struct 
+{
+    int node;
+    double weight;
+} HierarchyArc;
+
+typedef struct 
+{
+    HierarchyArc *arcs;
+    int count;
+    int capacity;
+} ArcList;
+
+typedef struct 
+{
+    ArcList *out;
+    ArcList *in;
+    char *contracted;
+    int *deleted;               // contracted neighbours, spreads the order out over the map
+    double *priority;
+    HeapEntry *queue;           // lazy: an entry counts only while its key is the node's priority
+    int queueSize;
+    int queueCapacity;
+    SearchSpace space;          // witness searches
+} Builder;
+
+static pthread_mutex_t hierarchyLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Adds node to the list, or lowers the weight of the arc already there
+static void addOrLower(ArcList *list, int node, double weight) {
+
+    for (int k = 0; k < list->count; k++) 
+    {
+        if (list->arcs[k].node != node) continue;
+        if (weight < list->arcs[k].weight) list->arcs[k].weight = weight;
+        return;
+    }
+
+    if (list->count == list->capacity) 
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 4;
+        list->arcs = realloc(list->arcs, sizeof(HierarchyArc) * list->capacity);
+    }
+
+    list->arcs[list->count].node = node;
+    list->arcs[list->count].weight = weight;
+    list->count++;
+}
+
+static void queuePush(Builder *b, double key, int node) {
+
+    if (b->queueSize == b->queueCapacity) 
+    {
+        b->queueCapacity = b->queueCapacity ? b->queueCapacity * 2 : 1024;
+        b->queue = realloc(b->queue, sizeof(HeapEntry) * b->queueCapacity);
+    }
+
+    int i = b->queueSize++;
+    while (i > 0 && b->queue[(i - 1) / 2].key > key) 
+    {
+        b->queue[i] = b->queue[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+
+    b->queue[i].key = key;
+    b->queue[i].node = node;
+}
+
+static HeapEntry queuePop(Builder *b) {
+
+    HeapEntry top = b->queue[0];
+    HeapEntry last = b->queue[--b->queueSize];
+    int i = 0;
+
+    while (1) 
+    {
+        int child = 2 * i + 1;
+        if (child >= b->queueSize) break;
+        if (child + 1 < b->queueSize && b->queue[child + 1].key < b->queue[child].key) child++;
+        if (last.key <= b->queue[child].key) break;
+
+        b->queue[i] = b->queue[child];
+        i = child;
+    }
+
+    if (b->queueSize > 0) b->queue[i] = last;
+    return top;
+}
+
+// Dijkstra from u over what is left of the graph, never through skip, until maxDist
+static void witnessSearch(Builder *b, int u, int skip, double maxDist) {
+
+    SearchSpace *space = &b->space;
+    beginSearch(space);
+    touchNode(space, u);
+    space->dist[u] = 0;
+    heapPush(space, 0, u);
+
+    double key;
+    int x, settled = 0;
+
+    while ((x = heapPop(space, &key)) != -1) 
+    {
+        if (key > space->dist[x]) continue;
+        if (key > maxDist || ++settled > WITNESS_SETTLE_LIMIT) break;
+
+        for (int k = 0; k < b->out[x].count; k++) 
+        {
+            const HierarchyArc *a = &b->out[x].arcs[k];
+            if (a->node == skip || b->contracted[a->node]) continue;
+
+            touchNode(space, a->node);
+            if (key + a->weight < space->dist[a->node]) 
+            {
+                space->dist[a->node] = key + a->weight;
+                heapPush(space, key + a->weight, a->node);
+            }
+        }
+    }
+}
+
+// Shortcuts v's removal needs: u -> v -> w wherever no path of the same length avoids v.
+// Only counts them unless apply is set.
+static int contractNode(Builder *b, int v, int apply) {
+
+    int shortcuts = 0;
+
+    for (int i = 0; i < b->in[v].count; i++) 
+    {
+        int u = b->in[v].arcs[i].node;
+        double toV = b->in[v].arcs[i].weight;
+        if (b->contracted[u]) continue;
+
+        double maxDist = -1;
+        for (int k = 0; k < b->out[v].count; k++) 
+        {
+            int w = b->out[v].arcs[k].node;
+            if (w == u || b->contracted[w]) continue;
+            if (toV + b->out[v].arcs[k].weight > maxDist) maxDist = toV + b->out[v].arcs[k].weight;
+        }
+        if (maxDist < 0) continue;
+
+        witnessSearch(b, u, v, maxDist);
+
+        for (int k = 0; k < b->out[v].count; k++) 
+        {
+            int w = b->out[v].arcs[k].node;
+            if (w == u || b->contracted[w]) continue;
+
+            double via = toV + b->out[v].arcs[k].weight;
+            if (searchDist(&b->space, w) <= via) continue;            // a witness covers it
+
+            shortcuts++;
+            if (apply) 
+            {
+                addOrLower(&b->out[u], w, via);
+                addOrLower(&b->in[w], u, via);
+            }
+        }
+    }
+
+    return shortcuts;
+}
+
+// Edge difference plus contracted neighbours
+static double nodePriority(Builder *b, int v) {
+
+    int degree = 0;
+    for (int k = 0; k < b->in[v].count; k++) degree += !b->contracted[b->in[v].arcs[k].node];
+    for (int k = 0; k < b->out[v].count; k++) degree += !b->contracted[b->out[v].arcs[k].node];
+
+    return contractNode(b, v, 0) - degree + b->deleted[v];
+}
+
+static void touchNeighbours(Builder *b, const ArcList *list) {
+
+    for (int k = 0; k < list->count; k++) 
+    {
+        int x = list->arcs[k].node;
+        if (b->contracted[x]) continue;
+
+        b->deleted[x]++;
+        b->priority[x] = nodePriority(b, x);
+        queuePush(b, b->priority[x], x);
+    }
+}
+
+// Runs on the pinned graph's views
+static Hierarchy *buildHierarchy() {
+
+    double startMs = monotonicMs();
+    int n = numNodes;
+    Builder b = { 0 };
+
+    b.out = calloc(n + 1, sizeof(ArcList));
+    b.in = calloc(n + 1, sizeof(ArcList));
+    b.contracted = calloc(n + 1, 1);
+    b.deleted = calloc(n + 1, sizeof(int));
+    b.priority = malloc(sizeof(double) * (n + 1));
+    initSearchSpace(&b.space);
+
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+
+    for (int u = 0; u < n; u++) 
+    {
+        for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+        {
+            const Edge *e = &edges[carList[k]];
+            if (e->to == u) continue;
+
+            addOrLower(&b.out[u], e->to, e->distance);
+            addOrLower(&b.in[e->to], u, e->distance);
+        }
+    }
+
+    int originalArcs = 0;
+    for (int u = 0; u < n; u++) originalArcs += b.out[u].count;
+
+    for (int v = 0; v < n; v++) 
+    {
+        b.priority[v] = nodePriority(&b, v);
+        queuePush(&b, b.priority[v], v);
+    }
+
+    int *rank = malloc(sizeof(int) * (n + 1));
+    int nextRank = 0;
+
+    while (b.queueSize > 0) 
+    {
+        HeapEntry top = queuePop(&b);
+        int v = top.node;
+        if (b.contracted[v] || top.key != b.priority[v]) continue;
+
+        double current = nodePriority(&b, v);            // neighbours may have changed since it was queued
+        if (b.queueSize > 0 && current > b.queue[0].key) 
+        {
+            b.priority[v] = current;
+            queuePush(&b, current, v);
+            continue;
+        }
+
+        contractNode(&b, v, 1);
+        b.contracted[v] = 1;
+        rank[v] = nextRank++;
+
+        touchNeighbours(&b, &b.in[v]);
+        touchNeighbours(&b, &b.out[v]);
+    }
+
+    // Every arc the lists ever held is an edge of the hierarchy, pointing up or down by rank
+    Hierarchy *h = calloc(1, sizeof(Hierarchy));
+    h->numNodes = n;
+    h->order = malloc(sizeof(int) * (n + 1));
+    h->position = malloc(sizeof(int) * (n + 1));
+    h->upStart = calloc(n + 2, sizeof(int));
+    h->downStart = calloc(n + 2, sizeof(int));
+
+    for (int v = 0; v < n; v++) 
+    {
+        h->position[v] = n - 1 - rank[v];
+        h->order[h->position[v]] = v;
+    }
+
+    int arcs = 0;
+    for (int u = 0; u < n; u++) 
+    {
+        for (int k = 0; k < b.out[u].count; k++) 
+        {
+            int w = b.out[u].arcs[k].node;
+            if (rank[u] < rank[w]) h->upStart[h->position[u] + 1]++;
+            else h->downStart[h->position[w] + 1]++;
+            arcs++;
+        }
+    }
+
+    for (int p = 0; p < n; p++) 
+    {
+        h->upStart[p + 1] += h->upStart[p];
+        h->downStart[p + 1] += h->downStart[p];
+    }
+
+    h->upTo = malloc(sizeof(int) * (h->upStart[n] + 1));
+    h->upWeight = malloc(sizeof(double) * (h->upStart[n] + 1));
+    h->downFrom = malloc(sizeof(int) * (h->downStart[n] + 1));
+    h->downWeight = malloc(sizeof(double) * (h->downStart[n] + 1));
+
+    int *upFill = malloc(sizeof(int) * (n + 1));
+    int *downFill = malloc(sizeof(int) * (n + 1));
+    for (int p = 0; p < n; p++) 
+    {
+        upFill[p] = h->upStart[p];
+        downFill[p] = h->downStart[p];
+    }
+
+    for (int u = 0; u < n; u++) 
+    {
+        for (int k = 0; k < b.out[u].count; k++) 
+        {
+            int w = b.out[u].arcs[k].node;
+            double weight = b.out[u].arcs[k].weight;
+
+            if (rank[u] < rank[w]) 
+            {
+                int slot = upFill[h->position[u]]++;
+                h->upTo[slot] = h->position[w];
+                h->upWeight[slot] = weight;
+            }
+            else 
+            {
+                int slot = downFill[h->position[w]]++;
+                h->downFrom[slot] = h->position[u];
+                h->downWeight[slot] = weight;
+            }
+        }
+    }
+
+    h->numShortcuts = arcs - originalArcs;
+
+    for (int v = 0; v < n; v++) 
+    {
+        free(b.out[v].arcs);
+        free(b.in[v].arcs);
+    }
+    free(b.out);
+    free(b.in);
+    free(b.contracted);
+    free(b.deleted);
+    free(b.priority);
+    free(b.queue);
+    free(rank);
+    free(upFill);
+    free(downFill);
+    freeSearchSpace(&b.space);
+
+    h->buildMs = monotonicMs() - startMs;
+    return h;
+}
+
+// The pinned version's hierarchy, contracted on first use. Others wanting it meanwhile wait.
+const Hierarchy *carHierarchy() {
+
+    Graph *g = activeGraph;
+    Hierarchy *h = __atomic_load_n(&g->hierarchy, __ATOMIC_ACQUIRE);
+    if (h) return h;
+
+    pthread_mutex_lock(&hierarchyLock);
+
+    if (!g->hierarchy) __atomic_store_n(&g->hierarchy, buildHierarchy(), __ATOMIC_RELEASE);
+    h = g->hierarchy;
+
+    pthread_mutex_unlock(&hierarchyLock);
+    return h;
+}
+
+void freeHierarchy(Graph *g) {
+
+    Hierarchy *h = g->hierarchy;
+    if (!h) return;
+
+    free(h->order);
+    free(h->position);
+    free(h->upStart);
+    free(h->upTo);
+    free(h->upWeight);
+    free(h->downStart);
+    free(h->downFrom);
+    free(h->downWeight);
+    free(h);
+    g->hierarchy = NULL;
+}
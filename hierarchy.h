@@ -0,0 +1,29 @@
+#ifndef hierarchy_H
+#define hierarchy_H
+
+#include "nodesAndEdges.h"
+
+#define WITNESS_SETTLE_LIMIT 500        // a witness search gives up here and the shortcut goes in
+
+// Contraction hierarchy of the car network on distance. Nodes are numbered by sweep position,
+// highest rank first, so a downward sweep walks the arrays front to back. Built the first
+// time a graph version needs it; closures are not part of it (see phast.c).
+typedef struct Hierarchy 
+{
+    int numNodes;
+    int *order;                 // sweep position -> node
+    int *position;              // node -> sweep position
+    int *upStart;               // per position, edges to higher ranked positions
+    int *upTo;
+    double *upWeight;
+    int *downStart;             // per position, edges in from higher ranked positions
+    int *downFrom;
+    double *downWeight;
+    int numShortcuts;
+    double buildMs;
+} Hierarchy;
+
+const Hierarchy *carHierarchy();
+void freeHierarchy(Graph *g);
+
+#endif
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "instrument.h"
+
+static const char *phaseNames[NUM_PHASES] = { "snap", "reset", "search", "path", "print", "export" };
+
+void clearQueryStats(QueryStats *stats) {
+
+    memset(stats, 0, sizeof(*stats));
+}
+
+void addQueryStats(QueryStats *total, const QueryStats *part) {
+
+    for (int p = 0; p < NUM_PHASES; p++) total->phaseMs[p] += part->phaseMs[p];
+
+    total->nodesSettled += part->nodesSettled;
+    total->edgesScanned += part->edgesScanned;
+    total->edgesRelaxed += part->edgesRelaxed;
+    total->waitsComputed += part->waitsComputed;
+    total->infWaitsSkipped += part->infWaitsSkipped;
+}
+
+// Summaries are opt-in so the normal menu output stays the same: export ROUTE_STATS=1
+int queryStatsEnabled() {
+
+#ifdef NO_INSTRUMENT
+    return 0;
+#else
+    static int enabled = -1;
+
+    if (enabled < 0) 
+    {
+        const char *env = getenv("ROUTE_STATS");
+        enabled = env && *env && strcmp(env, "0") != 0;
+    }
+
+    return enabled;
+#endif
+}
+
+void printQueryStats(const QueryStats *stats, FILE *out) {
+
+    fprintf(out, "[stats]");
+    for (int p = 0; p < NUM_PHASES; p++) fprintf(out, " %s %.3f ms%s", phaseNames[p], stats->phaseMs[p], p + 1 < NUM_PHASES ? " |" : "");
+
+    fprintf(out, "\n[stats] settled %ld, scanned %ld, relaxed %ld, waits %ld, INF waits skipped %ld\n",
+            stats->nodesSettled, stats->edgesScanned, stats->edgesRelaxed, stats->waitsComputed, stats->infWaitsSkipped);
+}
@@ -0,0 +1,51 @@
+#ifndef instrument_H
+#define instrument_H
+
+#include <stdio.h>
+#include "timeHandling.h"
+#include "trace.h"
+
+// Per-query counters and phase timers. Build with -DNO_INSTRUMENT (make INSTRUMENT=0)
+// and every macro below turns into nothing.
+
+typedef enum
+{
+    PHASE_SNAP,
+    PHASE_RESET,
+    PHASE_SEARCH,
+    PHASE_PATH,
+    PHASE_PRINT,
+    PHASE_EXPORT,
+    NUM_PHASES
+} QueryPhase;
+
+typedef struct 
+{
+    double phaseMs[NUM_PHASES];
+    long nodesSettled;
+    long edgesScanned;
+    long edgesRelaxed;
+    long waitsComputed;
+    long infWaitsSkipped;
+} QueryStats;
+
+#ifndef NO_INSTRUMENT
+
+#define STAT_INC(stats, field) ((stats)->field++)
+#define PHASE_BEGIN(name) TRACE_BEGIN(#name, "phase"); double name##PhaseStart = monotonicMs()
+#define PHASE_END(stats, phase, name) ((stats)->phaseMs[phase] += monotonicMs() - name##PhaseStart); TRACE_END(#name, "phase")
+
+#else
+
+#define STAT_INC(stats, field) ((void)0)
+#define PHASE_BEGIN(name) ((void)0)
+#define PHASE_END(stats, phase, name) ((void)0)
+
+#endif
+
+void clearQueryStats(QueryStats *stats);
+void addQueryStats(QueryStats *total, const QueryStats *part);
+int queryStatsEnabled();
+void printQueryStats(const QueryStats *stats, FILE *out);
+
+#endif
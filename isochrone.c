@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "timeHandling.h"
+#include "walkTransfers.h"
+#include "problem6.h"
+#include "search.h"
+#include "speedProfile.h"
+#include "modeProfile.h"
+#include "isochrone.h"
+
+static double isochroneSpeed(Mode mode, IsochroneProfile profile) {
+
+    const ModeProfile *modes = getModeProfile(6);
+    if (profile == ISOCHRONE_TRANSIT && mode == MODE_CAR) return modes->speed[MODE_WALK];
+
+    return modes->speed[mode];
+}
+
+// One-to-all earliest arrival from source, cut off at startTimeMin + budgetMin.
+// Waits use the problem 6 schedules, so a line that is not running is never boarded.
+int runIsochrone(SearchSpace *space, int source, int startTimeMin, double budgetMin, IsochroneProfile profile) {
+
+    double limit = startTimeMin + budgetMin;
+
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+    touchNode(space, source);
+    space->dist[source] = startTimeMin;
+    heapPush(space, startTimeMin, source);
+
+    double now;
+    int u;
+    int reached = 0;
+
+    while ((u = heapPop(space, &now)) != -1) 
+    {
+        if (now > space->dist[u] || space->settled[u]) continue;
+
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
+        reached++;
+
+        Mode arrivalMode = (space->prevEdge[u] >= 0) ? edges[space->prevEdge[u]].mode : MODE_CAR;
+
+        for (int k = adjStart[u]; k < adjStart[u + 1]; k++) 
+        {
+            STAT_INC(&space->stats, edgesScanned);
+            int edgeIdx = adjList[k];
+            const Edge *e = &edges[edgeIdx];
+
+            if (!isWalkTransferAllowed(space->prevEdge[u], edgeIdx) || isEdgeClosed(space->traffic, edgeIdx)) continue;
+
+            double waitTime = 0.0;
+            if (e->mode != MODE_CAR && e->mode != MODE_WALK && (e->mode != arrivalMode || u == source)) 
+            {
+                waitTime = getWaitingTimeProblem6(u, (int)now, e->mode);
+                STAT_INC(&space->stats, waitsComputed);
+                if (waitTime >= INF) 
+                {
+                    STAT_INC(&space->stats, infWaitsSkipped);
+                    continue;                           // Service not available
+                }
+            }
+
+            touchNode(space, e->to);
+            double speed = isochroneSpeed(e->mode, profile);
+            double travelTime = (profile == ISOCHRONE_TRANSIT && e->mode == MODE_CAR)       // walking the roads, no traffic
+                                ? (e->distance / speed) * 60.0
+                                : edgeTravelMin(edgeIdx, speed, now + waitTime) / trafficFactor(space->traffic, edgeIdx);
+            double arrival = now + waitTime + travelTime;
+
+            if (arrival > limit || arrival >= space->dist[e->to]) continue;
+
+            space->dist[e->to] = arrival;
+            space->prev[e->to] = u;
+            space->prevEdge[e->to] = edgeIdx;
+            heapPush(space, arrival, e->to);
+            STAT_INC(&space->stats, edgesRelaxed);
+        }
+    }
+
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    return reached;
+}
+
+int exportIsochroneCSV(SearchSpace *space, int startTimeMin, double budgetMin, IsochroneProfile profile,
+                       const char *filename) {
+
+    FILE *f = fopen(filename, "w");
+    if (!f) 
+    {
+        printf("Failed to open %s\n", filename);
+        return -1;
+    }
+
+    char timeBuffer[32];
+    double limit = startTimeMin + budgetMin;
+
+    fprintf(f, "node,name,lat,lon,arrival_min,arrival,mode\n");
+
+    for (int i = 0; i < numNodes; i++) 
+    {
+        if (!isSettled(space, i) || space->dist[i] > limit) continue;
+
+        Mode mode = (space->prevEdge[i] >= 0) ? edges[space->prevEdge[i]].mode : MODE_WALK;
+        if (profile == ISOCHRONE_TRANSIT && mode == MODE_CAR) mode = MODE_WALK;         // roads were covered on foot
+        formatTime((int)space->dist[i], timeBuffer, sizeof(timeBuffer));
+
+        fprintf(f, "%d,%s,%.6f,%.6f,%.1f,%s,%s\n", i, nodes[i].name, nodes[i].lat, nodes[i].lon,
+                space->dist[i] - startTimeMin, timeBuffer, getModeName(mode));
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static double cross(const ShapePoint *o, const ShapePoint *a, const ShapePoint *b) {
+
+    return (a->lon - o->lon) * (b->lat - o->lat) - (a->lat - o->lat) * (b->lon - o->lon);
+}
+
+static int comparePoints(const void *a, const void *b) {
+
+    const ShapePoint *p = (const ShapePoint *)a;
+    const ShapePoint *q = (const ShapePoint *)b;
+
+    if (p->lon != q->lon) return p->lon < q->lon ? -1 : 1;
+    if (p->lat != q->lat) return p->lat < q->lat ? -1 : 1;
+    return 0;
+}
+
+// Monotone chain hull, writes the ring into hull[] and returns its length
+static int convexHull(ShapePoint *points, int count, ShapePoint *hull) {
+
+    if (count < 3) 
+    {
+        memcpy(hull, points, sizeof(ShapePoint) * count);
+        return count;
+    }
+
+    qsort(points, count, sizeof(ShapePoint), comparePoints);
+
+    int k = 0;
+    for (int i = 0; i < count; i++) 
+    {
+        while (k >= 2 && cross(&hull[k - 2], &hull[k - 1], &points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+
+    for (int i = count - 2, lower = k + 1; i >= 0; i--) 
+    {
+        while (k >= lower && cross(&hull[k - 2], &hull[k - 1], &points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+
+    return k - 1;
+}
+
+// Reached nodes as points plus their convex hull as a rough catchment polygon
+int exportIsochroneKML(SearchSpace *space, int startTimeMin, double budgetMin, const char *filename) {
+
+    FILE *f = fopen(filename, "w");
+    if (!f) 
+    {
+        printf("Failed to open %s\n", filename);
+        return -1;
+    }
+
+    double limit = startTimeMin + budgetMin;
+    ShapePoint *points = malloc(sizeof(ShapePoint) * (numNodes + 1));
+    ShapePoint *hull = malloc(sizeof(ShapePoint) * (2 * numNodes + 2));
+    int count = 0;
+
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(f, "<kml xmlns=\"http://earth.google.com/kml/2.1\">\n");
+    fprintf(f, "<Document>\n");
+    fprintf(f, "<Folder>\n<name>Reachable nodes</name>\n");
+
+    for (int i = 0; i < numNodes; i++) 
+    {
+        if (!isSettled(space, i) || space->dist[i] > limit) continue;
+
+        points[count].lat = nodes[i].lat;
+        points[count].lon = nodes[i].lon;
+        count++;
+
+        fprintf(f, "<Placemark><name>%.0f min</name><Point><coordinates>%.6f,%.6f,0</coordinates></Point></Placemark>\n",
+                space->dist[i] - startTimeMin, nodes[i].lon, nodes[i].lat);
+    }
+
+    fprintf(f, "</Folder>\n");
+
+    int hullLen = convexHull(points, count, hull);
+    if (hullLen >= 3) 
+    {
+        fprintf(f, "<Placemark>\n<name>Isochrone %.0f min</name>\n", budgetMin);
+        fprintf(f, "<Polygon><outerBoundaryIs><LinearRing><coordinates>\n");
+        for (int i = 0; i <= hullLen; i++) fprintf(f, "%.6f,%.6f,0\n", hull[i % hullLen].lon, hull[i % hullLen].lat);
+        fprintf(f, "</coordinates></LinearRing></outerBoundaryIs></Polygon>\n</Placemark>\n");
+    }
+
+    fprintf(f, "</Document>\n");
+    fprintf(f, "</kml>\n");
+    fclose(f);
+
+    free(points);
+    free(hull);
+    return 0;
+}
+
+// main isochrone <lat> <lon> "<9:30 AM>" <minutes> <out.csv> [out.kml] [all|transit]
+int runIsochroneCommand(int argc, char **argv) {
+
+    if (argc < 5) 
+    {
+        printf("Usage: main isochrone <lat> <lon> \"<9:30 AM>\" <minutes> <out.csv> [out.kml] [all|transit]\n");
+        return 1;
+    }
+
+    double lat = atof(argv[0]);
+    double lon = atof(argv[1]);
+    int startTimeMin = parseTime(argv[2]);
+    double budgetMin = atof(argv[3]);
+    IsochroneProfile profile = (argc > 6 && strcmp(argv[6], "transit") == 0) ? ISOCHRONE_TRANSIT : ISOCHRONE_ALL;
+
+    if (startTimeMin < 0 || budgetMin <= 0) return 1;
+
+    int source = findNearestNode(lat, lon);
+    if (source == -1) 
+    {
+        printf("Error: Could not find nodes\n");
+        return 1;
+    }
+
+    SearchSpace space;
+    initSearchSpace(&space);
+
+    TRACE_BEGIN("isochrone", "query");
+    double startMs = monotonicMs();
+    int reached = runIsochrone(&space, source, startTimeMin, budgetMin, profile);
+    double elapsed = monotonicMs() - startMs;
+
+    printf("Reached %d nodes within %.0f minutes from %s in %.1f ms\n", reached, budgetMin, nodes[source].name, elapsed);
+
+    PHASE_BEGIN(export);
+    int result = exportIsochroneCSV(&space, startTimeMin, budgetMin, profile, argv[4]);
+    if (result == 0 && argc > 5 && strcmp(argv[5], "-") != 0) result = exportIsochroneKML(&space, startTimeMin, budgetMin, argv[5]);
+    PHASE_END(&space.stats, PHASE_EXPORT, export);
+
+    if (queryStatsEnabled()) printQueryStats(&space.stats, stdout);
+    TRACE_END("isochrone", "query");
+
+    freeSearchSpace(&space);
+    return result == 0 ? 0 : 1;
+}
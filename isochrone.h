@@ -0,0 +1,18 @@
+#ifndef isochrone_H
+#define isochrone_H
+
+#include "search.h"
+
+typedef enum
+{
+    ISOCHRONE_ALL,          // car, metro, both buses and walk transfers like problem 6
+    ISOCHRONE_TRANSIT       // metro and buses, with roads covered on foot
+} IsochroneProfile;
+
+int runIsochrone(SearchSpace *space, int source, int startTimeMin, double budgetMin, IsochroneProfile profile);
+int exportIsochroneCSV(SearchSpace *space, int startTimeMin, double budgetMin, IsochroneProfile profile,
+                       const char *filename);
+int exportIsochroneKML(SearchSpace *space, int startTimeMin, double budgetMin, const char *filename);
+int runIsochroneCommand(int argc, char **argv);
+
+#endif
@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "timeHandling.h"
+#include "problem6.h"
+#include "speedProfile.h"
+#include "traffic.h"
+#include "snap.h"
+#include "modeProfile.h"
+#include "itinerary.h"
+
+// Same numbers the solvers use, from the mode profile table
+ItineraryProfile problemProfile(int problem) {
+
+    ItineraryProfile p;
+    memset(&p, 0, sizeof(p));
+
+    const ModeProfile *modes = getModeProfile(problem);
+    memcpy(p.rate, modes->rate, sizeof(p.rate));
+    memcpy(p.speed, modes->speed, sizeof(p.speed));
+
+    if (problem == 6) p.waitFn = getWaitingTimeProblem6;
+    else if (problem >= 4) p.waitFn = getWaitingTime;
+
+    p.timed = problem >= 4;
+    return p;
+}
+
+// Appends one ride to the route: a whole path edge, or part of the snapped road at either end
+static void addStep(Itinerary *it, int *stepFrom, int *stepTo, double *stepShare, int edgeIdx, int from, int to, double share) {
+
+    stepFrom[it->numEdges] = from;
+    stepTo[it->numEdges] = to;
+    stepShare[it->numEdges] = share;
+    it->edgeIds[it->numEdges++] = edgeIdx;
+}
+
+// One pass over the rides. A transit leg waits for its service when it starts, which is
+// exactly when the old per-edge printers waited (first edge or a mode change). The ride from
+// the source's road point to the first node, and from the last node to the destination's,
+// are car legs like any other, priced and timed on the share of the edge they cover.
+void buildItinerary(const int path[], const int pathEdges[], int pathLen, const SnapPoint *from, const SnapPoint *to,
+                    int startTimeMin, const ItineraryProfile *profile, Itinerary *it) {
+
+    memset(it, 0, sizeof(*it));
+    int capacity = pathLen + 2;
+    int *stepFrom = malloc(sizeof(int) * capacity);
+    int *stepTo = malloc(sizeof(int) * capacity);
+    double *stepShare = malloc(sizeof(double) * capacity);
+    it->legs = malloc(sizeof(ItineraryLeg) * capacity);
+    it->edgeIds = malloc(sizeof(int) * capacity);
+    it->srcLat = from->lat;
+    it->srcLon = from->lon;
+    it->destLat = to->lat;
+    it->destLon = to->lon;
+    it->srcRoadLat = from->roadLat;
+    it->srcRoadLon = from->roadLon;
+    it->destRoadLat = to->roadLat;
+    it->destRoadLon = to->roadLon;
+    it->firstEdgeStart = 0.0;
+    it->lastEdgeEnd = 1.0;
+    it->startMin = startTimeMin;
+
+    SnapArc direct;
+    double directStart;
+
+    if (pathLen == 0 && snapDirectRide(from, to, &direct, &directStart)) 
+    {
+        addStep(it, stepFrom, stepTo, stepShare, direct.edge, -1, -1, direct.fraction);
+        it->firstEdgeStart = directStart;
+        it->lastEdgeEnd = directStart + direct.fraction;
+    }
+    else if (pathLen > 0) 
+    {
+        const SnapArc *in = routeStartArc(from, pathEdges, pathLen);
+        const SnapArc *out = routeEndArc(to, pathEdges, pathLen);
+
+        if (in && in->edge >= 0) 
+        {
+            int whole = in->fraction >= 1.0;
+            addStep(it, stepFrom, stepTo, stepShare, in->edge, whole ? edges[in->edge].from : -1, in->node, in->fraction);
+            it->firstEdgeStart = 1.0 - in->fraction;
+        }
+
+        for (int i = pathLen - 1; i > 1; i--) addStep(it, stepFrom, stepTo, stepShare, pathEdges[i - 1], path[i], path[i - 1], 1.0);
+
+        if (out && out->edge >= 0) 
+        {
+            int whole = out->fraction >= 1.0;
+            addStep(it, stepFrom, stepTo, stepShare, out->edge, out->node, whole ? edges[out->edge].to : -1, out->fraction);
+            it->lastEdgeEnd = out->fraction;
+        }
+    }
+
+    it->source = it->numEdges > 0 ? stepFrom[0] : (pathLen > 1 ? path[1] : -1);        // path[0] is the destination point
+    it->target = it->numEdges > 0 ? stepTo[it->numEdges - 1] : it->source;
+
+    TrafficSnapshot *traffic = acquireTraffic();
+
+    double currentTime = startTimeMin;
+    double entryLat, entryLon;
+    itineraryPoint(it, it->source, 0, &entryLat, &entryLon);
+
+    if (fabs(entryLat - from->lat) > 1e-6 || fabs(entryLon - from->lon) > 1e-6) 
+    {
+        it->walkInKm = haversineDistance(from->lat, from->lon, entryLat, entryLon);
+        it->walkInMin = (it->walkInKm / WALK_SPEED_KMH) * 60.0;
+        it->totalDistance += it->walkInKm;
+        it->totalTravelMin += it->walkInMin;
+        currentTime += it->walkInMin;
+    }
+
+    ItineraryLeg *leg = NULL;
+
+    for (int k = 0; k < it->numEdges; k++) 
+    {
+        int edgeIdx = it->edgeIds[k];
+        int valid = edgeIdx >= 0 && edgeIdx < numEdges;
+        Mode mode = valid ? edges[edgeIdx].mode : MODE_CAR;
+        double distance = valid ? edges[edgeIdx].distance * stepShare[k] : 0.0;
+
+        if (!leg || leg->mode != mode) 
+        {
+            leg = &it->legs[it->numLegs++];
+            memset(leg, 0, sizeof(*leg));
+            leg->mode = mode;
+            leg->fromNode = stepFrom[k];
+            leg->firstEdge = k;
+
+            if (profile->waitFn && mode != MODE_CAR && mode != MODE_WALK) 
+            {
+                double waitTime = profile->waitFn(stepFrom[k], (int)currentTime, mode);
+                if (waitTime > 0 && waitTime < INF) 
+                {
+                    leg->waitMin = waitTime;
+                    currentTime += waitTime;
+                    it->totalTravelMin += waitTime;
+                }
+            }
+
+            leg->departMin = currentTime;
+        }
+
+        double cost = distance * profile->rate[mode];
+        double travelTime = 0.0;
+
+        if (valid) 
+        {
+            SnapArc ride = { stepTo[k], edgeIdx, stepShare[k], 0.0 };
+            travelTime = stepShare[k] < 1.0 ? arcTravelMin(&ride, profile->speed[mode], currentTime, traffic)
+                                            : edgeTravelMin(edgeIdx, profile->speed[mode], currentTime);
+            if (stepShare[k] >= 1.0 && trafficFactor(traffic, edgeIdx) > 0.0f) travelTime /= trafficFactor(traffic, edgeIdx);
+        }
+
+        leg->toNode = stepTo[k];
+        leg->numEdges++;
+        leg->distance += distance;
+        leg->cost += cost;
+        leg->travelMin += travelTime;
+
+        it->totalDistance += distance;
+        it->totalCost += cost;
+        it->totalTravelMin += travelTime;
+        currentTime += travelTime;
+    }
+
+    double exitLat, exitLon;
+    itineraryPoint(it, it->target, 1, &exitLat, &exitLon);
+
+    if (fabs(exitLat - to->lat) > 1e-6 || fabs(exitLon - to->lon) > 1e-6) 
+    {
+        it->walkOutKm = haversineDistance(exitLat, exitLon, to->lat, to->lon);
+        it->walkOutMin = (it->walkOutKm / WALK_SPEED_KMH) * 60.0;
+        it->totalDistance += it->walkOutKm;
+        it->totalTravelMin += it->walkOutMin;
+        currentTime += it->walkOutMin;
+    }
+
+    it->arrivalMin = currentTime;
+    releaseTraffic(traffic);
+    free(stepFrom);
+    free(stepTo);
+    free(stepShare);
+}
+
+// Coordinates of a leg end: a node, or -1 for the road point at the source (atDest 0) or destination
+void itineraryPoint(const Itinerary *it, int node, int atDest, double *lat, double *lon) {
+
+    if (node >= 0) 
+    {
+        *lat = nodes[node].lat;
+        *lon = nodes[node].lon;
+    }
+    else 
+    {
+        *lat = atDest ? it->destRoadLat : it->srcRoadLat;
+        *lon = atDest ? it->destRoadLon : it->srcRoadLon;
+    }
+}
+
+static void printClock(double minutes, int timed) {
+
+    if (!timed) return;
+
+    char timeBuffer[32];
+    formatTime((int)minutes, timeBuffer, sizeof(timeBuffer));
+    printf("[%s] ", timeBuffer);
+}
+
+// "Name (lon, lat)" of a leg end, the road points have no name of their own
+static void pointText(const Itinerary *it, int node, int atDest, char *out, size_t size) {
+
+    double lat, lon;
+    itineraryPoint(it, node, atDest, &lat, &lon);
+    snprintf(out, size, "%s (%.6f, %.6f)", node >= 0 ? nodes[node].name : "Road", lon, lat);
+}
+
+// One line per leg (plus its wait), so the output grows with mode changes, not with edges
+void printItineraryLegs(const Itinerary *it, int timed) {
+
+    char timeText[48] = "";
+    char fromText[80], toText[80];
+
+    if (it->walkInKm > 0) 
+    {
+        if (timed) snprintf(timeText, sizeof(timeText), ", Time: %.1f min", it->walkInMin);
+        pointText(it, it->source, 0, toText, sizeof(toText));
+        printClock(it->startMin, timed);
+        printf("Walk from Source (%.6f, %.6f) to %s, Distance: %.3f km%s, Cost: ৳0.00\n",
+               it->srcLon, it->srcLat, toText, it->walkInKm, timeText);
+    }
+
+    for (int l = 0; l < it->numLegs; l++) 
+    {
+        const ItineraryLeg *leg = &it->legs[l];
+
+        if (leg->waitMin > 0) 
+        {
+            printClock(leg->departMin - leg->waitMin, timed);
+            printf("Wait for %s: %.0f minutes\n", getModeName(leg->mode), leg->waitMin);
+        }
+
+        if (timed) snprintf(timeText, sizeof(timeText), ", Time: %.1f min", leg->travelMin);
+        pointText(it, leg->fromNode, 0, fromText, sizeof(fromText));
+        pointText(it, leg->toNode, 1, toText, sizeof(toText));
+        printClock(leg->departMin, timed);
+        printf("%s from %s to %s, Distance: %.3f km%s, Cost: ৳%.2f (%d segment%s)\n",
+               getModeAction(leg->mode), fromText, toText,
+               leg->distance, timeText, leg->cost, leg->numEdges, leg->numEdges == 1 ? "" : "s");
+    }
+
+    if (it->walkOutKm > 0) 
+    {
+        if (timed) snprintf(timeText, sizeof(timeText), ", Time: %.1f min", it->walkOutMin);
+        pointText(it, it->target, 1, fromText, sizeof(fromText));
+        printClock(it->arrivalMin - it->walkOutMin, timed);
+        printf("Walk from %s to Destination (%.6f, %.6f), Distance: %.3f km%s, Cost: ৳0.00\n",
+               fromText, it->destLon, it->destLat, it->walkOutKm, timeText);
+    }
+}
+
+void freeItinerary(Itinerary *it) {
+
+    free(it->legs);
+    free(it->edgeIds);
+    memset(it, 0, sizeof(*it));
+}
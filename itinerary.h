@@ -0,0 +1,59 @@
+#ifndef itinerary_H
+#define itinerary_H
+
+#include "mode.h"
+#include "snap.h"
+
+// Rates and speeds a problem uses to price and time a path. waitFn is NULL for
+// the problems without schedules, and those also skip the clock.
+typedef struct 
+{
+    double rate[NUM_MODES];         // Taka per km
+    double speed[NUM_MODES];        // km/h
+    double (*waitFn)(int node, int currentTimeMin, Mode mode);
+    int timed;
+} ItineraryProfile;
+
+// Consecutive edges on the same mode, i.e. one ride or one walk
+typedef struct 
+{
+    Mode mode;
+    int fromNode;                   // -1 for the road point at the source
+    int toNode;                     // -1 for the road point at the destination
+    int firstEdge;                  // index into Itinerary.edgeIds
+    int numEdges;
+    double distance;
+    double cost;
+    double waitMin;                 // before boarding, 0 if none
+    double departMin;               // clock time the leg starts moving
+    double travelMin;
+} ItineraryLeg;
+
+typedef struct 
+{
+    ItineraryLeg *legs;
+    int numLegs;
+    int *edgeIds;                   // edges ridden from source to target, partial ones included
+    int numEdges;
+    double srcLat, srcLon, destLat, destLon;
+    double srcRoadLat, srcRoadLon, destRoadLat, destRoadLon;       // where the walks meet the road
+    double firstEdgeStart;          // position the first edge is boarded at, 0 unless boarded mid-road
+    double lastEdgeEnd;             // position the last edge is left at, 1 unless left mid-road
+    int source, target;             // first and last node ridden through, -1 for a road point
+    double walkInKm, walkInMin;     // 0 when the point is on the road
+    double walkOutKm, walkOutMin;
+    double startMin;
+    double arrivalMin;
+    double totalDistance;
+    double totalCost;
+    double totalTravelMin;
+} Itinerary;
+
+ItineraryProfile problemProfile(int problem);
+void buildItinerary(const int path[], const int pathEdges[], int pathLen, const SnapPoint *from, const SnapPoint *to,
+                    int startTimeMin, const ItineraryProfile *profile, Itinerary *it);
+void itineraryPoint(const Itinerary *it, int node, int atDest, double *lat, double *lon);
+void printItineraryLegs(const Itinerary *it, int timed);
+void freeItinerary(Itinerary *it);
+
+#endif
@@ -1,7 +1,15 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "mode.h"
 #include "nodesAndEdges.h"
-#include "csvParse.h"
+#include "graphLoad.h"
+#include "matrix.h"
+#include "isochrone.h"
+#include "phast.h"
+#include "routeCache.h"
+#include "traffic.h"
+#include "server.h"
 #include "problem1.h"
 #include "problem2.h"
 #include "problem3.h"
@@ -9,12 +17,35 @@
 #include "problem5.h"
 #include "problem6.h"
 
-int main() {
+int main(int argc, char **argv) {
 
-    parseRoadmapCSV("Roadmap-Dhaka.csv");
-    parseMetroCSV("Routemap-DhakaMetroRail.csv");
-    parseBusCSV("Routemap-BikolpoBus.csv", MODE_BIKOLPO);
-    parseBusCSV("Routemap-UttaraBus.csv", MODE_UTTARA);
+    loadGraph();
+
+    const char *trafficFile = getenv("ROUTE_TRAFFIC");       // live feed, re-read whenever it changes
+    if (trafficFile && trafficFile[0]) startTrafficWatcher(trafficFile, 1000);
+
+    const char *reload = getenv("ROUTE_RELOAD");             // rebuild when the data files change
+    if (reload && atoi(reload) > 0) startGraphWatcher(atoi(reload) * 1000);
+
+    if (argc > 1 && strcmp(argv[1], "matrix") == 0)         // batch modes skip the menu
+    {
+        return runMatrixCommand(argc - 2, argv + 2);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "isochrone") == 0) 
+    {
+        return runIsochroneCommand(argc - 2, argv + 2);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "trees") == 0) 
+    {
+        return runTreesCommand(argc - 2, argv + 2);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "serve") == 0) 
+    {
+        return runServerCommand(argc - 2, argv + 2);
+    }
 
     while (1) 
     {
@@ -31,9 +62,14 @@ int main() {
         int choice;
         printf("Enter Choice: ");
         scanf("%d", &choice);
+        pinGraph(NULL);             // pick up a reload between queries, never during one
         printf("-----------------------------\n");
 
         if (choice == 7) {
+            long hits, misses;
+            int entries;
+            routeCacheStats(&hits, &misses, &entries);
+            printf("Route cache: %ld hits, %ld misses, %d entries\n", hits, misses, entries);
             break;
         }
 
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "csvParse.h"
+#include "timeHandling.h"
+#include "search.h"
+#include "graphLoad.h"
+#include "scheduler.h"
+#include "modeProfile.h"
+#include "matrix.h"
+
+#define MAX_MATRIX_POINTS 100000
+
+typedef struct 
+{
+    const int *sourceNodes;
+    const int *targetNodes;
+    int numSources;
+    int numTargets;
+    double scale;
+    double *out;
+} MatrixJob;
+
+int readMatrixPoints(const char *filename, MatrixPoint **points) {
+
+    FILE *f = fopen(filename, "r");
+
+    if (!f) 
+    {
+        printf("Error opening %s\n", filename);
+        return -1;
+    }
+
+    char line[256];
+    char *tokens[4];
+    int count = 0;
+
+    *points = malloc(sizeof(MatrixPoint) * MAX_MATRIX_POINTS);
+
+    while (fgets(line, sizeof(line), f) && count < MAX_MATRIX_POINTS) 
+    {
+        line[strcspn(line, "\r\n")] = 0;
+
+        if (split_csv(line, tokens, 4) < 2) continue;
+        if (!is_number_token(tokens[0]) || !is_number_token(tokens[1])) continue;        // header or junk
+
+        (*points)[count].lat = atof(tokens[0]);
+        (*points)[count].lon = atof(tokens[1]);
+        count++;
+    }
+
+    fclose(f);
+    return count;
+}
+
+// One row: a multi-target search from its source
+static void matrixRow(void *arg, int row, SearchSpace *space) {
+
+    MatrixJob *job = (MatrixJob *)arg;
+    double *out = job->out + (size_t)row * job->numTargets;
+
+    TRACE_BEGIN("matrix row", "query");
+    runCarSearch(space, job->sourceNodes[row], job->targetNodes, job->numTargets);
+
+    for (int c = 0; c < job->numTargets; c++) 
+    {
+        double d = searchDist(space, job->targetNodes[c]);
+        out[c] = (d >= INF) ? -1.0 : d * job->scale;
+    }
+    TRACE_END("matrix row", "query");
+}
+
+// One multi-target search per source row; rows are tasks for numThreads workers, so a
+// worker stuck on long rows has the rest taken off it. Unreachable pairs are written as -1.
+void computeCarMatrix(const MatrixPoint sources[], int numSources, const MatrixPoint targets[], int numTargets,
+                      MatrixMetric metric, int numThreads, double *out) {
+
+    double carRate = getModeProfile(1)->rate[MODE_CAR];         // what problem 1 charges per km
+
+    int *sourceNodes = malloc(sizeof(int) * (numSources + 1));
+    int *targetNodes = malloc(sizeof(int) * (numTargets + 1));
+
+    for (int i = 0; i < numSources; i++) sourceNodes[i] = findNearestNode(sources[i].lat, sources[i].lon);
+    for (int i = 0; i < numTargets; i++) targetNodes[i] = findNearestNode(targets[i].lat, targets[i].lon);
+
+    MatrixJob job = { sourceNodes, targetNodes, numSources, numTargets,
+                      (metric == MATRIX_COST) ? carRate : 1.0, out };
+
+    runTasks(matrixRow, &job, numSources, numThreads, NULL);
+
+    free(sourceNodes);
+    free(targetNodes);
+}
+
+// .bin files get a flat little header (int32 rows, int32 cols) and row-major doubles, anything else is CSV
+int writeMatrix(const char *filename, const double *matrix, int rows, int cols) {
+
+    size_t len = strlen(filename);
+    int binary = len > 4 && strcmp(filename + len - 4, ".bin") == 0;
+
+    FILE *f = fopen(filename, binary ? "wb" : "w");
+
+    if (!f) 
+    {
+        printf("Failed to open %s\n", filename);
+        return -1;
+    }
+
+    if (binary) 
+    {
+        int header[2] = { rows, cols };
+        fwrite(header, sizeof(int), 2, f);
+        fwrite(matrix, sizeof(double), (size_t)rows * cols, f);
+    }
+    else 
+    {
+        fprintf(f, "source");
+        for (int c = 0; c < cols; c++) fprintf(f, ",t%d", c);
+        fprintf(f, "\n");
+
+        for (int r = 0; r < rows; r++) 
+        {
+            fprintf(f, "s%d", r);
+            for (int c = 0; c < cols; c++) fprintf(f, ",%.3f", matrix[(size_t)r * cols + c]);
+            fprintf(f, "\n");
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// main matrix <sources.csv> <targets.csv> <out.csv|out.bin> [distance|cost] [threads]
+int runMatrixCommand(int argc, char **argv) {
+
+    if (argc < 3) 
+    {
+        printf("Usage: main matrix <sources.csv> <targets.csv> <out.csv|out.bin> [distance|cost] [threads]\n");
+        return 1;
+    }
+
+    MatrixMetric metric = (argc > 3 && strcmp(argv[3], "cost") == 0) ? MATRIX_COST : MATRIX_DISTANCE;
+    int numThreads = (argc > 4) ? atoi(argv[4]) : defaultWorkers();
+
+    MatrixPoint *sources = NULL;
+    MatrixPoint *targets = NULL;
+    int numSources = readMatrixPoints(argv[0], &sources);
+    int numTargets = readMatrixPoints(argv[1], &targets);
+
+    if (numSources <= 0 || numTargets <= 0) 
+    {
+        printf("Need at least one source and one target point\n");
+        free(sources);
+        free(targets);
+        return 1;
+    }
+
+    double *out = malloc(sizeof(double) * (size_t)numSources * numTargets);
+    double startMs = monotonicMs();
+
+    computeCarMatrix(sources, numSources, targets, numTargets, metric, numThreads, out);
+
+    double elapsed = monotonicMs() - startMs;
+    int result = writeMatrix(argv[2], out, numSources, numTargets);
+
+    printf("Computed %dx%d %s matrix with %d threads in %.1f ms\n", numSources, numTargets,
+           metric == MATRIX_COST ? "cost" : "distance", numThreads, elapsed);
+
+    SchedulerStats stats;
+    schedulerTotals(&stats);
+    printSchedulerStats(&stats, stdout);
+
+    free(out);
+    free(sources);
+    free(targets);
+
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#ifndef matrix_H
+#define matrix_H
+
+typedef enum
+{
+    MATRIX_DISTANCE,        // km
+    MATRIX_COST             // taka at the car rate
+} MatrixMetric;
+
+typedef struct 
+{
+    double lat;
+    double lon;
+} MatrixPoint;
+
+int readMatrixPoints(const char *filename, MatrixPoint **points);
+void computeCarMatrix(const MatrixPoint sources[], int numSources, const MatrixPoint targets[], int numTargets,
+                      MatrixMetric metric, int numThreads, double *out);
+int writeMatrix(const char *filename, const double *matrix, int rows, int cols);
+int runMatrixCommand(int argc, char **argv);
+
+#endif
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "mode.h"
 
 const char* getModeName(Mode mode) {
@@ -11,4 +12,53 @@ const char* getModeName(Mode mode) {
         case MODE_UTTARA: return "Uttara Bus";
         default: return "Unknown";
     }
-}
\ No newline at end of file
+}
+
+const char* getModeAction(Mode mode) {          // how a segment reads in the trip instructions
+
+    switch(mode) 
+    {
+        case MODE_WALK: return "Walk";
+        case MODE_METRO: return "Ride Metro";
+        case MODE_CAR: return "Ride Car";
+        case MODE_BIKOLPO: return "Ride Bikolpo Bus";
+        case MODE_UTTARA: return "Ride Uttara Bus";
+        default: return "Ride Unknown";
+    }
+}
+
+int parseModeToken(const char *s, Mode *mode) {        // lower case one word names used in the data files
+
+    static const char *names[NUM_MODES] = { "walk", "metro", "car", "bikolpo", "uttara" };
+
+    for (int m = 0; m < NUM_MODES; m++) 
+    {
+        if (strcmp(s, names[m]) == 0) 
+        {
+            *mode = (Mode)m;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+unsigned profileModes(RouteProfile profile) {         // MODE_BIT set of the edges a profile may use
+
+    switch(profile) 
+    {
+        case PROFILE_CAR: return MODE_BIT(MODE_CAR);
+        case PROFILE_CAR_METRO: return MODE_BIT(MODE_CAR) | MODE_BIT(MODE_METRO) | MODE_BIT(MODE_WALK);
+        default: return MODE_BIT(MODE_CAR) | MODE_BIT(MODE_WALK) | TRANSIT_MODE_BITS;
+    }
+}
+
+const char* getProfileName(RouteProfile profile) {
+
+    switch(profile) 
+    {
+        case PROFILE_CAR: return "car";
+        case PROFILE_CAR_METRO: return "car+metro";
+        default: return "all modes";
+    }
+}
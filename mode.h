@@ -38,6 +38,24 @@ typedef enum
     MODE_UTTARA
 } Mode;
 
+#define NUM_MODES 5
+#define MODE_BIT(m) (1u << (m))
+#define TRANSIT_MODE_BITS (MODE_BIT(MODE_METRO) | MODE_BIT(MODE_BIKOLPO) | MODE_BIT(MODE_UTTARA))
+
+// Edge sets the solvers route over: problem 1 drives, problem 2 adds the metro, 3-6 take everything
+typedef enum 
+{
+    PROFILE_CAR,
+    PROFILE_CAR_METRO,
+    PROFILE_ALL
+} RouteProfile;
+
+#define NUM_PROFILES 3
+
 const char* getModeName(Mode mode);
+const char* getModeAction(Mode mode);
+int parseModeToken(const char *s, Mode *mode);
+unsigned profileModes(RouteProfile profile);
+const char* getProfileName(RouteProfile profile);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "csvParse.h"
+#include "timeHandling.h"
+#include "modeProfile.h"
+
+// The numbers the solvers had built in, used for anything the file leaves out
+static void defaultModeProfiles(ModeProfile *profiles) {
+
+    for (int p = 1; p <= NUM_PROBLEMS; p++) 
+    {
+        ModeProfile *mp = &profiles[p];
+        double vehicle = (p == 5) ? VEHICLE_SPEED_PROBLEM5_KMH : VEHICLE_SPEED_KMH;
+
+        mp->rate[MODE_CAR] = 20.0;
+        mp->rate[MODE_METRO] = 5.0;
+        mp->rate[MODE_BIKOLPO] = 7.0;
+        mp->rate[MODE_UTTARA] = (p == 3) ? 7.0 : 10.0;          // problem 3 has always charged 7 for the Uttara bus
+        mp->rate[MODE_WALK] = 0.0;
+
+        for (int m = 0; m < NUM_MODES; m++) mp->speed[m] = vehicle;
+        mp->speed[MODE_WALK] = WALK_SPEED_KMH;
+    }
+
+    profiles[6].speed[MODE_CAR] = CAR_SPEED_PROBLEM6_KMH;
+    profiles[6].speed[MODE_METRO] = METRO_SPEED_PROBLEM6_KMH;
+    profiles[6].speed[MODE_BIKOLPO] = BIKOLPO_SPEED_PROBLEM6_KMH;
+    profiles[6].speed[MODE_UTTARA] = UTTARA_SPEED_PROBLEM6_KMH;
+}
+
+// Rows are "problem,mode,rate,speed" and override the defaults. Runs on g's views once the
+// edges are final, since the per-edge tables are filled here too. Returns the rows applied,
+// or -1 if the file is missing (the defaults still apply).
+int loadModeProfiles(Graph *g, const char *filename) {
+
+    double startMs = monotonicMs();
+    ModeProfile *profiles = calloc(NUM_PROBLEMS + 1, sizeof(ModeProfile));
+    defaultModeProfiles(profiles);
+
+    int applied = -1;
+    FILE *f = fopen(filename, "r");
+
+    if (f) 
+    {
+        char line[256];
+        char *tokens[8];
+        int lineNo = 0;
+        applied = 0;
+
+        while (fgets(line, sizeof(line), f)) 
+        {
+            lineNo++;
+            line[strcspn(line, "\r\n")] = 0;
+            if (line[0] == '#' || line[0] == '\0') continue;
+
+            Mode mode;
+            if (split_csv(line, tokens, 8) != 4 || !parseModeToken(tokens[1], &mode)) 
+            {
+                printf("%s:%d: expected problem,mode,rate,speed\n", filename, lineNo);
+                continue;
+            }
+
+            int problem = atoi(tokens[0]);
+            double rate = atof(tokens[2]);
+            double speed = atof(tokens[3]);
+            if (problem < 1 || problem > NUM_PROBLEMS || rate < 0 || speed <= 0) 
+            {
+                printf("%s:%d: bad problem, rate or speed\n", filename, lineNo);
+                continue;
+            }
+
+            profiles[problem].rate[mode] = rate;
+            profiles[problem].speed[mode] = speed;
+            applied++;
+        }
+
+        fclose(f);
+    }
+
+    int tables = 0;
+
+    for (int p = 1; p <= NUM_PROBLEMS; p++) 
+    {
+        ModeProfile *mp = &profiles[p];
+
+        for (int q = 1; q < p; q++)             // same numbers as an earlier problem, same arrays
+        {
+            if (!mp->edgeFare && memcmp(mp->rate, profiles[q].rate, sizeof(mp->rate)) == 0) mp->edgeFare = profiles[q].edgeFare;
+            if (!mp->edgeMinutes && memcmp(mp->speed, profiles[q].speed, sizeof(mp->speed)) == 0) mp->edgeMinutes = profiles[q].edgeMinutes;
+        }
+
+        if (!mp->edgeFare) 
+        {
+            mp->edgeFare = malloc(sizeof(double) * (numEdges + 1));
+            for (int i = 0; i < numEdges; i++) mp->edgeFare[i] = edges[i].distance * mp->rate[edges[i].mode];
+            tables++;
+        }
+
+        if (!mp->edgeMinutes) 
+        {
+            mp->edgeMinutes = malloc(sizeof(double) * (numEdges + 1));
+            for (int i = 0; i < numEdges; i++) mp->edgeMinutes[i] = (edges[i].distance / mp->speed[edges[i].mode]) * 60.0;
+            tables++;
+        }
+    }
+
+    g->modeProfiles = profiles;
+    printf("Mode profiles: %d rows, %d edge tables (%.0f KB) in %.1f ms\n", applied < 0 ? 0 : applied, tables,
+           tables * sizeof(double) * (numEdges + 1.0) / 1024.0, monotonicMs() - startMs);
+
+    return applied;
+}
+
+void freeModeProfiles(Graph *g) {
+
+    ModeProfile *profiles = g->modeProfiles;
+    if (!profiles) return;
+
+    for (int p = 1; p <= NUM_PROBLEMS; p++) 
+    {
+        int fareOwner = 1, minutesOwner = 1;
+
+        for (int q = 1; q < p; q++) 
+        {
+            if (profiles[q].edgeFare == profiles[p].edgeFare) fareOwner = 0;
+            if (profiles[q].edgeMinutes == profiles[p].edgeMinutes) minutesOwner = 0;
+        }
+
+        if (fareOwner) free(profiles[p].edgeFare);
+        if (minutesOwner) free(profiles[p].edgeMinutes);
+    }
+
+    free(profiles);
+    g->modeProfiles = NULL;
+}
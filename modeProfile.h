@@ -0,0 +1,39 @@
+#ifndef modeProfile_H
+#define modeProfile_H
+
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "speedProfile.h"
+
+#define NUM_PROBLEMS 6
+
+// What a problem charges and how fast it moves on each mode, read from the mode profile
+// file with the graph. edgeFare and edgeMinutes are those numbers worked out per edge at
+// load time; problems with the same rates (or speeds) share one array.
+typedef struct ModeProfile 
+{
+    double rate[NUM_MODES];         // Taka per km
+    double speed[NUM_MODES];        // km/h at free flow
+    double *edgeFare;               // distance * rate of the edge's mode
+    double *edgeMinutes;            // at free flow, speed profiles and traffic come on top
+} ModeProfile;
+
+int loadModeProfiles(Graph *g, const char *filename);
+void freeModeProfiles(Graph *g);
+
+static inline const ModeProfile *getModeProfile(int problem) {
+
+    return &activeGraph->modeProfiles[problem];
+}
+
+// Minutes to ride edgeIdx leaving at departMin: the table for flat edges, the speed
+// profile integration for the time-dependent ones
+static inline double modeEdgeMin(const ModeProfile *mp, int edgeIdx, double departMin) {
+
+    int profile = edgeProfile[edgeIdx];
+    if (profile == 0) return mp->edgeMinutes[edgeIdx];
+
+    return profileTravelMin(profile, mp->speed[edges[edgeIdx].mode], edges[edgeIdx].distance, departMin);
+}
+
+#endif
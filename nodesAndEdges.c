@@ -1,18 +1,56 @@
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "nodesAndEdges.h"
 #include "mode.h"
+#include "speedProfile.h"
+#include "timeHandling.h"
 
-double dist[MAX_NODES];
-int prev[MAX_NODES];
-int visited[MAX_NODES];
-int prevEdge[MAX_NODES];
+__thread Graph *activeGraph = NULL;
+__thread Node *nodes = NULL;
+__thread Edge *edges = NULL;
+__thread ShapePoint *shapePoints = NULL;
+__thread int *adjStart = NULL;
+__thread int *adjList = NULL;
+__thread int *profileAdjStart[NUM_PROFILES];
+__thread int *profileAdjList[NUM_PROFILES];
 
-Node nodes[MAX_NODES];
-Edge edges[MAX_NODES*10];
+__thread int numNodes = 0;
+__thread int numEdges = 0;
+__thread int numShapePoints = 0;
+int graphVersion = 0;
 
-int numNodes = 0;
-int numEdges = 0;
+// Points this thread's views at g, NULL clears them
+void useGraph(Graph *g) {
+
+    activeGraph = g;
+    nodes = g ? g->nodes : NULL;
+    edges = g ? g->edges : NULL;
+    shapePoints = g ? g->shapePoints : NULL;
+    adjStart = g ? g->adjStart : NULL;
+    adjList = g ? g->adjList : NULL;
+    for (int p = 0; p < NUM_PROFILES; p++) 
+    {
+        profileAdjStart[p] = g ? g->viewStart[p] : NULL;
+        profileAdjList[p] = g ? g->viewList[p] : NULL;
+    }
+    edgeProfile = g ? g->edgeProfile : NULL;
+    speedProfiles = g ? g->speedProfiles : NULL;
+    numNodes = g ? g->numNodes : 0;
+    numEdges = g ? g->numEdges : 0;
+    numShapePoints = g ? g->numShapePoints : 0;
+    numSpeedProfiles = g ? g->numSpeedProfiles : 0;
+}
+
+// The builder grows the counts through the views, this writes them back
+void saveGraphCounts(Graph *g) {
+
+    g->numNodes = numNodes;
+    g->numEdges = numEdges;
+    g->numShapePoints = numShapePoints;
+    g->numSpeedProfiles = numSpeedProfiles;
+}
 
 int findOrAddNode(double lat, double lon) {
 
@@ -52,6 +90,14 @@ int findNearestNode(double lat, double lon) {               // self explanatory
     return best;
 }
 
+int isNamedStation(int node) {                // parsers only rename the stops at the ends of each route line
+
+    char defaultName[32];
+    snprintf(defaultName, sizeof(defaultName), "Node%d", nodes[node].id);
+
+    return strcmp(nodes[node].name, defaultName) != 0;
+}
+
 double haversineDistance(double lat1, double lon1, double lat2, double lon2) {
 
     double dLat = (lat2 - lat1) * PI / 180.0;
@@ -74,5 +120,83 @@ void addEdge(int from, int to, Mode mode, double distance) {
     edges[numEdges].distance = distance;
     edges[numEdges].cost = 0;
     edges[numEdges].speed = 30;
+    edges[numEdges].shapeStart = 0;
+    edges[numEdges].shapeCount = 0;
     numEdges++;
-}
\ No newline at end of file
+}
+
+void buildAdjacency() {             // has to be called again whenever edges[] changes
+
+    for (int i = 0; i <= numNodes; i++) adjStart[i] = 0;
+    for (int i = 0; i < numEdges; i++) adjStart[edges[i].from + 1]++;
+    for (int i = 0; i < numNodes; i++) adjStart[i + 1] += adjStart[i];
+
+    int *fill = malloc(sizeof(int) * (numNodes + 1));      // reloads build on their own thread
+    for (int i = 0; i < numNodes; i++) fill[i] = adjStart[i];
+    for (int i = 0; i < numEdges; i++) adjList[fill[edges[i].from]++] = i;
+    free(fill);
+}
+
+// Filtered copies of the adjacency so a solver's relax loop never looks at a mode it cannot
+// use. A profile that takes every mode in the graph points at adjStart/adjList instead.
+// Runs on g's views, after the adjacency is final.
+void buildProfileViews(Graph *g) {
+
+    double startMs = monotonicMs();
+    unsigned present = 0;
+
+    for (int i = 0; i < numEdges; i++) present |= MODE_BIT(edges[i].mode);
+
+    printf("Adjacency views:");
+
+    for (int p = 0; p < NUM_PROFILES; p++) 
+    {
+        unsigned modes = profileModes((RouteProfile)p);
+
+        if ((present & ~modes) == 0) 
+        {
+            g->viewStart[p] = g->adjStart;
+            g->viewList[p] = g->adjList;
+            printf(" %s shared (0 KB)%s", getProfileName((RouteProfile)p), p + 1 < NUM_PROFILES ? "," : "");
+            continue;
+        }
+
+        int *start = malloc(sizeof(int) * (numNodes + 1));
+        int count = 0;
+
+        for (int u = 0; u < numNodes; u++) 
+        {
+            start[u] = count;
+            for (int k = adjStart[u]; k < adjStart[u + 1]; k++) 
+            {
+                if (modes & MODE_BIT(edges[adjList[k]].mode)) count++;
+            }
+        }
+        start[numNodes] = count;
+
+        int *list = malloc(sizeof(int) * (count + 1));
+        int fill = 0;
+
+        for (int k = 0; k < adjStart[numNodes]; k++) 
+        {
+            if (modes & MODE_BIT(edges[adjList[k]].mode)) list[fill++] = adjList[k];
+        }
+
+        g->viewStart[p] = start;
+        g->viewList[p] = list;
+        printf(" %s %d edges (%.0f KB)%s", getProfileName((RouteProfile)p), count,
+               (sizeof(int) * (numNodes + 1.0 + count)) / 1024.0, p + 1 < NUM_PROFILES ? "," : "");
+    }
+
+    printf(" in %.1f ms\n", monotonicMs() - startMs);
+}
+
+void freeProfileViews(Graph *g) {
+
+    for (int p = 0; p < NUM_PROFILES; p++) 
+    {
+        if (g->viewStart[p] != g->adjStart) free(g->viewStart[p]);
+        if (g->viewList[p] != g->adjList) free(g->viewList[p]);
+        g->viewStart[p] = g->viewList[p] = NULL;
+    }
+}
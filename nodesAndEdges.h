@@ -4,13 +4,9 @@
 #include "mode.h"
 
 #define MAX_NODES 100000
+#define MAX_SHAPE_POINTS (MAX_NODES*10)
 #define INF 9999999999.0
 
-extern double dist[MAX_NODES];
-extern int prev[MAX_NODES];
-extern int visited[MAX_NODES];
-extern int prevEdge[MAX_NODES]; 
-
 typedef struct 
 {
     int from;
@@ -19,8 +15,16 @@ typedef struct
     double distance;  
     double cost;      
     double speed;     
+    int shapeStart;   // interior geometry of a contracted chain, in from -> to order
+    int shapeCount;
 } Edge;
 
+typedef struct
+{
+    double lat;
+    double lon;
+} ShapePoint;
+
 typedef struct 
 {
     int id;
@@ -29,15 +33,69 @@ typedef struct
     double lon;
 } Node;
 
-extern Node nodes[MAX_NODES];
-extern Edge edges[MAX_NODES*10];
+typedef struct 
+{
+    int startMin;
+    int endMin;
+    int intervalMin;
+} ServiceSchedule;
+
+// One immutable version of everything a query reads. A thread pins a version for the
+// length of a query (graphLoad.h) and the views below point into it, so the code keeps
+// indexing nodes[] and edges[] while a reload builds the next version on the side.
+typedef struct Graph 
+{
+    Node *nodes;
+    Edge *edges;
+    ShapePoint *shapePoints;
+    int *adjStart;
+    int *adjList;
+    int *viewStart[NUM_PROFILES];                   // per profile adjacency, same layout as adjStart/adjList
+    int *viewList[NUM_PROFILES];                    // and the same edge ids; a profile using every mode shares them
+    unsigned char *edgeProfile;
+    struct SpeedProfile *speedProfiles;
+    int numNodes;
+    int numEdges;
+    int numShapePoints;
+    int numSpeedProfiles;
+    ServiceSchedule schedule[NUM_MODES];            // problems 4 and 5
+    ServiceSchedule problem6Schedule[NUM_MODES];
+    struct Timetable *timetables;                   // departures per service set, see timetable.h
+    int id;
+    int refs;                                       // pinned threads, guarded by the graph lock
+    struct Graph *retiredNext;
+    struct TrafficSnapshot *traffic;                // live weights, owned by traffic.c
+    struct PointIndex *trafficIndex;
+    struct SnapIndex *snap;                         // roads and stops for snapping, see snap.h
+    struct Components *components;                  // per profile connectivity, see components.h
+    struct ModeProfile *modeProfiles;               // fares and speeds, indexed by problem number
+    struct Hierarchy *hierarchy;                    // car contraction hierarchy, built on first use
+    struct Overlay *overlay;                        // car cells and their cliques, see overlay.h
+} Graph;
+
+extern __thread Graph *activeGraph;
+extern __thread Node *nodes;
+extern __thread Edge *edges;
+extern __thread ShapePoint *shapePoints;
+extern __thread int *adjStart;          // out-edges of node u are adjList[adjStart[u] .. adjStart[u+1]-1]
+extern __thread int *adjList;
+extern __thread int *profileAdjStart[NUM_PROFILES];     // only the edges of the profile's modes, in adjList order
+extern __thread int *profileAdjList[NUM_PROFILES];
 
-extern int numNodes;
-extern int numEdges;
+extern __thread int numNodes;
+extern __thread int numEdges;
+extern __thread int numShapePoints;
+extern int graphVersion;         // bumped whenever a graph is published or its weights change
 
 int findOrAddNode(double lat, double lon);
 int findNearestNode(double lat, double lon);
+int isNamedStation(int node);
 void addEdge(int from, int to, Mode mode, double distance);
+void buildAdjacency();
+void buildProfileViews(Graph *g);
+void freeProfileViews(Graph *g);
+void useGraph(Graph *g);
+void saveGraphCounts(Graph *g);
 double haversineDistance(double lat1, double lon1, double lat2, double lon2);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,781 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "timeHandling.h"
+#include "search.h"
+#include "snap.h"
+#include "components.h"
+#include "scheduler.h"
+#include "overlay.h"
+
+// How a query node was reached over a clique arc of a level, next to edge ids and ARC_CODEs
+#define CLIQUE_CODE(level) (-1000 - (level))
+#define IS_CLIQUE_CODE(code) ((code) <= -1000)
+#define CLIQUE_LEVEL(code) (-1000 - (code))
+
+#define INERTIAL_DIRECTIONS 4
+
+// Undirected unit capacity view of the car network for the min cuts. Arc a and
+// twin[a] are the two directions of one edge, flow[a] == -flow[twin[a]].
+typedef struct 
+{
+    int *arcStart;
+    int *arcTo;
+    int *twin;
+    signed char *flow;
+    int *member;                // == memberStamp while the node is in the cell being split
+    int memberStamp;
+    int *visit;                 // == visitStamp once this search reached the node
+    int visitStamp;
+    int *parentArc;
+    int *queue;
+    char *role;                 // 1 tied to the source side, 2 to the sink side
+    char *side;                 // 1 on the source side of the best cut so far
+    int *scratch;
+    Overlay *overlay;
+} Partitioner;
+
+typedef struct 
+{
+    double key;
+    int node;
+} Projected;
+
+static pthread_mutex_t overlayLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void initPartitioner(Partitioner *p, Overlay *o) {
+
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+
+    memset(p, 0, sizeof(*p));
+    p->overlay = o;
+    p->arcStart = calloc(numNodes + 1, sizeof(int));
+
+    for (int u = 0; u < numNodes; u++) 
+    {
+        for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+        {
+            int v = edges[carList[k]].to;
+            if (v == u) continue;
+            p->arcStart[u + 1]++;
+            p->arcStart[v + 1]++;
+        }
+    }
+    for (int u = 0; u < numNodes; u++) p->arcStart[u + 1] += p->arcStart[u];
+
+    int numArcs = p->arcStart[numNodes];
+    int *fill = malloc(sizeof(int) * (numNodes + 1));
+    memcpy(fill, p->arcStart, sizeof(int) * (numNodes + 1));
+    p->arcTo = malloc(sizeof(int) * (numArcs + 1));
+    p->twin = malloc(sizeof(int) * (numArcs + 1));
+    p->flow = calloc(numArcs + 1, 1);
+
+    for (int u = 0; u < numNodes; u++) 
+    {
+        for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+        {
+            int v = edges[carList[k]].to;
+            if (v == u) continue;
+
+            int a = fill[u]++;
+            int b = fill[v]++;
+            p->arcTo[a] = v;
+            p->arcTo[b] = u;
+            p->twin[a] = b;
+            p->twin[b] = a;
+        }
+    }
+    free(fill);
+
+    p->member = calloc(numNodes + 1, sizeof(int));
+    p->visit = calloc(numNodes + 1, sizeof(int));
+    p->parentArc = malloc(sizeof(int) * (numNodes + 1));
+    p->queue = malloc(sizeof(int) * (numNodes + 1));
+    p->role = calloc(numNodes + 1, 1);
+    p->side = calloc(numNodes + 1, 1);
+    p->scratch = malloc(sizeof(int) * (numNodes + 1));
+}
+
+static void freePartitioner(Partitioner *p) {
+
+    free(p->arcStart);
+    free(p->arcTo);
+    free(p->twin);
+    free(p->flow);
+    free(p->member);
+    free(p->visit);
+    free(p->parentArc);
+    free(p->queue);
+    free(p->role);
+    free(p->side);
+    free(p->scratch);
+}
+
+static int compareProjected(const void *a, const void *b) {
+
+    const Projected *x = (const Projected *)a;
+    const Projected *y = (const Projected *)b;
+
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->node - y->node;
+}
+
+// Breadth first from every source-side node over arcs with room left, inside the cell.
+// Returns the first sink-side node it reaches, -1 when none is left reachable.
+static int searchAugmenting(Partitioner *p, const Projected *sorted, int ties) {
+
+    int head = 0, tail = 0;
+    p->visitStamp++;
+
+    for (int s = 0; s < ties; s++) 
+    {
+        int v = sorted[s].node;
+        p->visit[v] = p->visitStamp;
+        p->parentArc[v] = -1;
+        p->queue[tail++] = v;
+    }
+
+    while (head < tail) 
+    {
+        int u = p->queue[head++];
+
+        for (int a = p->arcStart[u]; a < p->arcStart[u + 1]; a++) 
+        {
+            int w = p->arcTo[a];
+            if (p->member[w] != p->memberStamp || p->visit[w] == p->visitStamp || p->flow[a] >= 1) continue;
+
+            p->visit[w] = p->visitStamp;
+            p->parentArc[w] = a;
+            if (p->role[w] == 2) return w;
+            p->queue[tail++] = w;
+        }
+    }
+
+    return -1;
+}
+
+// Inertial flow along one direction: nodes sorted by their projection, the first and last
+// OVERLAY_FLOW_SHARE tied to either side, then a unit capacity max flow between them.
+// The source side of the min cut is left in visit[] == visitStamp. Returns the cut size.
+static int inertialCut(Partitioner *p, const int *list, int count, double angle, Projected *sorted) {
+
+    double cosLat = cos(nodes[list[0]].lat * PI / 180.0);
+    double dx = cos(angle), dy = sin(angle);
+
+    for (int k = 0; k < count; k++) 
+    {
+        int v = list[k];
+        sorted[k].key = nodes[v].lon * cosLat * dx + nodes[v].lat * dy;
+        sorted[k].node = v;
+        p->role[v] = 0;
+        for (int a = p->arcStart[v]; a < p->arcStart[v + 1]; a++) p->flow[a] = 0;
+    }
+    qsort(sorted, count, sizeof(Projected), compareProjected);
+
+    int ties = (int)(count * OVERLAY_FLOW_SHARE);
+    if (ties < 1) ties = 1;
+    for (int k = 0; k < ties; k++) 
+    {
+        p->role[sorted[k].node] = 1;
+        p->role[sorted[count - 1 - k].node] = 2;
+    }
+
+    int cut = 0, sink;
+    while ((sink = searchAugmenting(p, sorted, ties)) != -1) 
+    {
+        for (int w = sink; p->parentArc[w] != -1; ) 
+        {
+            int a = p->parentArc[w];
+            p->flow[a]++;
+            p->flow[p->twin[a]]--;
+            w = p->arcTo[p->twin[a]];
+        }
+        cut++;
+    }
+
+    return cut;
+}
+
+// Reorders list so the source side of the best of the directions' cuts comes first and
+// returns its size
+static int bisectCell(Partitioner *p, int *list, int count) {
+
+    Projected *sorted = malloc(sizeof(Projected) * count);
+    int bestCut = -1;
+    int bestSize = 0;
+
+    p->memberStamp++;
+    for (int k = 0; k < count; k++) p->member[list[k]] = p->memberStamp;
+
+    for (int d = 0; d < INERTIAL_DIRECTIONS; d++) 
+    {
+        int cut = inertialCut(p, list, count, d * PI / INERTIAL_DIRECTIONS, sorted);
+        int size = 0;
+        for (int k = 0; k < count; k++) size += p->visit[list[k]] == p->visitStamp;
+
+        int balance = abs(2 * size - count), bestBalance = abs(2 * bestSize - count);
+        if (bestCut >= 0 && (cut > bestCut || (cut == bestCut && balance >= bestBalance))) continue;
+
+        bestCut = cut;
+        bestSize = size;
+        for (int k = 0; k < count; k++) p->side[list[k]] = p->visit[list[k]] == p->visitStamp;
+    }
+
+    int front = 0, back = bestSize;
+    for (int k = 0; k < count; k++) 
+    {
+        int v = list[k];
+        p->scratch[p->side[v] ? front++ : back++] = v;
+    }
+    memcpy(list, p->scratch, sizeof(int) * count);
+
+    free(sorted);
+    return bestSize;
+}
+
+// Cuts list down to cells of the level's size, then each of those for the level below
+static void splitCell(Partitioner *p, int *list, int count, int level, const int limit[]) {
+
+    if (count > limit[level]) 
+    {
+        int half = bisectCell(p, list, count);
+        splitCell(p, list, half, level, limit);
+        splitCell(p, list + half, count - half, level, limit);
+        return;
+    }
+
+    Overlay *o = p->overlay;
+    int id = o->numCells[level]++;
+    for (int k = 0; k < count; k++) o->cell[level][list[k]] = id;
+
+    if (level > 0) splitCell(p, list, count, level - 1, limit);
+}
+
+// Boundary lists and clique offsets of every level, once the cells are known
+static void findBoundaries(Overlay *o) {
+
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        int *cell = o->cell[l];
+        char *isBoundary = calloc(numNodes + 1, 1);
+
+        for (int u = 0; u < numNodes; u++) 
+        {
+            for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+            {
+                int v = edges[carList[k]].to;
+                if (cell[u] == cell[v]) continue;
+
+                isBoundary[u] = isBoundary[v] = 1;
+                o->cutEdges[l]++;
+            }
+        }
+
+        o->boundaryStart[l] = calloc(o->numCells[l] + 1, sizeof(int));
+        o->boundaryIndex[l] = malloc(sizeof(int) * (numNodes + 1));
+
+        for (int v = 0; v < numNodes; v++) 
+        {
+            o->boundaryIndex[l][v] = -1;
+            if (isBoundary[v]) o->boundaryStart[l][cell[v] + 1]++;
+        }
+        for (int c = 0; c < o->numCells[l]; c++) o->boundaryStart[l][c + 1] += o->boundaryStart[l][c];
+
+        o->numBoundary[l] = o->boundaryStart[l][o->numCells[l]];
+        o->boundary[l] = malloc(sizeof(int) * (o->numBoundary[l] + 1));
+        int *fill = malloc(sizeof(int) * (o->numCells[l] + 1));
+        memcpy(fill, o->boundaryStart[l], sizeof(int) * (o->numCells[l] + 1));
+
+        for (int v = 0; v < numNodes; v++) 
+        {
+            if (!isBoundary[v]) continue;
+            o->boundaryIndex[l][v] = fill[cell[v]] - o->boundaryStart[l][cell[v]];
+            o->boundary[l][fill[cell[v]]++] = v;
+        }
+
+        o->cliqueStart[l] = malloc(sizeof(int) * (o->numCells[l] + 1));
+        int size = 0;
+        for (int c = 0; c < o->numCells[l]; c++) 
+        {
+            int b = o->boundaryStart[l][c + 1] - o->boundaryStart[l][c];
+            o->cliqueStart[l][c] = size;
+            size += b * b;
+        }
+        o->cliqueStart[l][o->numCells[l]] = size;
+        o->cliqueSize[l] = size;
+
+        free(fill);
+        free(isBoundary);
+    }
+}
+
+static void allocMetric(const Overlay *o, OverlayMetric *m) {
+
+    for (int l = 0; l < OVERLAY_LEVELS; l++) m->clique[l] = malloc(sizeof(double) * (o->cliqueSize[l] + 1));
+    m->graphId = -1;
+    m->trafficVersion = -1;
+    m->customizeMs = 0.0;
+}
+
+void freeOverlayMetric(OverlayMetric *m) {
+
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        free(m->clique[l]);
+        m->clique[l] = NULL;
+    }
+}
+
+static inline void relaxCell(SearchSpace *space, int v, double d) {
+
+    touchNode(space, v);
+    if (d >= space->dist[v]) return;
+
+    space->dist[v] = d;
+    heapPush(space, d, v);
+}
+
+// Clique of cell c of a level: a search from each boundary node that stays in the cell. Level 0
+// runs on the road edges, higher levels on the cliques of the level below and the road edges
+// between its cells.
+static void customizeCell(const Overlay *o, OverlayMetric *m, const TrafficSnapshot *t, int level, int c, SearchSpace *space) {
+
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+    const int *cell = o->cell[level];
+    const int *bnd = o->boundary[level] + o->boundaryStart[level][c];
+    int b = o->boundaryStart[level][c + 1] - o->boundaryStart[level][c];
+    double *clique = m->clique[level] + o->cliqueStart[level][c];
+
+    for (int i = 0; i < b; i++) 
+    {
+        beginSearch(space);
+        relaxCell(space, bnd[i], 0.0);
+
+        double key;
+        int u;
+
+        while ((u = heapPop(space, &key)) != -1) 
+        {
+            if (key > space->dist[u]) continue;
+
+            int sub = level > 0 ? o->cell[level - 1][u] : -1;
+
+            if (level > 0) 
+            {
+                int first = o->boundaryStart[level - 1][sub];
+                int bs = o->boundaryStart[level - 1][sub + 1] - first;
+                const double *row = m->clique[level - 1] + o->cliqueStart[level - 1][sub] + (size_t)o->boundaryIndex[level - 1][u] * bs;
+
+                for (int j = 0; j < bs; j++) 
+                {
+                    if (row[j] < INF) relaxCell(space, o->boundary[level - 1][first + j], key + row[j]);
+                }
+            }
+
+            for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+            {
+                int e = carList[k];
+                int v = edges[e].to;
+                if (cell[v] != c || (level > 0 && o->cell[level - 1][v] == sub)) continue;
+                if (t && isEdgeClosed(t, e)) continue;
+
+                relaxCell(space, v, key + edges[e].distance);
+            }
+        }
+
+        for (int j = 0; j < b; j++) clique[(size_t)i * b + j] = searchDist(space, bnd[j]);
+    }
+}
+
+typedef struct 
+{
+    const Overlay *overlay;
+    OverlayMetric *metric;
+    const TrafficSnapshot *traffic;
+    int level;
+} CustomizeJob;
+
+static void customizeTask(void *arg, int c, SearchSpace *space) {
+
+    CustomizeJob *job = (CustomizeJob *)arg;
+    customizeCell(job->overlay, job->metric, job->traffic, job->level, c, space);
+}
+
+// Every clique from scratch, level by level, the cells of a level as tasks. t NULL opens every road.
+void customizeOverlay(const Overlay *o, const TrafficSnapshot *t, OverlayMetric *m, int numWorkers) {
+
+    double startMs = monotonicMs();
+
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        CustomizeJob job = { o, m, t, l };
+        runTasks(customizeTask, &job, o->numCells[l], numWorkers, NULL);
+    }
+
+    m->customizeMs = monotonicMs() - startMs;
+}
+
+// The base cliques with only the cells holding a closed road redone, plus the cells above
+// them. Returns how many cells that was.
+int recustomizeOverlay(const Overlay *o, const TrafficSnapshot *t, OverlayMetric *m) {
+
+    static __thread SearchSpace space;          // empty until the first beginSearch sizes it
+    double startMs = monotonicMs();
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+    char *dirty[OVERLAY_LEVELS];
+    int redone = 0;
+
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        memcpy(m->clique[l], o->base.clique[l], sizeof(double) * o->cliqueSize[l]);
+        dirty[l] = calloc(o->numCells[l] + 1, 1);
+    }
+
+    for (int u = 0; u < numNodes; u++) 
+    {
+        for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+        {
+            int e = carList[k];
+            if (!isEdgeClosed(t, e)) continue;
+
+            for (int l = 0; l < OVERLAY_LEVELS; l++)            // the cells the edge is inside of 
+            {
+                if (o->cell[l][u] == o->cell[l][edges[e].to]) dirty[l][o->cell[l][u]] = 1;
+            }
+        }
+    }
+
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        for (int c = 0; c < o->numCells[l]; c++) 
+        {
+            if (!dirty[l][c]) continue;
+            customizeCell(o, m, t, l, c, &space);
+            redone++;
+        }
+        free(dirty[l]);
+    }
+
+    m->customizeMs = monotonicMs() - startMs;
+    return redone;
+}
+
+static Overlay *buildOverlay() {
+
+    double startMs = monotonicMs();
+    Overlay *o = calloc(1, sizeof(Overlay));
+    Partitioner p;
+    int limit[OVERLAY_LEVELS];
+
+    o->numNodes = numNodes;
+    limit[0] = OVERLAY_CELL_NODES;
+    for (int l = 1; l < OVERLAY_LEVELS; l++) limit[l] = limit[l - 1] * OVERLAY_FANOUT;
+    for (int l = 0; l < OVERLAY_LEVELS; l++) o->cell[l] = malloc(sizeof(int) * (numNodes + 1));
+
+    initPartitioner(&p, o);
+    int *list = malloc(sizeof(int) * (numNodes + 1));
+    for (int v = 0; v < numNodes; v++) list[v] = v;
+    splitCell(&p, list, numNodes, OVERLAY_LEVELS - 1, limit);
+    free(list);
+    freePartitioner(&p);
+
+    findBoundaries(o);
+    o->partitionMs = monotonicMs() - startMs;
+
+    allocMetric(o, &o->base);
+    customizeOverlay(o, NULL, &o->base, defaultWorkers());
+
+    printf("Overlay:");
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        printf(" level %d %d cells, %d boundary nodes, %d cut edges%s", l, o->numCells[l], o->numBoundary[l],
+               o->cutEdges[l], l + 1 < OVERLAY_LEVELS ? "," : "");
+    }
+    printf(" (partition %.1f ms, customization %.1f ms)\n", o->partitionMs, o->base.customizeMs);
+
+    return o;
+}
+
+// Built for the active version the first time a query wants it
+const Overlay *carOverlay() {
+
+    Graph *g = activeGraph;
+    Overlay *o = __atomic_load_n(&g->overlay, __ATOMIC_ACQUIRE);
+    if (o) return o;
+
+    pthread_mutex_lock(&overlayLock);
+
+    if (!g->overlay) __atomic_store_n(&g->overlay, buildOverlay(), __ATOMIC_RELEASE);
+    o = g->overlay;
+
+    pthread_mutex_unlock(&overlayLock);
+    return o;
+}
+
+void freeOverlay(Graph *g) {
+
+    Overlay *o = g->overlay;
+    if (!o) return;
+
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        free(o->cell[l]);
+        free(o->boundaryStart[l]);
+        free(o->boundary[l]);
+        free(o->boundaryIndex[l]);
+        free(o->cliqueStart[l]);
+    }
+    freeOverlayMetric(&o->base);
+    free(o);
+    g->overlay = NULL;
+}
+
+// The base metric while every road is open, otherwise this thread's own copy redone for
+// the snapshot the query runs on
+static const OverlayMetric *queryMetric(const Overlay *o, const TrafficSnapshot *t) {
+
+    static __thread OverlayMetric live;
+    static __thread const Overlay *liveOverlay = NULL;
+
+    if (t->numClosed == 0) return &o->base;
+    if (liveOverlay == o && live.graphId == activeGraph->id && live.trafficVersion == t->version) return &live;
+
+    if (liveOverlay != o || live.graphId != activeGraph->id) 
+    {
+        freeOverlayMetric(&live);
+        allocMetric(o, &live);
+        liveOverlay = o;
+    }
+
+    recustomizeOverlay(o, t, &live);
+    live.graphId = activeGraph->id;
+    live.trafficVersion = t->version;
+    return &live;
+}
+
+// Highest level whose cell of v holds neither end of the query; 0 means v is scanned on
+// the road edges, level l on the cliques of level l-1
+static int queryLevel(const Overlay *o, int v, const int ends[], int numEnds) {
+
+    for (int l = OVERLAY_LEVELS - 1; l >= 0; l--) 
+    {
+        int c = o->cell[l][v];
+        int shared = 0;
+
+        for (int e = 0; e < numEnds && !shared; e++) shared = o->cell[l][ends[e]] == c;
+        if (!shared) return l + 1;
+    }
+
+    return 0;
+}
+
+static inline void relaxQuery(SearchSpace *space, int u, int v, double d, int code) {
+
+    touchNode(space, v);
+    if (d >= space->dist[v]) return;
+
+    space->dist[v] = d;
+    space->prev[v] = u;
+    space->prevEdge[v] = code;
+    heapPush(space, d, v);
+    STAT_INC(&space->stats, edgesRelaxed);
+}
+
+// The road edges behind a clique arc from -> to of a level: a search inside their cell.
+// Writes to .. back to just after from, target first, and returns how many.
+static int unpackClique(const Overlay *o, const TrafficSnapshot *t, int level, int from, int to, int path[], int pathEdges[]) {
+
+    static __thread SearchSpace space;
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+    int c = o->cell[level][from];
+
+    beginSearch(&space);
+    touchNode(&space, from);
+    space.dist[from] = 0.0;
+    heapPush(&space, 0.0, from);
+
+    double key;
+    int u;
+
+    while ((u = heapPop(&space, &key)) != -1 && u != to) 
+    {
+        if (key > space.dist[u]) continue;
+
+        for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+        {
+            int e = carList[k];
+            if (o->cell[level][edges[e].to] != c || isEdgeClosed(t, e)) continue;
+            relaxQuery(&space, u, edges[e].to, key + edges[e].distance, e);
+        }
+    }
+
+    int count = 0;
+    for (int at = to; at != from; at = space.prev[at]) 
+    {
+        path[count] = at;
+        pathEdges[count] = space.prevEdge[at];
+        count++;
+    }
+
+    return count;
+}
+
+// Problem 1 runs on the overlay only when asked: export ROUTE_OVERLAY=1
+int overlayEnabled() {
+
+    static int enabled = -1;
+
+    if (enabled < 0) 
+    {
+        const char *env = getenv("ROUTE_OVERLAY");
+        enabled = env && *env && strcmp(env, "0") != 0;
+    }
+
+    return enabled;
+}
+
+// Car distance between two snapped points, like solveProblem1, but only the cells holding
+// either end are searched on the roads; everywhere else the search rides the cliques of the
+// highest level that keeps clear of both ends. Fills path[] the same way.
+int overlayRoute(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total) {
+
+    if (!mayReach(PROFILE_CAR, from, to)) 
+    {
+        *total = INF;
+        return 0;
+    }
+
+    const Overlay *o = carOverlay();
+
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+
+    const OverlayMetric *m = queryMetric(o, space->traffic);
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+    int ends[2 * SNAP_MAX_ARCS];
+    int numEnds = 0;
+
+    for (int a = 0; a < from->numArcs; a++) ends[numEnds++] = from->arcs[a].node;
+    for (int a = 0; a < to->numArcs; a++) ends[numEnds++] = to->arcs[a].node;
+
+    markTargets(space, to);
+
+    for (int a = 0; a < from->numArcs; a++) 
+    {
+        const SnapArc *arc = &from->arcs[a];
+        if (isArcClosed(space->traffic, arc)) continue;
+        seedNode(space, arc->node, arcDistance(arc), 0, a);
+    }
+
+    SnapArc direct;
+    double directStart;
+    double best = INF;
+    int bestNode = -1;
+    int bestArc = -1;
+
+    if (snapDirectRide(from, to, &direct, &directStart) && !isArcClosed(space->traffic, &direct)) best = arcDistance(&direct);
+
+    double minDist;
+    int u;
+
+    while ((u = heapPop(space, &minDist)) != -1) 
+    {
+        if (space->settled[u] == 1 || minDist > space->dist[u]) continue;
+
+        if (space->settled[u] == 2) 
+        {
+            for (int a = 0; a < to->numArcs; a++) 
+            {
+                const SnapArc *arc = &to->arcs[a];
+                if (arc->node != u || isArcClosed(space->traffic, arc)) continue;
+
+                double finish = space->dist[u] + arcDistance(arc);
+                if (finish < best) 
+                {
+                    best = finish;
+                    bestNode = u;
+                    bestArc = a;
+                }
+            }
+        }
+        if (best <= minDist) break;
+
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
+
+        int level = queryLevel(o, u, ends, numEnds);
+        int c = level > 0 ? o->cell[level - 1][u] : -1;
+
+        if (level > 0)              // across the cell in one hop to each of its boundary nodes 
+        {
+            int l = level - 1;
+            int first = o->boundaryStart[l][c];
+            int b = o->boundaryStart[l][c + 1] - first;
+            const double *row = m->clique[l] + o->cliqueStart[l][c] + (size_t)o->boundaryIndex[l][u] * b;
+
+            for (int j = 0; j < b; j++) 
+            {
+                STAT_INC(&space->stats, edgesScanned);
+                int v = o->boundary[l][first + j];
+                if (v != u && row[j] < INF) relaxQuery(space, u, v, minDist + row[j], CLIQUE_CODE(l));
+            }
+        }
+
+        for (int k = carStart[u]; k < carStart[u + 1]; k++)       // out of the cell, or anywhere at level 0 
+        {
+            int i = carList[k];
+            int v = edges[i].to;
+            if (level > 0 && o->cell[level - 1][v] == c) continue;
+
+            STAT_INC(&space->stats, edgesScanned);
+            if (isEdgeClosed(space->traffic, i)) continue;
+            relaxQuery(space, u, v, minDist + edges[i].distance, i);
+        }
+    }
+
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    PHASE_BEGIN(path);
+
+    int pathLen = 0;
+    if (bestNode >= 0) 
+    {
+        path[0] = SNAP_POINT_NODE;
+        pathEdges[0] = ARC_CODE(bestArc);
+        pathLen = 1;
+
+        for (int at = bestNode; at != -1; ) 
+        {
+            int code = space->prevEdge[at];
+
+            if (IS_CLIQUE_CODE(code)) 
+            {
+                pathLen += unpackClique(o, space->traffic, CLIQUE_LEVEL(code), space->prev[at], at, path + pathLen, pathEdges + pathLen);
+                at = space->prev[at];
+                continue;
+            }
+
+            path[pathLen] = at;
+            pathEdges[pathLen] = code;
+            pathLen++;
+            at = space->prev[at];
+        }
+    }
+
+    *total = best;
+    PHASE_END(&space->stats, PHASE_PATH, path);
+    return pathLen;
+}
@@ -0,0 +1,51 @@
+#ifndef overlay_H
+#define overlay_H
+
+#include "nodesAndEdges.h"
+#include "search.h"
+#include "snap.h"
+#include "traffic.h"
+
+#define OVERLAY_LEVELS 3
+#define OVERLAY_CELL_NODES 256          // finest cells, each level up holds OVERLAY_FANOUT times more
+#define OVERLAY_FANOUT 8
+#define OVERLAY_FLOW_SHARE 0.25         // nodes tied to each side of an inertial flow cut
+
+// Weights of the overlay for one metric: per cell, the car distance between every pair of
+// its boundary nodes without leaving the cell. The partition never changes with the metric,
+// so closures only redo the cells they sit in.
+typedef struct OverlayMetric 
+{
+    double *clique[OVERLAY_LEVELS];     // per cell, row-major boundary x boundary, INF when there is no way through
+    int graphId;                        // what a live metric was customized for
+    int trafficVersion;
+    double customizeMs;
+} OverlayMetric;
+
+// Multi-level partition of the car network, level 0 finest. Every cell nests in one cell of
+// the level above. Boundary nodes of a level have a car edge to another cell of it.
+typedef struct Overlay 
+{
+    int numNodes;
+    int *cell[OVERLAY_LEVELS];              // node -> cell
+    int numCells[OVERLAY_LEVELS];
+    int *boundaryStart[OVERLAY_LEVELS];     // per cell, into boundary[]
+    int *boundary[OVERLAY_LEVELS];          // boundary nodes grouped by cell
+    int *boundaryIndex[OVERLAY_LEVELS];     // node -> its place in its cell's boundary, -1 inside
+    int *cliqueStart[OVERLAY_LEVELS];       // per cell, into a metric's clique[]
+    int cliqueSize[OVERLAY_LEVELS];
+    int numBoundary[OVERLAY_LEVELS];
+    int cutEdges[OVERLAY_LEVELS];           // car edges between cells
+    OverlayMetric base;                     // every road open
+    double partitionMs;
+} Overlay;
+
+const Overlay *carOverlay();
+void freeOverlay(Graph *g);
+void customizeOverlay(const Overlay *o, const TrafficSnapshot *t, OverlayMetric *m, int numWorkers);
+int recustomizeOverlay(const Overlay *o, const TrafficSnapshot *t, OverlayMetric *m);
+void freeOverlayMetric(OverlayMetric *m);
+int overlayEnabled();
+int overlayRoute(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total);
+
+#endif
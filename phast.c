@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "timeHandling.h"
+#include "search.h"
+#include "snap.h"
+#include "hierarchy.h"
+#include "matrix.h"
+#include "phast.h"
+#include "deltaStep.h"
+#include "scheduler.h"
+
+// One double per tree; GCC lowers the vector ops to whatever SIMD the target has
+typedef double PhastLanes __attribute__((vector_size(PHAST_LANES * sizeof(double))));
+
+// *best = min(*best, *candidate) lane by lane. Written as a compare and select per lane so
+// GCC turns it into minpd; a mask blend stays and/andn/or and made the sweep slower than
+// one tree at a time. Pointers, since passing 32 byte vectors by value is an ABI question
+// without AVX.
+static inline void lanesMin(PhastLanes *best, const PhastLanes *candidate) {
+
+    for (int lane = 0; lane < PHAST_LANES; lane++) 
+    {
+        (*best)[lane] = (*candidate)[lane] < (*best)[lane] ? (*candidate)[lane] : (*best)[lane];
+    }
+}
+
+// Car distance from a snapped point to every node, closures honoured. The reference the
+// hierarchy is checked against, and what phastTree falls back to while a road is closed.
+void dijkstraTree(SearchSpace *space, const SnapPoint *from, double dist[]) {
+
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+
+    for (int a = 0; a < from->numArcs; a++) 
+    {
+        if (isArcClosed(space->traffic, &from->arcs[a])) continue;
+        seedNode(space, from->arcs[a].node, arcDistance(&from->arcs[a]), 0, a);
+    }
+
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+    double key;
+    int u;
+
+    while ((u = heapPop(space, &key)) != -1) 
+    {
+        if (key > space->dist[u]) continue;
+        STAT_INC(&space->stats, nodesSettled);
+
+        for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+        {
+            STAT_INC(&space->stats, edgesScanned);
+            int i = carList[k];
+            if (isEdgeClosed(space->traffic, i)) continue;
+
+            int v = edges[i].to;
+            touchNode(space, v);
+            if (key + edges[i].distance < space->dist[v]) 
+            {
+                space->dist[v] = key + edges[i].distance;
+                heapPush(space, key + edges[i].distance, v);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
+    }
+
+    for (int v = 0; v < numNodes; v++) dist[v] = searchDist(space, v);
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+}
+
+// Dijkstra over the upward edges only, in sweep positions. The positions it settles are
+// left in reached[], with their distances in the search space.
+static int upwardSearch(SearchSpace *space, const Hierarchy *h, const SnapPoint *from, int reached[]) {
+
+    for (int a = 0; a < from->numArcs; a++) 
+    {
+        if (isArcClosed(space->traffic, &from->arcs[a])) continue;
+        seedNode(space, h->position[from->arcs[a].node], arcDistance(&from->arcs[a]), 0, a);
+    }
+
+    double key;
+    int p, count = 0;
+
+    while ((p = heapPop(space, &key)) != -1) 
+    {
+        if (key > space->dist[p]) continue;
+        STAT_INC(&space->stats, nodesSettled);
+        reached[count++] = p;
+
+        for (int e = h->upStart[p]; e < h->upStart[p + 1]; e++) 
+        {
+            STAT_INC(&space->stats, edgesScanned);
+            int q = h->upTo[e];
+            touchNode(space, q);
+            if (key + h->upWeight[e] < space->dist[q]) 
+            {
+                space->dist[q] = key + h->upWeight[e];
+                heapPush(space, key + h->upWeight[e], q);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
+    }
+
+    return count;
+}
+
+// Scratch kept per thread across trees
+static __thread double *sweepBuffer = NULL;
+static __thread PhastLanes *laneBuffer = NULL;
+static __thread int *reachedBuffer = NULL;
+static __thread int scratchNodes = 0;
+
+static void ensureScratch(int n) {
+
+    if (scratchNodes >= n) return;
+
+    free(sweepBuffer);
+    free(laneBuffer);
+    free(reachedBuffer);
+    sweepBuffer = malloc(sizeof(double) * (n + 1));
+    laneBuffer = aligned_alloc(sizeof(PhastLanes), sizeof(PhastLanes) * (n + 1));
+    reachedBuffer = malloc(sizeof(int) * (n + 1));
+    scratchNodes = n;
+}
+
+// PHAST: the upward search, then one pass over the nodes from the top of the hierarchy
+// down, each taking the best of its downward edges. Same distances as dijkstraTree.
+void phastTree(SearchSpace *space, const SnapPoint *from, double dist[]) {
+
+    const Hierarchy *h = carHierarchy();
+
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+
+    if (space->traffic->numClosed > 0)              // the shortcuts would ride through the closure
+    {
+        dijkstraTree(space, from, dist);
+        return;
+    }
+
+    PHASE_BEGIN(search);
+    int n = h->numNodes;
+    ensureScratch(n);
+    double *d = sweepBuffer;
+
+    for (int p = 0; p < n; p++) d[p] = INF;
+    int reached = upwardSearch(space, h, from, reachedBuffer);
+    for (int r = 0; r < reached; r++) d[reachedBuffer[r]] = space->dist[reachedBuffer[r]];
+
+    for (int p = 0; p < n; p++) 
+    {
+        double best = d[p];
+        for (int e = h->downStart[p]; e < h->downStart[p + 1]; e++) 
+        {
+            double candidate = d[h->downFrom[e]] + h->downWeight[e];
+            if (candidate < best) best = candidate;
+        }
+        d[p] = best;
+        dist[h->order[p]] = best;
+    }
+
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+}
+
+// Up to PHAST_LANES trees in one sweep, a lane each, so the lanes share each pass over the
+// downward edges; on the benchmark that is about 0.33 ms a tree against 0.47 for phastTree.
+// dist is row-major, one row per source.
+void phastTrees(SearchSpace *space, const SnapPoint from[], int count, double dist[]) {
+
+    const Hierarchy *h = carHierarchy();
+    int n = h->numNodes;
+
+    if (count > PHAST_LANES) count = PHAST_LANES;
+
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+
+    if (space->traffic->numClosed > 0) 
+    {
+        for (int t = 0; t < count; t++) dijkstraTree(space, &from[t], dist + (size_t)t * n);
+        return;
+    }
+
+    PHASE_BEGIN(search);
+    ensureScratch(n);
+    PhastLanes *d = laneBuffer;
+    PhastLanes unreached;
+
+    for (int lane = 0; lane < PHAST_LANES; lane++) unreached[lane] = INF;
+    for (int p = 0; p < n; p++) d[p] = unreached;
+
+    for (int t = 0; t < count; t++) 
+    {
+        if (t > 0) beginSearch(space);
+        int reached = upwardSearch(space, h, &from[t], reachedBuffer);
+        for (int r = 0; r < reached; r++) d[reachedBuffer[r]][t] = space->dist[reachedBuffer[r]];
+    }
+
+    for (int p = 0; p < n; p++) 
+    {
+        PhastLanes best = d[p];
+        for (int e = h->downStart[p]; e < h->downStart[p + 1]; e++) 
+        {
+            PhastLanes candidate = d[h->downFrom[e]] + h->downWeight[e];
+            lanesMin(&best, &candidate);
+        }
+        d[p] = best;
+    }
+
+    for (int t = 0; t < count; t++) 
+    {
+        double *row = dist + (size_t)t * n;
+        for (int p = 0; p < n; p++) row[h->order[p]] = d[p][t];
+    }
+
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+}
+
+typedef struct 
+{
+    const SnapPoint *sources;
+    int numSources;
+    double *out;
+} TreesJob;
+
+// Task g: sources g*PHAST_LANES onwards, one sweep
+static void treesGroup(void *arg, int group, SearchSpace *space) {
+
+    TreesJob *job = (TreesJob *)arg;
+    int s = group * PHAST_LANES;
+    int count = job->numSources - s < PHAST_LANES ? job->numSources - s : PHAST_LANES;
+
+    if (count == 1) phastTree(space, &job->sources[s], job->out + (size_t)s * numNodes);      // a lone tree sweeps faster alone
+    else phastTrees(space, &job->sources[s], count, job->out + (size_t)s * numNodes);
+}
+
+// main trees <sources.csv> <out.csv|out.bin> [threads]: car distance (km) from every source to
+// every node, one row per source in node order, -1 where unreachable. Sweeps of PHAST_LANES
+// trees are tasks for the threads; while a road is closed the hierarchy is out and each
+// tree is a delta-stepping search over the threads instead.
+int runTreesCommand(int argc, char **argv) {
+
+    if (argc < 2) 
+    {
+        printf("Usage: main trees <sources.csv> <out.csv|out.bin> [threads]\n");
+        return 1;
+    }
+
+    MatrixPoint *points = NULL;
+    int numSources = readMatrixPoints(argv[0], &points);
+
+    if (numSources <= 0) 
+    {
+        printf("Need at least one source point\n");
+        free(points);
+        return 1;
+    }
+
+    SnapPoint *sources = malloc(sizeof(SnapPoint) * numSources);
+    for (int s = 0; s < numSources; s++) 
+    {
+        if (snapSource(points[s].lat, points[s].lon, 0, &sources[s]) != 0) sources[s].numArcs = 0;
+    }
+
+    int numThreads = (argc > 2) ? atoi(argv[2]) : defaultWorkers();
+    SearchSpace space;
+    initSearchSpace(&space);
+    beginSearch(&space);
+    int closed = space.traffic->numClosed > 0;
+
+    double hierarchyMs = monotonicMs();
+    if (!closed) carHierarchy();
+    hierarchyMs = monotonicMs() - hierarchyMs;
+
+    double *out = malloc(sizeof(double) * (size_t)numSources * numNodes);
+    double startMs = monotonicMs();
+
+    for (int s = 0; closed && s < numSources; s++) 
+    {
+        deltaStepTree(&space, &sources[s], DELTA_STEP_KM, numThreads, out + (size_t)s * numNodes);
+    }
+
+    if (!closed) 
+    {
+        TreesJob job = { sources, numSources, out };
+        runTasks(treesGroup, &job, (numSources + PHAST_LANES - 1) / PHAST_LANES, numThreads, NULL);
+    }
+
+    double elapsed = monotonicMs() - startMs;
+    for (size_t i = 0; i < (size_t)numSources * numNodes; i++) 
+    {
+        if (out[i] >= INF) out[i] = -1.0;
+    }
+
+    int result = writeMatrix(argv[1], out, numSources, numNodes);
+    if (closed) printf("Computed %d trees over %d nodes in %.1f ms (%d closed roads, delta-stepping on %d threads)\n",
+                       numSources, numNodes, elapsed, space.traffic->numClosed, numThreads);
+    else printf("Computed %d trees over %d nodes with %d threads in %.1f ms (hierarchy %.1f ms)\n",
+                numSources, numNodes, numThreads, elapsed, hierarchyMs);
+
+    SchedulerStats stats;
+    schedulerTotals(&stats);
+    if (!closed) printSchedulerStats(&stats, stdout);
+
+    freeSearchSpace(&space);
+    free(out);
+    free(sources);
+    free(points);
+
+    return result == 0 ? 0 : 1;
+}
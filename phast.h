@@ -0,0 +1,14 @@
+#ifndef phast_H
+#define phast_H
+
+#include "search.h"
+#include "snap.h"
+
+#define PHAST_LANES 4               // trees swept together by phastTrees
+
+void dijkstraTree(SearchSpace *space, const SnapPoint *from, double dist[]);
+void phastTree(SearchSpace *space, const SnapPoint *from, double dist[]);
+void phastTrees(SearchSpace *space, const SnapPoint from[], int count, double dist[]);
+int runTreesCommand(int argc, char **argv);
+
+#endif
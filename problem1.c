@@ -4,63 +4,125 @@
 #include "mode.h"
 #include "nodesAndEdges.h"
 #include "csvParse.h"
+#include "routeExport.h"
+#include "itinerary.h"
+#include "routeCache.h"
+#include "search.h"
+#include "snap.h"
+#include "components.h"
+#include "overlay.h"
 
-void printProblem1Details(int path[], int pathLen, int source, int target, 
-                          double srcLat, double srcLon, double destLat, double destLon) {
-    double carRate = 20.0;
-    double totalDistance = 0.0;
-    double totalCost = 0.0;
+void printProblem1Details(const Itinerary *it) {
 
     printf("\nProblem No: 1\n");
-    printf("Source: (%.6f, %.6f)\n", srcLon, srcLat);
-    printf("Destination: (%.6f, %.6f)\n", destLon, destLat);
+    printf("Source: (%.6f, %.6f)\n", it->srcLon, it->srcLat);
+    printf("Destination: (%.6f, %.6f)\n", it->destLon, it->destLat);
     printf("\n");
 
-    if (fabs(nodes[source].lat - srcLat) > 1e-6 || fabs(nodes[source].lon - srcLon) > 1e-6) 
+    printItineraryLegs(it, 0);
+
+    printf("\nTotal Distance: %.3f km\n", it->totalDistance);
+    printf("Total Cost: ৳%.2f\n", it->totalCost);
+}
+
+// Dijkstra on car distance between two snapped points, partial rides included. Fills path[]
+// target first and returns its length, 0 when the trip never reaches a node.
+int solveProblem1(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total) {
+
+    if (!mayReach(PROFILE_CAR, from, to))             // no route joins their components
     {
-        double walkDist = haversineDistance(srcLat, srcLon, 
-                                           nodes[source].lat, nodes[source].lon);
-        printf("Walk from Source (%.6f, %.6f) to (%.6f, %.6f), Distance: %.3f km, Cost: ৳0.00\n", 
-               srcLon, srcLat, nodes[source].lon, nodes[source].lat, walkDist);
-        totalDistance += walkDist;
+        *total = INF;
+        return 0;
     }
 
-    for (int i = pathLen - 1; i > 0; i--) {
-        int from = path[i];
-        int to = path[i - 1];                                   // we print the car segments
+    PHASE_BEGIN(reset);
+    beginSearch(space);                 // Dijkstra is coming for you (T-T)
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+    markTargets(space, to);
+
+    const int *viewStart = profileAdjStart[PROFILE_CAR];          // only the edges this problem may use
+    const int *viewList = profileAdjList[PROFILE_CAR];
+
+    for (int a = 0; a < from->numArcs; a++)          // every way onto the network starts labelled
+    {
+        const SnapArc *arc = &from->arcs[a];
+        if (isArcClosed(space->traffic, arc)) continue;
+        seedNode(space, arc->node, arcDistance(arc), 0, a);
+    }
+
+    SnapArc direct;
+    double directStart;
+    double best = INF;                  // best finish so far, the way off the network included
+    int bestNode = -1;                  // -1 while the best is riding straight along a shared road
+    int bestArc = -1;
+
+    if (snapDirectRide(from, to, &direct, &directStart) && !isArcClosed(space->traffic, &direct)) best = arcDistance(&direct);
+
+    double minDist;
+    int u;
+
+    while ((u = heapPop(space, &minDist)) != -1)              // Dijkstra go brrrrrrrrrrrrrr
+    {
+        if (space->settled[u] == 1 || minDist > space->dist[u]) continue;
 
-        double distSeg = 0;
-        for (int j = 0; j < numEdges; j++) 
+        if (space->settled[u] == 2)                 // one of the ways off the network starts here
         {
-            if (edges[j].from == from && edges[j].to == to && edges[j].mode == MODE_CAR)        // edge distance
+            for (int a = 0; a < to->numArcs; a++) 
             {
-                distSeg = edges[j].distance;
-                break;
+                const SnapArc *arc = &to->arcs[a];
+                if (arc->node != u || isArcClosed(space->traffic, arc)) continue;
+
+                double finish = space->dist[u] + arcDistance(arc);
+                if (finish < best) 
+                {
+                    best = finish;
+                    bestNode = u;
+                    bestArc = a;
+                }
             }
         }
+        if (best <= minDist) break;               // nothing left in the heap can finish shorter
 
-        double costSeg = distSeg * carRate;
-        totalDistance += distSeg;
-        totalCost += costSeg;
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
 
-        printf("Ride Car from (%.6f, %.6f) to (%.6f, %.6f), Distance: %.3f km, Cost: ৳%.2f\n",
-               nodes[from].lon, nodes[from].lat,
-               nodes[to].lon, nodes[to].lat,
-               distSeg, costSeg);
-    }
+        for (int k = viewStart[u]; k < viewStart[u + 1]; k++) 
+        {
+            STAT_INC(&space->stats, edgesScanned);
+            int i = viewList[k];
+            if (isEdgeClosed(space->traffic, i)) continue;
 
-    if (fabs(nodes[target].lat - destLat) > 1e-6 || fabs(nodes[target].lon - destLon) > 1e-6) 
-    {
-        double walkDist = haversineDistance(nodes[target].lat, nodes[target].lon,               // if the edge is not in the node we do sum walking
-                                           destLat, destLon);
-        printf("Walk from (%.6f, %.6f) to Destination (%.6f, %.6f), Distance: %.3f km, Cost: ৳0.00\n",
-               nodes[target].lon, nodes[target].lat, destLon, destLat, walkDist);
+            int v = edges[i].to;
+            touchNode(space, v);
+            double newDist = space->dist[u] + edges[i].distance;           // we do sum relaxing
 
-        totalDistance += walkDist;
+            if (newDist < space->dist[v]) 
+            {
+                space->dist[v] = newDist;
+                space->prev[v] = u;
+                space->prevEdge[v] = i;
+                heapPush(space, newDist, v);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
     }
 
-    printf("\nTotal Distance: %.3f km\n", totalDistance);
-    printf("Total Cost: ৳%.2f\n", totalCost);
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    PHASE_BEGIN(path);
+    int pathLen = finishPath(space, bestNode, bestArc, path, pathEdges);
+    *total = best;
+    PHASE_END(&space->stats, PHASE_PATH, path);
+    return pathLen;
+}
+
+// Problem 1 as the menu and the server answer it: the overlay query when ROUTE_OVERLAY is
+// set, plain Dijkstra otherwise. Same distances, same path format.
+int routeProblem1(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total) {
+
+    if (overlayEnabled()) return overlayRoute(space, from, to, path, pathEdges, total);
+
+    return solveProblem1(space, from, to, path, pathEdges, total);
 }
 
 void runProblem1() {
@@ -72,77 +134,60 @@ void runProblem1() {
     printf("Enter destination latitude and longitude: ");
     scanf("%lf %lf", &destLat, &destLon);
 
-    int source = findNearestNode(srcLat, srcLon);
-    int target = findNearestNode(destLat, destLon);
+    QueryStats stats;
+    clearQueryStats(&stats);
+
+    TRACE_BEGIN("problem1", "query");
+    PHASE_BEGIN(snap);
+    SnapPoint from, to;
+    int snapped = snapSource(srcLat, srcLon, 0, &from) == 0 && snapTarget(destLat, destLon, 0, &to) == 0;
+    PHASE_END(&stats, PHASE_SNAP, snap);
 
-    if (source == -1 || target == -1) {
+    if (!snapped) {
         printf("Error: Could not find nodes\n");
+        TRACE_END("problem1", "query");
         return;
     }
 
-    printf("\nUsing nearest roadmap nodes:\n");
-    printf("Source Node: %s (%.6f, %.6f)\n", nodes[source].name, nodes[source].lat, nodes[source].lon);
-    printf("Target Node: %s (%.6f, %.6f)\n", nodes[target].name, nodes[target].lat, nodes[target].lon);
-
-    for (int i = 0; i < numNodes; i++) 
-    {
-        dist[i] = INF;
-        prev[i] = -1;                   // Dijkstra is coming for you (T-T)
-        visited[i] = 0;
-    }
-    dist[source] = 0;
-
-    for (int count = 0; count < numNodes; count++)              // Dijkstra go brrrrrrrrrrrrrr
-    {
-        int u = -1;
-        double minDist = INF;
-
-        for (int i = 0; i < numNodes; i++)
-        {
-            if (!visited[i] && dist[i] < minDist) 
-            {
-                minDist = dist[i];
-                u = i;
-            }
-        }
-
-        if (u == -1 || u == target) break;
-
-        visited[u] = 1;
-
-        for (int i = 0; i < numEdges; i++) 
-        {
-            if (edges[i].from == u && edges[i].mode == MODE_CAR) 
-            {
-                int v = edges[i].to;
-                double newDist = dist[u] + edges[i].distance;           // we do sum relaxing
-
-                if (newDist < dist[v]) 
-                {
-                    dist[v] = newDist;
-                    prev[v] = u;
-                }
-            }
-        }
-    }
+    printf("\nSnapped to the nearest road:\n");
+    printSnapPoint("Source", &from);
+    printSnapPoint("Target", &to);
 
-    
     int path[MAX_NODES];
+    int pathEdges[MAX_NODES];
     int pathLen = 0;
+    double total = INF;
+    RouteKey key = makeRouteKey(1, &from, &to, 0, 0);
 
-    for (int at = target; at != -1; at = prev[at]) 
+    if (!routeCacheLookup(&key, path, pathEdges, &pathLen, &total)) 
     {
-        path[pathLen++] = at;               // path building
+        SearchSpace *space = sharedSearchSpace();
+        pathLen = routeProblem1(space, &from, &to, path, pathEdges, &total);
+        addQueryStats(&stats, &space->stats);
+        routeCacheStore(&key, path, pathEdges, pathLen, total);
     }
 
-    if (pathLen == 1 || dist[target] >= INF) {
+    if (total >= INF) {
         printf("No path found between the selected nodes.\n");
+        if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+        TRACE_END("problem1", "query");
         return;
     }
 
-    printf("\nShortest path found with distance: %.3f km\n\n", dist[target]);
+    printf("\nShortest path found with distance: %.3f km\n\n", total);
+
+    PHASE_BEGIN(print);
+    ItineraryProfile profile = problemProfile(1);
+    Itinerary itinerary;
+    buildItinerary(path, pathEdges, pathLen, &from, &to, 0, &profile, &itinerary);
+    printProblem1Details(&itinerary);
+    PHASE_END(&stats, PHASE_PRINT, print);
 
-    printProblem1Details(path, pathLen, source, target, srcLat, srcLon, destLat, destLon);
+    PHASE_BEGIN(export);
+    exportItinerary(&itinerary, "route.kml");
+    freeItinerary(&itinerary);
+    PHASE_END(&stats, PHASE_EXPORT, export);
 
-    exportPathToKML(path, pathLen, "route.kml");
+    if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+    TRACE_END("problem1", "query");
 }
\ No newline at end of file
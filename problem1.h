@@ -1,8 +1,13 @@
 #ifndef problem1_H
 #define problem1_H
 
-void printProblem1Details(int path[], int pathLen, int source, int target, 
-                          double srcLat, double srcLon, double destLat, double destLon);
+#include "search.h"
+#include "itinerary.h"
+#include "snap.h"
+
+void printProblem1Details(const Itinerary *it);
+int solveProblem1(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total);
+int routeProblem1(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total);
 void runProblem1();
 
 #endif
\ No newline at end of file
@@ -4,63 +4,120 @@
 #include "mode.h"
 #include "nodesAndEdges.h"
 #include "csvParse.h"
-void printProblem2DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon) {
-    double carRate = 20.0;
-    double metroRate = 5.0;
-    double totalDistance = 0.0;
-    double totalCost = 0.0;
+#include "routeExport.h"
+#include "itinerary.h"
+#include "routeCache.h"
+#include "search.h"
+#include "snap.h"
+#include "components.h"
+#include "modeProfile.h"
+#include "walkTransfers.h"
+void printProblem2Details(const Itinerary *it) {
 
     printf("\nProblem No: 2\n");
-    printf("Source: (%.6f, %.6f)\n", srcLon, srcLat);
-    printf("Destination: (%.6f, %.6f)\n", destLon, destLat);
+    printf("Source: (%.6f, %.6f)\n", it->srcLon, it->srcLat);
+    printf("Destination: (%.6f, %.6f)\n", it->destLon, it->destLat);
     printf("\n");
 
-    if (fabs(nodes[source].lat - srcLat) > 1e-6 || fabs(nodes[source].lon - srcLon) > 1e-6)         // Deja vu??
-    {
-        double walkDist = haversineDistance(srcLat, srcLon, nodes[source].lat, nodes[source].lon);
+    printItineraryLegs(it, 0);
+
+    printf("\nTotal Distance: %.3f km\n", it->totalDistance);
+    printf("Total Cost: ৳%.2f\n", it->totalCost);
+}
+
+// Dijkstra on cost over car and metro
+int solveProblem2(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total) {
 
-        printf("Walk from Source (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Cost: ৳0.00\n",
-               srcLon, srcLat, nodes[source].name, nodes[source].lon, nodes[source].lat, walkDist);
-        totalDistance += walkDist;
+    if (!mayReach(PROFILE_CAR_METRO, from, to))             // no route joins their components
+    {
+        *total = INF;
+        return 0;
     }
 
-    for (int i = pathLen - 1; i > 0; i--) {
-        int from = path[i];
-        int to = path[i - 1];
-        int edgeIdx = pathEdges[i - 1];  // Edge that leads to path[i-1]
-        
-        double distSeg = 0;
-        Mode edgeMode = MODE_CAR;               // prints trip instructions
-        
-        if (edgeIdx >= 0 && edgeIdx < numEdges) {
-            distSeg = edges[edgeIdx].distance;
-            edgeMode = edges[edgeIdx].mode;
-        }
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+    markTargets(space, to);
+
+    const int *viewStart = profileAdjStart[PROFILE_CAR_METRO];          // only the edges this problem may use
+    const int *viewList = profileAdjList[PROFILE_CAR_METRO];
 
-        double rate = (edgeMode == MODE_METRO) ? metroRate : carRate;
-        double costSeg = distSeg * rate;
-        totalDistance += distSeg;
-        totalCost += costSeg;
+    const ModeProfile *modes = getModeProfile(2);
+    const double *fare = modes->edgeFare;             // per edge, so relaxing is an add
+    double carRate = modes->rate[MODE_CAR];           // the partial rides at either end
 
-        printf("Ride %s from %s (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Cost: ৳%.2f\n",
-               getModeName(edgeMode),
-               nodes[from].name, nodes[from].lon, nodes[from].lat,
-               nodes[to].name, nodes[to].lon, nodes[to].lat,
-               distSeg, costSeg);
+    for (int a = 0; a < from->numArcs; a++)          // every way onto the network starts labelled
+    {
+        const SnapArc *arc = &from->arcs[a];
+        if (isArcClosed(space->traffic, arc)) continue;
+        seedNode(space, arc->node, arcDistance(arc) * carRate, 0, a);
     }
 
-    if (fabs(nodes[target].lat - destLat) > 1e-6 || fabs(nodes[target].lon - destLon) > 1e-6) 
+    SnapArc direct;
+    double directStart;
+    double best = INF;                  // best finish so far, the way off the network included
+    int bestNode = -1;                  // -1 while the best is riding straight along a shared road
+    int bestArc = -1;
+
+    if (snapDirectRide(from, to, &direct, &directStart) && !isArcClosed(space->traffic, &direct)) best = arcDistance(&direct) * carRate;
+
+    double minCost;
+    int u;
+
+    while ((u = heapPop(space, &minCost)) != -1) 
     {
-        double walkDist = haversineDistance(nodes[target].lat, nodes[target].lon, destLat, destLon);
-        printf("Walk from %s (%.6f, %.6f) to Destination (%.6f, %.6f), Distance: %.3f km, Cost: ৳0.00\n",
-               nodes[target].name, nodes[target].lon, nodes[target].lat, destLon, destLat, walkDist);
+        if (space->settled[u] == 1 || minCost > space->dist[u]) continue;
+        if (space->settled[u] == 2)                 // one of the ways off the network starts here
+        {
+            for (int a = 0; a < to->numArcs; a++) 
+            {
+                const SnapArc *arc = &to->arcs[a];
+                if (arc->node != u || isArcClosed(space->traffic, arc)) continue;
 
-        totalDistance += walkDist;
+                double finish = space->dist[u] + arcDistance(arc) * carRate;
+                if (finish < best) 
+                {
+                    best = finish;
+                    bestNode = u;
+                    bestArc = a;
+                }
+            }
+        }
+        if (best <= minCost) break;               // nothing left in the heap can finish cheaper
+
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
+
+        for (int k = viewStart[u]; k < viewStart[u + 1]; k++) 
+        {
+            STAT_INC(&space->stats, edgesScanned);
+            int i = viewList[k];
+            if (isEdgeClosed(space->traffic, i)) continue;
+
+            if (!isWalkTransferAllowed(space->prevEdge[u], i)) continue;
+
+            int v = edges[i].to;
+            touchNode(space, v);
+            double newCost = space->dist[u] + fare[i];
+
+            if (newCost < space->dist[v]) 
+            {
+                space->dist[v] = newCost;
+                space->prev[v] = u;
+                space->prevEdge[v] = i;  // Remember which edge we used
+                heapPush(space, newCost, v);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
     }
 
-    printf("\nTotal Distance: %.3f km\n", totalDistance);
-    printf("Total Cost: ৳%.2f\n", totalCost);
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    PHASE_BEGIN(path);
+    int pathLen = finishPath(space, bestNode, bestArc, path, pathEdges);
+    *total = best;
+    PHASE_END(&space->stats, PHASE_PATH, path);
+    return pathLen;
 }
 
 void runProblem2() {
@@ -73,93 +130,61 @@ void runProblem2() {
     printf("Enter destination latitude and longitude: ");
     scanf("%lf %lf", &destLat, &destLon);
 
-    int source = findNearestNode(srcLat, srcLon);
-    int target = findNearestNode(destLat, destLon);
+    QueryStats stats;
+    clearQueryStats(&stats);
 
-    if (source == -1 || target == -1) {
+    TRACE_BEGIN("problem2", "query");
+    PHASE_BEGIN(snap);
+    SnapPoint from, to;
+    int snapped = snapSource(srcLat, srcLon, MODE_BIT(MODE_METRO), &from) == 0 && snapTarget(destLat, destLon, MODE_BIT(MODE_METRO), &to) == 0;
+    PHASE_END(&stats, PHASE_SNAP, snap);
+
+    if (!snapped) {
         printf("Error: Could not find nodes\n");
+        TRACE_END("problem2", "query");
         return;
     }
 
-    printf("\nUsing nearest nodes:\n");
-    printf("Source Node: %s (%.6f, %.6f)\n", nodes[source].name, nodes[source].lat, nodes[source].lon);
-    printf("Target Node: %s (%.6f, %.6f)\n", nodes[target].name, nodes[target].lat, nodes[target].lon);
+    printf("\nSnapped to the nearest road:\n");
+    printSnapPoint("Source", &from);
+    printSnapPoint("Target", &to);
 
     
-    for (int i = 0; i < numNodes; i++) {
-        dist[i] = INF;
-        prev[i] = -1;
-        prevEdge[i] = -1;  
-        visited[i] = 0;
-    }
-    dist[source] = 0;
-
-    double carRate = 20.0;
-    double metroRate = 5.0;
-
-    
-    for (int count = 0; count < numNodes; count++) 
-    {
-        int u = -1;                                     
-        double minCost = INF;       // Maybe using a arbitrary large number isnt one of the brightest ideas
-
-        for (int i = 0; i < numNodes; i++) 
-        {
-            if (!visited[i] && dist[i] < minCost) 
-            {
-                minCost = dist[i];
-                u = i;
-            }
-        }
-
-        if (u == -1 || u == target) break;
-
-        visited[u] = 1;
-
-        for (int i = 0; i < numEdges; i++) 
-        {
-            if (edges[i].from == u) 
-            {
-                if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_METRO) 
-                {
-                    continue;
-                }
-                
-                int v = edges[i].to;
-                double rate = (edges[i].mode == MODE_METRO) ? metroRate : carRate;
-                
-                double edgeCost = edges[i].distance * rate;
-                double newCost = dist[u] + edgeCost;
-                
-                if (newCost < dist[v]) 
-                {
-                    dist[v] = newCost;
-                    prev[v] = u;
-                    prevEdge[v] = i;  // Remember which edge we used
-                }
-            }
-        }
-    }
-
     int path[MAX_NODES];
-    int pathEdges[MAX_NODES];  
+    int pathEdges[MAX_NODES];
     int pathLen = 0;
+    double total = INF;
+    RouteKey key = makeRouteKey(2, &from, &to, 0, 0);
 
-    for (int at = target; at != -1; at = prev[at]) 
+    if (!routeCacheLookup(&key, path, pathEdges, &pathLen, &total)) 
     {
-        path[pathLen] = at;
-        pathEdges[pathLen] = prevEdge[at];
-        pathLen++;
+        SearchSpace *space = sharedSearchSpace();
+        pathLen = solveProblem2(space, &from, &to, path, pathEdges, &total);
+        addQueryStats(&stats, &space->stats);
+        routeCacheStore(&key, path, pathEdges, pathLen, total);
     }
 
-    if (pathLen == 1 || dist[target] >= INF) {
+    if (total >= INF) {
         printf("No path found between the selected nodes.\n");
+        if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+        TRACE_END("problem2", "query");
         return;
     }
 
-    printf("\nCheapest path found with cost: ৳%.2f\n\n", dist[target]);
+    printf("\nCheapest path found with cost: ৳%.2f\n\n", total);
+
+    PHASE_BEGIN(print);
+    ItineraryProfile profile = problemProfile(2);
+    Itinerary itinerary;
+    buildItinerary(path, pathEdges, pathLen, &from, &to, 0, &profile, &itinerary);
+    printProblem2Details(&itinerary);
+    PHASE_END(&stats, PHASE_PRINT, print);
 
-    printProblem2DetailsWithEdges(path, pathEdges, pathLen, source, target, srcLat, srcLon, destLat, destLon);
+    PHASE_BEGIN(export);
+    exportItinerary(&itinerary, "route_problem2.kml");
+    freeItinerary(&itinerary);
+    PHASE_END(&stats, PHASE_EXPORT, export);
 
-    exportPathToKML(path, pathLen, "route_problem2.kml");
+    if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+    TRACE_END("problem2", "query");
 }
\ No newline at end of file
@@ -1,8 +1,12 @@
 #ifndef problem2_H
 #define problem2_H
 
-void printProblem2DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon);
+#include "search.h"
+#include "itinerary.h"
+#include "snap.h"
+
+void printProblem2Details(const Itinerary *it);
+int solveProblem2(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total);
 void runProblem2();
 
 #endif
\ No newline at end of file
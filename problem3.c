@@ -4,76 +4,123 @@
 #include "mode.h"
 #include "nodesAndEdges.h"
 #include "csvParse.h"
+#include "routeExport.h"
+#include "itinerary.h"
+#include "routeCache.h"
+#include "search.h"
+#include "snap.h"
+#include "components.h"
+#include "modeProfile.h"
+#include "walkTransfers.h"
 
 int route = 0;
 
-void printProblem3DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon) {
-    double carRate = 20.0;
-    double metroRate = 5.0;
-    double bikolpoRate = 7.0;
-    double uttaraRate = 7.0;
-    double totalDistance = 0.0;
-    double totalCost = 0.0;
+void printProblem3Details(const Itinerary *it) {
 
     printf("\nProblem No: 3\n");
-    printf("Source: (%.6f, %.6f)\n", srcLon, srcLat);
-    printf("Destination: (%.6f, %.6f)\n", destLon, destLat);
+    printf("Source: (%.6f, %.6f)\n", it->srcLon, it->srcLat);
+    printf("Destination: (%.6f, %.6f)\n", it->destLon, it->destLat);
     printf("\n");
 
-    if (fabs(nodes[source].lat - srcLat) > 1e-6 || fabs(nodes[source].lon - srcLon) > 1e-6) 
+    printItineraryLegs(it, 0);
+
+    printf("\nTotal Distance: %.3f km\n", it->totalDistance);
+    printf("Total Cost: ৳%.2f\n", it->totalCost);
+}
+
+// Dijkstra on cost over car, metro and both buses
+int solveProblem3(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total) {
+
+    if (!mayReach(PROFILE_ALL, from, to))             // no route joins their components
     {
-        double walkDist = haversineDistance(srcLat, srcLon, nodes[source].lat, nodes[source].lon);
-        printf("Walk from Source (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Cost: ৳0.00\n",
-               srcLon, srcLat, nodes[source].name, nodes[source].lon, nodes[source].lat, walkDist);
+        *total = INF;
+        return 0;
+    }
+
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+    markTargets(space, to);
 
-        totalDistance += walkDist;
+    const int *viewStart = profileAdjStart[PROFILE_ALL];          // only the edges this problem may use
+    const int *viewList = profileAdjList[PROFILE_ALL];
+
+    const ModeProfile *modes = getModeProfile(3);
+    const double *fare = modes->edgeFare;             // per edge, so relaxing is an add
+    double carRate = modes->rate[MODE_CAR];           // the partial rides at either end
+
+    for (int a = 0; a < from->numArcs; a++)          // every way onto the network starts labelled
+    {
+        const SnapArc *arc = &from->arcs[a];
+        if (isArcClosed(space->traffic, arc)) continue;
+        seedNode(space, arc->node, arcDistance(arc) * carRate, 0, a);
     }
 
-    for (int i = pathLen - 1; i > 0; i--) 
+    SnapArc direct;
+    double directStart;
+    double best = INF;                  // best finish so far, the way off the network included
+    int bestNode = -1;                  // -1 while the best is riding straight along a shared road
+    int bestArc = -1;
+
+    if (snapDirectRide(from, to, &direct, &directStart) && !isArcClosed(space->traffic, &direct)) best = arcDistance(&direct) * carRate;
+
+    double minCost;
+    int u;
+
+    while ((u = heapPop(space, &minCost)) != -1) 
     {
-        int from = path[i];
-        int to = path[i - 1];
-        int edgeIdx = pathEdges[i - 1];
-        
-        double distSeg = 0;
-        Mode edgeMode = MODE_CAR;
-        
-        if (edgeIdx >= 0 && edgeIdx < numEdges) 
+        if (space->settled[u] == 1 || minCost > space->dist[u]) continue;
+        if (space->settled[u] == 2)                 // one of the ways off the network starts here
         {
-            distSeg = edges[edgeIdx].distance;
-            edgeMode = edges[edgeIdx].mode;
+            for (int a = 0; a < to->numArcs; a++) 
+            {
+                const SnapArc *arc = &to->arcs[a];
+                if (arc->node != u || isArcClosed(space->traffic, arc)) continue;
+
+                double finish = space->dist[u] + arcDistance(arc) * carRate;
+                if (finish < best) 
+                {
+                    best = finish;
+                    bestNode = u;
+                    bestArc = a;
+                }
+            }
         }
+        if (best <= minCost) break;               // nothing left in the heap can finish cheaper
 
-        double rate = carRate;
-
-        if (edgeMode == MODE_METRO) rate = metroRate;
-        else if (edgeMode == MODE_BIKOLPO) rate = bikolpoRate;
-        else if (edgeMode == MODE_UTTARA) rate = uttaraRate;
-        
-        double costSeg = distSeg * rate;
-        totalDistance += distSeg;
-        totalCost += costSeg;
-
-        printf("Ride %s from %s (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Cost: ৳%.2f\n",
-               getModeName(edgeMode),
-               nodes[from].name, nodes[from].lon, nodes[from].lat,
-               nodes[to].name, nodes[to].lon, nodes[to].lat,
-               distSeg, costSeg);
-        route++;
-    }
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
 
-    if (fabs(nodes[target].lat - destLat) > 1e-6 || fabs(nodes[target].lon - destLon) > 1e-6) 
-    {
-        double walkDist = haversineDistance(nodes[target].lat, nodes[target].lon, destLat, destLon);
-        printf("Walk from %s (%.6f, %.6f) to Destination (%.6f, %.6f), Distance: %.3f km, Cost: ৳0.00\n",
-               nodes[target].name, nodes[target].lon, nodes[target].lat, destLon, destLat, walkDist);
+        for (int k = viewStart[u]; k < viewStart[u + 1]; k++) 
+        {
+            STAT_INC(&space->stats, edgesScanned);
+            int i = viewList[k];
+            if (isEdgeClosed(space->traffic, i)) continue;
+
+            if (!isWalkTransferAllowed(space->prevEdge[u], i)) continue;
 
-        totalDistance += walkDist;
+            int v = edges[i].to;
+            touchNode(space, v);
+            double newCost = space->dist[u] + fare[i];
+
+            if (newCost < space->dist[v]) 
+            {
+                space->dist[v] = newCost;
+                space->prev[v] = u;
+                space->prevEdge[v] = i;
+                heapPush(space, newCost, v);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
     }
 
-    printf("\nTotal Distance: %.3f km\n", totalDistance);
-    printf("Total Cost: ৳%.2f\n", totalCost);
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    PHASE_BEGIN(path);
+    int pathLen = finishPath(space, bestNode, bestArc, path, pathEdges);
+    *total = best;
+    PHASE_END(&space->stats, PHASE_PATH, path);
+    return pathLen;
 }
 
 void runProblem3() {
@@ -86,97 +133,63 @@ void runProblem3() {
     printf("Enter destination latitude and longitude: ");
     scanf("%lf %lf", &destLat, &destLon);
 
-    int source = findNearestNode(srcLat, srcLon);
-    int target = findNearestNode(destLat, destLon);
+    QueryStats stats;
+    clearQueryStats(&stats);
+
+    TRACE_BEGIN("problem3", "query");
+    PHASE_BEGIN(snap);
+    SnapPoint from, to;
+    int snapped = snapSource(srcLat, srcLon, TRANSIT_MODE_BITS, &from) == 0 && snapTarget(destLat, destLon, TRANSIT_MODE_BITS, &to) == 0;
+    PHASE_END(&stats, PHASE_SNAP, snap);
 
-    if (source == -1 || target == -1) {
+    if (!snapped) {
         printf("Error: Could not find nodes\n");
+        TRACE_END("problem3", "query");
         return;
     }
 
-    printf("\nUsing nearest nodes:\n");
-    printf("Source Node: %s (%.6f, %.6f)\n", nodes[source].name, nodes[source].lat, nodes[source].lon);
-    printf("Target Node: %s (%.6f, %.6f)\n", nodes[target].name, nodes[target].lat, nodes[target].lon);
-
-    for (int i = 0; i < numNodes; i++) {
-        dist[i] = INF;
-        prev[i] = -1;
-        prevEdge[i] = -1;
-        visited[i] = 0;
-    }
-    dist[source] = 0;
-
-    double carRate = 20.0;
-    double metroRate = 5.0;
-    double bikolpoRate = 7.0;
-    double uttaraRate = 7.0;
-
-    for (int count = 0; count < numNodes; count++) 
-    {
-        int u = -1;
-        double minCost = INF;               // I should switch to cpp
-
-        for (int i = 0; i < numNodes; i++) 
-        {
-            if (!visited[i] && dist[i] < minCost) 
-            {
-                minCost = dist[i];
-                u = i;
-            }
-        }
-
-        if (u == -1 || u == target) break;
-
-        visited[u] = 1;
-
-        for (int i = 0; i < numEdges; i++) {
-            if (edges[i].from == u) {
-                
-                if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_METRO && 
-                    edges[i].mode != MODE_BIKOLPO && edges[i].mode != MODE_UTTARA) {
-                    continue;
-                }
-                
-                int v = edges[i].to;
-                double rate = carRate;
-                if (edges[i].mode == MODE_METRO) rate = metroRate;
-                else if (edges[i].mode == MODE_BIKOLPO) rate = bikolpoRate;
-                else if (edges[i].mode == MODE_UTTARA) rate = uttaraRate;
-                
-                double edgeCost = edges[i].distance * rate;
-                double newCost = dist[u] + edgeCost;
-                
-                if (newCost < dist[v]) 
-                {
-                    dist[v] = newCost;
-                    prev[v] = u;
-                    prevEdge[v] = i;
-                }
-            }
-        }
-    }
+    printf("\nSnapped to the nearest road:\n");
+    printSnapPoint("Source", &from);
+    printSnapPoint("Target", &to);
 
     int path[MAX_NODES];
     int pathEdges[MAX_NODES];
     int pathLen = 0;
+    double total = INF;
+    RouteKey key = makeRouteKey(3, &from, &to, 0, 0);
 
-    for (int at = target; at != -1; at = prev[at]) 
+    if (!routeCacheLookup(&key, path, pathEdges, &pathLen, &total)) 
     {
-        path[pathLen] = at;
-        pathEdges[pathLen] = prevEdge[at];
-        pathLen++;
+        SearchSpace *space = sharedSearchSpace();
+        pathLen = solveProblem3(space, &from, &to, path, pathEdges, &total);
+        addQueryStats(&stats, &space->stats);
+        routeCacheStore(&key, path, pathEdges, pathLen, total);
     }
 
-    if (pathLen == 1 || dist[target] >= INF) {
+    if (total >= INF) {
         printf("No path found between the selected nodes.\n");
+        if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+        TRACE_END("problem3", "query");
         return;
     }
 
-    printf("\nCheapest path found with cost: ৳%.2f\n\n", dist[target]);
+    printf("\nCheapest path found with cost: ৳%.2f\n\n", total);
+
+    PHASE_BEGIN(print);
+    ItineraryProfile profile = problemProfile(3);
+    Itinerary itinerary;
+    buildItinerary(path, pathEdges, pathLen, &from, &to, 0, &profile, &itinerary);
+    printProblem3Details(&itinerary);
+    route += itinerary.numLegs;
+    PHASE_END(&stats, PHASE_PRINT, print);
 
-    printProblem3DetailsWithEdges(path, pathEdges, pathLen, source, target, srcLat, srcLon, destLat, destLon);
+    PHASE_BEGIN(export);
+    exportItinerary(&itinerary, "route_problem3.kml");
+    freeItinerary(&itinerary);
+    PHASE_END(&stats, PHASE_EXPORT, export);
 
-    exportPathToKML(path, pathLen, "route_problem3.kml");
+    if (queryStatsEnabled()) printQueryStats(&stats, stdout);
 
     printf("No of routes: %d", route);
+    TRACE_END("problem3", "query");
 }
\ No newline at end of file
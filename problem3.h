@@ -1,9 +1,13 @@
 #ifndef problem3_H
 #define problem3_H
 
-void printProblem3DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon);
+#include "search.h"
+#include "itinerary.h"
+#include "snap.h"
+
+void printProblem3Details(const Itinerary *it);
             
+int solveProblem3(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int path[], int pathEdges[], double *total);
 void runProblem3();
 
 #endif
\ No newline at end of file
@@ -5,126 +5,159 @@
 #include "nodesAndEdges.h"
 #include "timeHandling.h"
 #include "csvParse.h"
+#include "routeExport.h"
+#include "itinerary.h"
+#include "routeCache.h"
+#include "search.h"
+#include "snap.h"
+#include "components.h"
+#include "modeProfile.h"
+#include "walkTransfers.h"
+#include "speedProfile.h"
 
-void printProblem4DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon,
-                                    int startTimeMin) {
-    double carRate = 20.0;
-    double metroRate = 5.0;
-    double bikolpoRate = 7.0;
-    double uttaraRate = 10.0;
-    double totalDistance = 0.0;
-    double totalCost = 0.0;
-    double totalTravelTime = 0.0;  // in minutes
-    double currentTime = startTimeMin;
-    
-    char timeBuffer[32];                // what is this for you may ask. I do not know
+void printProblem4Details(const Itinerary *it) {
+
+    char timeBuffer[32];
 
     printf("\nProblem No: 4\n");
-    printf("Source: (%.6f, %.6f)\n", srcLon, srcLat);
-    printf("Destination: (%.6f, %.6f)\n", destLon, destLat);
-    formatTime(startTimeMin, timeBuffer, sizeof(timeBuffer));
+    printf("Source: (%.6f, %.6f)\n", it->srcLon, it->srcLat);
+    printf("Destination: (%.6f, %.6f)\n", it->destLon, it->destLat);
+    formatTime((int)it->startMin, timeBuffer, sizeof(timeBuffer));
     printf("Start Time: %s\n", timeBuffer);
     printf("\n");
 
-    if (fabs(nodes[source].lat - srcLat) > 1e-6 || fabs(nodes[source].lon - srcLon) > 1e-6) {
-        double walkDist = haversineDistance(srcLat, srcLon, 
-                                           nodes[source].lat, nodes[source].lon);
-        double walkTime = (walkDist / WALK_SPEED_KMH) * 60.0;
-        
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));           // Ahh its for time format
-        printf("[%s] Walk from Source (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳0.00\n",
-               timeBuffer, srcLon, srcLat, nodes[source].name, nodes[source].lon, nodes[source].lat, 
-               walkDist, walkTime);
-        totalDistance += walkDist;
-        totalTravelTime += walkTime;
-        currentTime += walkTime;
+    printItineraryLegs(it, 1);
+
+    formatTime((int)it->arrivalMin, timeBuffer, sizeof(timeBuffer));
+    printf("\nArrival Time: %s\n", timeBuffer);
+    printf("Total Distance: %.3f km\n", it->totalDistance);
+    printf("Total Travel Time: %.1f minutes (%.1f hours)\n", it->totalTravelMin, it->totalTravelMin / 60.0);
+    printf("Total Cost: ৳%.2f\n", it->totalCost);
+}
+
+// Dijkstra on cost, waits follow the shared schedule
+int solveProblem4(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int startTimeMin, int path[], int pathEdges[], double *total) {
+
+    if (!mayReach(PROFILE_ALL, from, to))             // no route joins their components
+    {
+        *total = INF;
+        return 0;
     }
 
-    Mode prevMode = MODE_CAR; 
-    int isFirstSegment = 1;
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+    markTargets(space, to);
+
+    const int *viewStart = profileAdjStart[PROFILE_ALL];          // only the edges this problem may use
+    const int *viewList = profileAdjList[PROFILE_ALL];
+
+    const ModeProfile *modes = getModeProfile(4);
+    const double *fare = modes->edgeFare;             // per edge, so relaxing is an add
+    double carRate = modes->rate[MODE_CAR];           // the partial rides at either end
 
-    for (int i = pathLen - 1; i > 0; i--)       // We print the segments using the stored edge info
+    for (int a = 0; a < from->numArcs; a++)          // every way onto the network starts labelled
     {
-        int from = path[i];
-        int to = path[i - 1];
-        int edgeIdx = pathEdges[i - 1];
-        
-        double distSeg = 0;
-        Mode edgeMode = MODE_CAR;
-        
-        if (edgeIdx >= 0 && edgeIdx < numEdges) 
-        {
-            distSeg = edges[edgeIdx].distance;
-            edgeMode = edges[edgeIdx].mode;
-        }
+        const SnapArc *arc = &from->arcs[a];
+        if (isArcClosed(space->traffic, arc)) continue;
+
+        double arrival = startTimeMin + arcWalkMin(arc) + arcTravelMin(arc, modes->speed[MODE_CAR], startTimeMin + arcWalkMin(arc), space->traffic);
+        seedNode(space, arc->node, arcDistance(arc) * carRate, arrival, a);
+    }
+
+    SnapArc direct;
+    double directStart;
+    double best = INF;                  // best finish so far, the way off the network included
+    int bestNode = -1;                  // -1 while the best is riding straight along a shared road
+    int bestArc = -1;
 
-        int needsWait = 0;
-        if (edgeMode != MODE_CAR && edgeMode != MODE_WALK) 
+    if (snapDirectRide(from, to, &direct, &directStart) && !isArcClosed(space->traffic, &direct)) best = arcDistance(&direct) * carRate;
+
+    double minCost;                     // Cpp is good but C is life
+    int u;
+
+    while ((u = heapPop(space, &minCost)) != -1) 
+    {
+        if (space->settled[u] == 1 || minCost > space->dist[u]) continue;
+        if (space->settled[u] == 2)                 // one of the ways off the network starts here
         {
-            if (isFirstSegment || edgeMode != prevMode)         // Need to wait if: first segment on this mode, or switching from a different mode
+            for (int a = 0; a < to->numArcs; a++) 
             {
-                needsWait = 1;
+                const SnapArc *arc = &to->arcs[a];
+                if (arc->node != u || isArcClosed(space->traffic, arc)) continue;
+
+                double finish = space->dist[u] + arcDistance(arc) * carRate;
+                if (finish < best) 
+                {
+                    best = finish;
+                    bestNode = u;
+                    bestArc = a;
+                }
             }
         }
+        if (best <= minCost) break;               // nothing left in the heap can finish cheaper
+
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
+
+        Mode arrivalMode = MODE_CAR;  
 
-        if (needsWait) 
+        if (space->prevEdge[u] >= 0 && space->prevEdge[u] < numEdges) 
         {
-            double waitTime = getWaitingTime((int)currentTime, edgeMode);
+            arrivalMode = edges[space->prevEdge[u]].mode;
+        }
+
+        for (int k = viewStart[u]; k < viewStart[u + 1]; k++) 
+        {
+            STAT_INC(&space->stats, edgesScanned);
+            int i = viewList[k];
+            if (isEdgeClosed(space->traffic, i)) continue;
+
+            if (!isWalkTransferAllowed(space->prevEdge[u], i)) continue;
 
-            if (waitTime > 0 && waitTime < INF) 
+            int v = edges[i].to;
+
+            double waitTime = 0.0;
+            if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_WALK) 
             {
-                formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-                printf("[%s] Wait for %s: %.0f minutes\n", timeBuffer, getModeName(edgeMode), waitTime);
-                currentTime += waitTime;
-                totalTravelTime += waitTime;
+                if (edges[i].mode != arrivalMode || space->prevEdge[u] < 0) 
+                {
+                    waitTime = getWaitingTime(u, (int)space->arrival[u], edges[i].mode);
+                    STAT_INC(&space->stats, waitsComputed);
+                    if (waitTime >= INF) 
+                    {
+                        STAT_INC(&space->stats, infWaitsSkipped);
+                        continue;  
+                    }
+                }
+                // else continuing on same vehicle, no wait
             }
-        }
 
-        double rate = carRate;
-        if (edgeMode == MODE_METRO) rate = metroRate;
-        else if (edgeMode == MODE_BIKOLPO) rate = bikolpoRate;
-        else if (edgeMode == MODE_UTTARA) rate = uttaraRate;
-        
-        double costSeg = distSeg * rate;
-        double travelTime = (distSeg / VEHICLE_SPEED_KMH) * 60.0;
-        
-        totalDistance += distSeg;
-        totalCost += costSeg;
-        totalTravelTime += travelTime;
-
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-        printf("[%s] Ride %s from %s (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳%.2f\n",
-               timeBuffer, getModeName(edgeMode),
-               nodes[from].name, nodes[from].lon, nodes[from].lat,
-               nodes[to].name, nodes[to].lon, nodes[to].lat,
-               distSeg, travelTime, costSeg);
-        
-        currentTime += travelTime;
-        prevMode = edgeMode;
-        isFirstSegment = 0;
-    }
+            double travelTime = modeEdgeMin(modes, i, space->arrival[u] + waitTime) / trafficFactor(space->traffic, i);     // speed at the time we set off
+            double newArrivalTime = space->arrival[u] + waitTime + travelTime;
 
-    if (fabs(nodes[target].lat - destLat) > 1e-6 || fabs(nodes[target].lon - destLon) > 1e-6) 
-    {
-        double walkDist = haversineDistance(nodes[target].lat, nodes[target].lon,
-                                           destLat, destLon);
-        double walkTime = (walkDist / WALK_SPEED_KMH) * 60.0;
-        
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-        printf("[%s] Walk from %s (%.6f, %.6f) to Destination (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳0.00\n",
-               timeBuffer, nodes[target].name, nodes[target].lon, nodes[target].lat, 
-               destLon, destLat, walkDist, walkTime);
-        totalDistance += walkDist;
-        totalTravelTime += walkTime;
-        currentTime += walkTime;
+            double newCost = space->dist[u] + fare[i];
+
+            touchNode(space, v);
+            if (newCost < space->dist[v]) 
+            {
+                space->dist[v] = newCost;
+                space->prev[v] = u;
+                space->prevEdge[v] = i;
+                space->arrival[v] = newArrivalTime;
+                heapPush(space, newCost, v);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
     }
 
-    formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-    printf("\nArrival Time: %s\n", timeBuffer);
-    printf("Total Distance: %.3f km\n", totalDistance);
-    printf("Total Travel Time: %.1f minutes (%.1f hours)\n", totalTravelTime, totalTravelTime / 60.0);
-    printf("Total Cost: ৳%.2f\n", totalCost);
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    PHASE_BEGIN(path);
+    int pathLen = finishPath(space, bestNode, bestArc, path, pathEdges);
+    *total = best;
+    PHASE_END(&space->stats, PHASE_PATH, path);
+    return pathLen;
 }
 
 void runProblem4() {
@@ -151,125 +184,62 @@ void runProblem4() {
         return;
     }
 
-    int source = findNearestNode(srcLat, srcLon);
-    int target = findNearestNode(destLat, destLon);
+    QueryStats stats;
+    clearQueryStats(&stats);
+
+    TRACE_BEGIN("problem4", "query");
+    PHASE_BEGIN(snap);
+    SnapPoint from, to;
+    int snapped = snapSource(srcLat, srcLon, TRANSIT_MODE_BITS, &from) == 0 && snapTarget(destLat, destLon, TRANSIT_MODE_BITS, &to) == 0;
+    PHASE_END(&stats, PHASE_SNAP, snap);
 
-    if (source == -1 || target == -1) 
+    if (!snapped) 
     {
         printf("Error: Could not find nodes\n");
+        TRACE_END("problem4", "query");
         return;
     }
 
-    printf("\nUsing nearest nodes:\n");
-    printf("Source Node: %s (%.6f, %.6f)\n", nodes[source].name, nodes[source].lat, nodes[source].lon);
-    printf("Target Node: %s (%.6f, %.6f)\n", nodes[target].name, nodes[target].lat, nodes[target].lon);
-
-    for (int i = 0; i < numNodes; i++) 
-    {
-        dist[i] = INF;
-        prev[i] = -1;                   // I am just copy pasting the same code
-        prevEdge[i] = -1;
-        visited[i] = 0;
-        arrivalTime[i] = INF;
-    }
-    dist[source] = 0;
-    arrivalTime[source] = startTimeMin;
-
-    double carRate = 20.0;
-    double metroRate = 5.0;
-    double bikolpoRate = 7.0;
-    double uttaraRate = 10.0;
-
-    for (int count = 0; count < numNodes; count++) 
-    {
-        int u = -1;
-        double minCost = INF;               // Cpp is good but C is life
-
-        for (int i = 0; i < numNodes; i++) 
-        {
-            if (!visited[i] && dist[i] < minCost) 
-            {
-                minCost = dist[i];
-                u = i;
-            }
-        }
-
-        if (u == -1 || u == target) break;
-
-        visited[u] = 1;
-
-        Mode arrivalMode = MODE_CAR;  
-
-        if (prevEdge[u] >= 0 && prevEdge[u] < numEdges) 
-        {
-            arrivalMode = edges[prevEdge[u]].mode;
-        }
-
-        for (int i = 0; i < numEdges; i++) {
-            if (edges[i].from == u) {
-                if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_METRO && 
-                    edges[i].mode != MODE_BIKOLPO && edges[i].mode != MODE_UTTARA) {
-                    continue;
-                }
-                
-                int v = edges[i].to;
-                
-                double waitTime = 0.0;
-                if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_WALK) 
-                {
-                    if (edges[i].mode != arrivalMode || u == source) 
-                    {
-                        waitTime = getWaitingTime((int)arrivalTime[u], edges[i].mode);
-                        if (waitTime >= INF) 
-                        {
-                            continue;  
-                        }
-                    }
-                    // else continuing on same vehicle, no wait
-                }
-                
-                double travelTime = (edges[i].distance / VEHICLE_SPEED_KMH) * 60.0;
-                double newArrivalTime = arrivalTime[u] + waitTime + travelTime;
-                
-                double rate = carRate;
-                if (edges[i].mode == MODE_METRO) rate = metroRate;
-                else if (edges[i].mode == MODE_BIKOLPO) rate = bikolpoRate;
-                else if (edges[i].mode == MODE_UTTARA) rate = uttaraRate;
-                
-                double edgeCost = edges[i].distance * rate;
-                double newCost = dist[u] + edgeCost;
-                
-                if (newCost < dist[v]) 
-                {
-                    dist[v] = newCost;
-                    prev[v] = u;
-                    prevEdge[v] = i;
-                    arrivalTime[v] = newArrivalTime;
-                }
-            }
-        }
-    }
+    printf("\nSnapped to the nearest road:\n");
+    printSnapPoint("Source", &from);
+    printSnapPoint("Target", &to);
 
     int path[MAX_NODES];
     int pathEdges[MAX_NODES];
     int pathLen = 0;
-    for (int at = target; at != -1; at = prev[at]) 
+    double total = INF;
+    RouteKey key = makeRouteKey(4, &from, &to, startTimeMin, 0);
+
+    if (!routeCacheLookup(&key, path, pathEdges, &pathLen, &total)) 
     {
-        path[pathLen] = at;
-        pathEdges[pathLen] = prevEdge[at];
-        pathLen++;
+        SearchSpace *space = sharedSearchSpace();
+        pathLen = solveProblem4(space, &from, &to, startTimeMin, path, pathEdges, &total);
+        addQueryStats(&stats, &space->stats);
+        routeCacheStore(&key, path, pathEdges, pathLen, total);
     }
 
-    if (pathLen == 1 || dist[target] >= INF) 
+    if (total >= INF) 
     {
         printf("No path found between the selected nodes.\n");
+        if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+        TRACE_END("problem4", "query");
         return;
     }
 
-    printf("\nCheapest time-constrained path found with cost: ৳%.2f\n\n", dist[target]);
+    printf("\nCheapest time-constrained path found with cost: ৳%.2f\n\n", total);
+
+    PHASE_BEGIN(print);
+    ItineraryProfile profile = problemProfile(4);
+    Itinerary itinerary;
+    buildItinerary(path, pathEdges, pathLen, &from, &to, startTimeMin, &profile, &itinerary);
+    printProblem4Details(&itinerary);
+    PHASE_END(&stats, PHASE_PRINT, print);
 
-    printProblem4DetailsWithEdges(path, pathEdges, pathLen, source, target, 
-                                  srcLat, srcLon, destLat, destLon, startTimeMin);
+    PHASE_BEGIN(export);
+    exportItinerary(&itinerary, "route_problem4.kml");
+    freeItinerary(&itinerary);
+    PHASE_END(&stats, PHASE_EXPORT, export);
 
-    exportPathToKML(path, pathLen, "route_problem4.kml");
+    if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+    TRACE_END("problem4", "query");
 }
\ No newline at end of file
@@ -1,10 +1,13 @@
 #ifndef problem4_H
 #define problem4_H
 
-void printProblem4DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon,
-                                    int startTimeMin);
+#include "search.h"
+#include "itinerary.h"
+#include "snap.h"
 
+void printProblem4Details(const Itinerary *it);
+
+int solveProblem4(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int startTimeMin, int path[], int pathEdges[], double *total);
 void runProblem4();
 
 #endif
\ No newline at end of file
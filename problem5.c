@@ -5,126 +5,158 @@
 #include "nodesAndEdges.h"
 #include "timeHandling.h"
 #include "csvParse.h"
+#include "routeExport.h"
+#include "itinerary.h"
+#include "routeCache.h"
+#include "search.h"
+#include "snap.h"
+#include "components.h"
+#include "modeProfile.h"
+#include "walkTransfers.h"
+#include "speedProfile.h"
+
+void printProblem5Details(const Itinerary *it) {
 
-void printProblem5DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon,
-                                    int startTimeMin) {
-    double carRate = 20.0;
-    double metroRate = 5.0;
-    double bikolpoRate = 7.0;
-    double uttaraRate = 10.0;
-    double totalDistance = 0.0;
-    double totalCost = 0.0;
-    double totalTravelTime = 0.0;  
-    double currentTime = startTimeMin;
-    
     char timeBuffer[32];
 
     printf("\nProblem No: 5\n");
-    printf("Source: (%.6f, %.6f)\n", srcLon, srcLat);
-    printf("Destination: (%.6f, %.6f)\n", destLon, destLat);
-    formatTime(startTimeMin, timeBuffer, sizeof(timeBuffer));
+    printf("Source: (%.6f, %.6f)\n", it->srcLon, it->srcLat);
+    printf("Destination: (%.6f, %.6f)\n", it->destLon, it->destLat);
+    formatTime((int)it->startMin, timeBuffer, sizeof(timeBuffer));
     printf("Start Time: %s\n", timeBuffer);
     printf("\n");
 
-    if (fabs(nodes[source].lat - srcLat) > 1e-6 || fabs(nodes[source].lon - srcLon) > 1e-6) 
+    printItineraryLegs(it, 1);
+
+    formatTime((int)it->arrivalMin, timeBuffer, sizeof(timeBuffer));
+    printf("\nArrival Time: %s\n", timeBuffer);
+    printf("Total Distance: %.3f km\n", it->totalDistance);
+    printf("Total Travel Time: %.1f minutes (%.1f hours)\n", it->totalTravelMin, it->totalTravelMin / 60.0);
+    printf("Total Cost: ৳%.2f\n", it->totalCost);
+}
+
+// Dijkstra on arrival time, waits follow the shared schedule
+int solveProblem5(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int startTimeMin, int path[], int pathEdges[], double *total) {
+
+    if (!mayReach(PROFILE_ALL, from, to))             // no route joins their components
     {
-        double walkDist = haversineDistance(srcLat, srcLon, nodes[source].lat, nodes[source].lon);
-        double walkTime = (walkDist / WALK_SPEED_KMH) * 60.0;
-        
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-        printf("[%s] Walk from Source (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳0.00\n",
-               timeBuffer, srcLon, srcLat, nodes[source].name, nodes[source].lon, nodes[source].lat, 
-               walkDist, walkTime);
-        totalDistance += walkDist;
-        totalTravelTime += walkTime;
-        currentTime += walkTime;
+        *total = INF;
+        return 0;
     }
 
-    Mode prevMode = MODE_CAR;   // Need to initialize with something
-    int isFirstSegment = 1;
+    PHASE_BEGIN(reset);
+    beginSearch(space);                 // Now we optimize for time
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+    markTargets(space, to);
+
+    const ModeProfile *modes = getModeProfile(5);
+
+    const int *viewStart = profileAdjStart[PROFILE_ALL];          // only the edges this problem may use
+    const int *viewList = profileAdjList[PROFILE_ALL];
 
-    for (int i = pathLen - 1; i > 0; i--) 
+    for (int a = 0; a < from->numArcs; a++)          // every way onto the network starts labelled
     {
-        int from = path[i];
-        int to = path[i - 1];
-        int edgeIdx = pathEdges[i - 1];
-        
-        double distSeg = 0;
-        Mode edgeMode = MODE_CAR;
-        
-        if (edgeIdx >= 0 && edgeIdx < numEdges) {
-            distSeg = edges[edgeIdx].distance;
-            edgeMode = edges[edgeIdx].mode;
-        }
+        const SnapArc *arc = &from->arcs[a];
+        if (isArcClosed(space->traffic, arc)) continue;
 
-        // Only wait when BOARDING a new scheduled service
-        int needsWait = 0;
-        if (edgeMode != MODE_CAR && edgeMode != MODE_WALK) 
+        double arrival = startTimeMin + arcWalkMin(arc) + arcTravelMin(arc, modes->speed[MODE_CAR], startTimeMin + arcWalkMin(arc), space->traffic);
+        seedNode(space, arc->node, arrival, arrival, a);
+    }
+
+    SnapArc direct;
+    double directStart;
+    double best = INF;                  // best finish so far, the way off the network included
+    int bestNode = -1;                  // -1 while the best is riding straight along a shared road
+    int bestArc = -1;
+
+    if (snapDirectRide(from, to, &direct, &directStart) && !isArcClosed(space->traffic, &direct)) 
+    {
+        double setOff = startTimeMin + (from->walkKm / WALK_SPEED_KMH) * 60.0;
+        best = setOff + arcTravelMin(&direct, modes->speed[MODE_CAR], setOff, space->traffic) + (to->walkKm / WALK_SPEED_KMH) * 60.0;
+    }
+
+    double minTime;
+    int u;
+
+    while ((u = heapPop(space, &minTime)) != -1)            // Doramumma I have come to bargain
+    {
+        if (space->settled[u] == 1 || minTime > space->arrival[u]) continue;
+        if (space->settled[u] == 2)                 // one of the ways off the network starts here
         {
-            if (isFirstSegment || edgeMode != prevMode)         // checking to see if I am boarding a new service
+            for (int a = 0; a < to->numArcs; a++) 
             {
-                needsWait = 1;
+                const SnapArc *arc = &to->arcs[a];
+                if (arc->node != u || isArcClosed(space->traffic, arc)) continue;
+
+                double finish = space->arrival[u] + arcTravelMin(arc, modes->speed[MODE_CAR], space->arrival[u], space->traffic) + arcWalkMin(arc);
+                if (finish < best) 
+                {
+                    best = finish;
+                    bestNode = u;
+                    bestArc = a;
+                }
             }
         }
+        if (best <= minTime) break;               // nothing left in the heap can get there sooner
+
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
+
+        Mode arrivalMode = MODE_CAR;
+
+        if (space->prevEdge[u] >= 0 && space->prevEdge[u] < numEdges) 
+        {
+            arrivalMode = edges[space->prevEdge[u]].mode;
+        }
 
-        if (needsWait) 
+        for (int k = viewStart[u]; k < viewStart[u + 1]; k++) 
         {
-            double waitTime = getWaitingTime((int)currentTime, edgeMode);
-            if (waitTime > 0 && waitTime < INF) 
+            STAT_INC(&space->stats, edgesScanned);
+            int i = viewList[k];
+            if (isEdgeClosed(space->traffic, i)) continue;
+
+            if (!isWalkTransferAllowed(space->prevEdge[u], i)) continue;
+
+            int v = edges[i].to;
+
+            double waitTime = 0.0;
+            if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_WALK) 
             {
-                formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-                printf("[%s] Wait for %s: %.0f minutes\n", timeBuffer, getModeName(edgeMode), waitTime);
-                currentTime += waitTime;
-                totalTravelTime += waitTime;
+                if (edges[i].mode != arrivalMode || space->prevEdge[u] < 0) 
+                {
+                    waitTime = getWaitingTime(u, (int)space->arrival[u], edges[i].mode);
+                    STAT_INC(&space->stats, waitsComputed);
+
+                    if (waitTime >= INF) 
+                    {
+                        STAT_INC(&space->stats, infWaitsSkipped);
+                        continue;  // Service not available
+                    }
+                }
             }
-        }
 
-        double rate = carRate;
-        if (edgeMode == MODE_METRO) rate = metroRate;
-        else if (edgeMode == MODE_BIKOLPO) rate = bikolpoRate;
-        else if (edgeMode == MODE_UTTARA) rate = uttaraRate;
-        
-        double costSeg = distSeg * rate;
-        double travelTime = (distSeg / VEHICLE_SPEED_PROBLEM5_KMH) * 60.0;  
-        
-        totalDistance += distSeg;
-        totalCost += costSeg;
-        totalTravelTime += travelTime;
-
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-
-        printf("[%s] Ride %s from %s (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳%.2f\n",
-               timeBuffer, getModeName(edgeMode),
-               nodes[from].name, nodes[from].lon, nodes[from].lat,
-               nodes[to].name, nodes[to].lon, nodes[to].lat,
-               distSeg, travelTime, costSeg);
-        
-        currentTime += travelTime;
-        prevMode = edgeMode;
-        isFirstSegment = 0;
-    }
+            double travelTime = modeEdgeMin(modes, i, space->arrival[u] + waitTime) / trafficFactor(space->traffic, i);     // speed at the time we set off
+            double newArrivalTime = space->arrival[u] + waitTime + travelTime;
 
-    if (fabs(nodes[target].lat - destLat) > 1e-6 || fabs(nodes[target].lon - destLon) > 1e-6) 
-    {
-        double walkDist = haversineDistance(nodes[target].lat, nodes[target].lon, destLat, destLon);
-        double walkTime = (walkDist / WALK_SPEED_KMH) * 60.0;
-        
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-
-        printf("[%s] Walk from %s (%.6f, %.6f) to Destination (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳0.00\n",
-               timeBuffer, nodes[target].name, nodes[target].lon, nodes[target].lat, 
-               destLon, destLat, walkDist, walkTime);
-        totalDistance += walkDist;
-        totalTravelTime += walkTime;
-        currentTime += walkTime;
+            touchNode(space, v);
+            if (newArrivalTime < space->arrival[v]) 
+            {
+                space->arrival[v] = newArrivalTime;
+                space->prev[v] = u;                        // Update if this gives earlier arrival
+                space->prevEdge[v] = i;
+                heapPush(space, newArrivalTime, v);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
     }
 
-    formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-    printf("\nArrival Time: %s\n", timeBuffer);
-    printf("Total Distance: %.3f km\n", totalDistance);
-    printf("Total Travel Time: %.1f minutes (%.1f hours)\n", totalTravelTime, totalTravelTime / 60.0);
-    printf("Total Cost: ৳%.2f\n", totalCost);
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    PHASE_BEGIN(path);
+    int pathLen = finishPath(space, bestNode, bestArc, path, pathEdges);
+    *total = best;
+    PHASE_END(&space->stats, PHASE_PATH, path);
+    return pathLen;
 }
 
 void runProblem5() {
@@ -154,110 +186,61 @@ void runProblem5() {
         return;
     }
 
-    int source = findNearestNode(srcLat, srcLon);
-    int target = findNearestNode(destLat, destLon);
+    QueryStats stats;
+    clearQueryStats(&stats);
 
-    if (source == -1 || target == -1) {
+    TRACE_BEGIN("problem5", "query");
+    PHASE_BEGIN(snap);
+    SnapPoint from, to;
+    int snapped = snapSource(srcLat, srcLon, TRANSIT_MODE_BITS, &from) == 0 && snapTarget(destLat, destLon, TRANSIT_MODE_BITS, &to) == 0;
+    PHASE_END(&stats, PHASE_SNAP, snap);
+
+    if (!snapped) {
         printf("Error: Could not find nodes\n");
+        TRACE_END("problem5", "query");
         return;
     }
 
-    printf("\nUsing nearest nodes:\n");
-    printf("Source Node: %s (%.6f, %.6f)\n", nodes[source].name, nodes[source].lat, nodes[source].lon);
-    printf("Target Node: %s (%.6f, %.6f)\n", nodes[target].name, nodes[target].lat, nodes[target].lon);
-
-    for (int i = 0; i < numNodes; i++)  // Now we optimize for time
-    {
-        dist[i] = INF;
-        prev[i] = -1;
-        prevEdge[i] = -1;
-        visited[i] = 0;
-        arrivalTime[i] = INF;
-    }
-    arrivalTime[source] = startTimeMin;
-
-    for (int count = 0; count < numNodes; count++) 
-    {
-        int u = -1;
-        double minTime = INF;
-
-        for (int i = 0; i < numNodes; i++) 
-        {
-            if (!visited[i] && arrivalTime[i] < minTime)            // Doramumma I have come to bargain
-            {
-                minTime = arrivalTime[i];
-                u = i;
-            }
-        }
-
-        if (u == -1 || u == target) break;
-
-        visited[u] = 1;
-
-        Mode arrivalMode = MODE_CAR;
-
-        if (prevEdge[u] >= 0 && prevEdge[u] < numEdges) 
-        {
-            arrivalMode = edges[prevEdge[u]].mode;
-        }
-
-        for (int i = 0; i < numEdges; i++) 
-        {
-            if (edges[i].from == u) 
-            {
-                if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_METRO && 
-                    edges[i].mode != MODE_BIKOLPO && edges[i].mode != MODE_UTTARA) {
-                    continue;
-                }
-                
-                int v = edges[i].to;
-                
-                double waitTime = 0.0;
-                if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_WALK) 
-                {
-                    if (edges[i].mode != arrivalMode || u == source) 
-                    {
-                        waitTime = getWaitingTime((int)arrivalTime[u], edges[i].mode);
-
-                        if (waitTime >= INF) 
-                        {
-                            continue;  // Service not available
-                        }
-                    }
-                }
-                
-                double travelTime = (edges[i].distance / VEHICLE_SPEED_PROBLEM5_KMH) * 60.0;
-                double newArrivalTime = arrivalTime[u] + waitTime + travelTime;
-                
-                if (newArrivalTime < arrivalTime[v]) 
-                {
-                    arrivalTime[v] = newArrivalTime;
-                    prev[v] = u;                        // Update if this gives earlier arrival
-                    prevEdge[v] = i;
-                }
-            }
-        }
-    }
+    printf("\nSnapped to the nearest road:\n");
+    printSnapPoint("Source", &from);
+    printSnapPoint("Target", &to);
 
     int path[MAX_NODES];
     int pathEdges[MAX_NODES];
     int pathLen = 0;
-    for (int at = target; at != -1; at = prev[at]) {
-        path[pathLen] = at;
-        pathEdges[pathLen] = prevEdge[at];
-        pathLen++;
+    double total = INF;
+    RouteKey key = makeRouteKey(5, &from, &to, startTimeMin, 0);
+
+    if (!routeCacheLookup(&key, path, pathEdges, &pathLen, &total)) 
+    {
+        SearchSpace *space = sharedSearchSpace();
+        pathLen = solveProblem5(space, &from, &to, startTimeMin, path, pathEdges, &total);
+        addQueryStats(&stats, &space->stats);
+        routeCacheStore(&key, path, pathEdges, pathLen, total);
     }
 
-    if (pathLen == 1 || arrivalTime[target] >= INF) {
+    if (total >= INF) {
         printf("No path found between the selected nodes.\n");
+        if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+        TRACE_END("problem5", "query");
         return;
     }
 
-    double totalTime = arrivalTime[target] - startTimeMin;
+    double totalTime = total - startTimeMin;
     printf("\nFastest path found with travel time: %.1f minutes (%.1f hours)\n\n", totalTime, totalTime / 60.0);
 
-    printProblem5DetailsWithEdges(path, pathEdges, pathLen, source, target, 
-                                  srcLat, srcLon, destLat, destLon, startTimeMin);
+    PHASE_BEGIN(print);
+    ItineraryProfile profile = problemProfile(5);
+    Itinerary itinerary;
+    buildItinerary(path, pathEdges, pathLen, &from, &to, startTimeMin, &profile, &itinerary);
+    printProblem5Details(&itinerary);
+    PHASE_END(&stats, PHASE_PRINT, print);
+
+    PHASE_BEGIN(export);
+    exportItinerary(&itinerary, "route_problem5.kml");
+    freeItinerary(&itinerary);
+    PHASE_END(&stats, PHASE_EXPORT, export);
 
-    exportPathToKML(path, pathLen, "route_problem5.kml");
+    if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+    TRACE_END("problem5", "query");
 }
\ No newline at end of file
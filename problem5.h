@@ -1,10 +1,13 @@
 #ifndef problem5_H
 #define problem5_H
 
-void printProblem5DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon,
-                                    int startTimeMin);
+#include "search.h"
+#include "itinerary.h"
+#include "snap.h"
 
+void printProblem5Details(const Itinerary *it);
+
+int solveProblem5(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int startTimeMin, int path[], int pathEdges[], double *total);
 void runProblem5();           
                          
 #endif
\ No newline at end of file
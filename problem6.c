@@ -5,197 +5,198 @@
 #include "nodesAndEdges.h"
 #include "timeHandling.h"
 #include "csvParse.h"
-
-double getWaitingTimeProblem6(int currentTimeMin, Mode mode) {
+#include "routeExport.h"
+#include "itinerary.h"
+#include "routeCache.h"
+#include "search.h"
+#include "snap.h"
+#include "components.h"
+#include "modeProfile.h"
+#include "walkTransfers.h"
+#include "speedProfile.h"
+#include "timetable.h"
+
+double getWaitingTimeProblem6(int node, int currentTimeMin, Mode mode) {
 
     if (mode == MODE_CAR || mode == MODE_WALK) 
     {
         return 0.0;                 // Cars dont wait
     }
-    
-    int startTime, endTime, interval;
-    
-    // setting schedule
-    switch(mode) 
-    {
-        case MODE_METRO:
-            startTime = METRO_START_MIN;
-            endTime = METRO_END_MIN;
-            interval = METRO_INTERVAL_MIN;
-            break;
-        case MODE_BIKOLPO:
-            startTime = BIKOLPO_START_MIN;
-            endTime = BIKOLPO_END_MIN;
-            interval = BIKOLPO_INTERVAL_MIN;
-            break;
-        case MODE_UTTARA:
-            startTime = UTTARA_START_MIN;
-            endTime = UTTARA_END_MIN;
-            interval = UTTARA_INTERVAL_MIN;
-            break;
-        default:
-            return 0.0;
-    }
-    
-    if (currentTimeMin < startTime || currentTimeMin >= endTime) 
-    {
-        return INF;  // Service not available
-    }
-    
-    int minutesSinceStart = currentTimeMin - startTime;
-    
-    
-    int minutesToNext = interval - (minutesSinceStart % interval);      // Calculate time to next departure
-    if (minutesToNext == interval) 
-    {
-        minutesToNext = 0; 
-    }
-    return (double)minutesToNext;
+
+    return nextDepartureWait(&activeGraph->timetables[TIMETABLE_PROBLEM6], node, mode, currentTimeMin);
 }
 
-void printProblem6DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon,
-                                    int startTimeMin, int deadlineMin) {
-    double carRate = 20.0;
-    double metroRate = 5.0;
-    double bikolpoRate = 7.0;
-    double uttaraRate = 10.0;
-    double totalDistance = 0.0;
-    double totalCost = 0.0;
-    double totalTravelTime = 0.0;
-    double currentTime = startTimeMin;
-    
+void printProblem6Details(const Itinerary *it, int deadlineMin) {
+
     char timeBuffer[32];
     char deadlineBuffer[32];
 
     printf("\nProblem No: 6\n");
-    printf("Source: (%.6f, %.6f)\n", srcLon, srcLat);
-    printf("Destination: (%.6f, %.6f)\n", destLon, destLat);
-    formatTime(startTimeMin, timeBuffer, sizeof(timeBuffer));
+    printf("Source: (%.6f, %.6f)\n", it->srcLon, it->srcLat);
+    printf("Destination: (%.6f, %.6f)\n", it->destLon, it->destLat);
+    formatTime((int)it->startMin, timeBuffer, sizeof(timeBuffer));
     printf("Start Time: %s\n", timeBuffer);
     formatTime(deadlineMin, deadlineBuffer, sizeof(deadlineBuffer));
     printf("Deadline: %s\n", deadlineBuffer);
     printf("\n");
 
-    if (fabs(nodes[source].lat - srcLat) > 1e-6 || fabs(nodes[source].lon - srcLon) > 1e-6) 
+    printItineraryLegs(it, 1);
+
+    formatTime((int)it->arrivalMin, timeBuffer, sizeof(timeBuffer));
+    printf("\nArrival Time: %s\n", timeBuffer);
+    
+    if (it->arrivalMin <= deadlineMin) 
+    {
+        double slack = deadlineMin - it->arrivalMin;
+        printf("Status: ON TIME (%.0f minutes early)\n", slack);
+    } 
+    else 
     {
-        double walkDist = haversineDistance(srcLat, srcLon, nodes[source].lat, nodes[source].lon);
-        double walkTime = (walkDist / WALK_SPEED_KMH) * 60.0;
-        
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-
-        printf("[%s] Walk from Source (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳0.00\n",
-               timeBuffer, srcLon, srcLat, nodes[source].name, nodes[source].lon, nodes[source].lat, 
-               walkDist, walkTime);
-        totalDistance += walkDist;
-        totalTravelTime += walkTime;
-        currentTime += walkTime;
+        double late = it->arrivalMin - deadlineMin;
+        printf("Status: LATE (%.0f minutes late)\n", late);
     }
+    
+    printf("Total Distance: %.3f km\n", it->totalDistance);
+    printf("Total Travel Time: %.1f minutes (%.1f hours)\n", it->totalTravelMin, it->totalTravelMin / 60.0);
+    printf("Total Cost: ৳%.2f\n", it->totalCost);
+}
 
-    Mode prevMode = MODE_CAR;
-    int isFirstSegment = 1;
-
-    for (int i = pathLen - 1; i > 0; i--) {
-        int from = path[i];
-        int to = path[i - 1];
-        int edgeIdx = pathEdges[i - 1];
-        
-        double distSeg = 0;
-        Mode edgeMode = MODE_CAR;
-        
-        if (edgeIdx >= 0 && edgeIdx < numEdges) 
-        {
-            distSeg = edges[edgeIdx].distance;
-            edgeMode = edges[edgeIdx].mode;
-        }
+// Dijkstra on cost, dropping any edge that would arrive after the deadline
+int solveProblem6(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int startTimeMin, int deadlineMin, int path[], int pathEdges[], double *total) {
 
-        int needsWait = 0;
+    if (!mayReach(PROFILE_ALL, from, to))             // no route joins their components
+    {
+        *total = INF;
+        return 0;
+    }
 
-        if (edgeMode != MODE_CAR && edgeMode != MODE_WALK) 
+    PHASE_BEGIN(reset);
+    beginSearch(space);                 // Now we optimize for the cost
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+    markTargets(space, to);
+
+    const int *viewStart = profileAdjStart[PROFILE_ALL];          // only the edges this problem may use
+    const int *viewList = profileAdjList[PROFILE_ALL];
+
+    const ModeProfile *modes = getModeProfile(6);
+    const double *fare = modes->edgeFare;             // per edge, so relaxing is an add
+    double carRate = modes->rate[MODE_CAR];           // the partial rides at either end
+
+    for (int a = 0; a < from->numArcs; a++)          // every way onto the network starts labelled
+    {
+        const SnapArc *arc = &from->arcs[a];
+        if (isArcClosed(space->traffic, arc)) continue;
+
+        double arrival = startTimeMin + arcWalkMin(arc) + arcTravelMin(arc, modes->speed[MODE_CAR], startTimeMin + arcWalkMin(arc), space->traffic);
+        if (arrival <= deadlineMin) seedNode(space, arc->node, arcDistance(arc) * carRate, arrival, a);
+    }
+
+    SnapArc direct;
+    double directStart;
+    double best = INF;                  // best finish so far, the way off the network included
+    int bestNode = -1;                  // -1 while the best is riding straight along a shared road
+    int bestArc = -1;
+    double setOff = startTimeMin + (from->walkKm / WALK_SPEED_KMH) * 60.0;
+
+    if (snapDirectRide(from, to, &direct, &directStart) && !isArcClosed(space->traffic, &direct) &&
+        setOff + arcTravelMin(&direct, modes->speed[MODE_CAR], setOff, space->traffic) + (to->walkKm / WALK_SPEED_KMH) * 60.0 <= deadlineMin) 
+    {
+        best = arcDistance(&direct) * carRate;
+    }
+
+    double minCost;
+    int u;
+
+    while ((u = heapPop(space, &minCost)) != -1) 
+    {
+        if (space->settled[u] == 1 || minCost > space->dist[u]) continue;
+        if (space->settled[u] == 2)                 // one of the ways off the network starts here
         {
-            if (isFirstSegment || edgeMode != prevMode) 
+            for (int a = 0; a < to->numArcs; a++) 
             {
-                needsWait = 1;
+                const SnapArc *arc = &to->arcs[a];
+                if (arc->node != u || isArcClosed(space->traffic, arc)) continue;
+
+                double arrival = space->arrival[u] + arcTravelMin(arc, modes->speed[MODE_CAR], space->arrival[u], space->traffic) + arcWalkMin(arc);
+                double finish = space->dist[u] + arcDistance(arc) * carRate;
+                if (finish < best && arrival <= deadlineMin) 
+                {
+                    best = finish;
+                    bestNode = u;
+                    bestArc = a;
+                }
             }
         }
+        if (best <= minCost) break;               // nothing left in the heap can finish cheaper
+
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
+
+        // Determine the mode used to ARRIVE at node u
+        Mode arrivalMode = MODE_CAR;
+
+        if (space->prevEdge[u] >= 0 && space->prevEdge[u] < numEdges) 
+        {
+            arrivalMode = edges[space->prevEdge[u]].mode;
+        }
 
-        if (needsWait) 
+        for (int k = viewStart[u]; k < viewStart[u + 1]; k++) 
         {
-            double waitTime = getWaitingTimeProblem6((int)currentTime, edgeMode);
+            STAT_INC(&space->stats, edgesScanned);
+            int i = viewList[k];
+            if (isEdgeClosed(space->traffic, i)) continue;
+
+            if (!isWalkTransferAllowed(space->prevEdge[u], i)) continue;
+
+            int v = edges[i].to;
+
+            double waitTime = 0.0;
 
-            if (waitTime > 0 && waitTime < INF) 
+            if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_WALK) 
             {
-                formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-                printf("[%s] Wait for %s: %.0f minutes\n", timeBuffer, getModeName(edgeMode), waitTime);
-                currentTime += waitTime;
-                totalTravelTime += waitTime;
+                if (edges[i].mode != arrivalMode || space->prevEdge[u] < 0) 
+                {
+                    waitTime = getWaitingTimeProblem6(u, (int)space->arrival[u], edges[i].mode);
+                    STAT_INC(&space->stats, waitsComputed);
+
+                    if (waitTime >= INF) 
+                    {
+                        STAT_INC(&space->stats, infWaitsSkipped);
+                        continue;  // Service not available
+                    }
+                }
             }
-        }
 
-        double rate = carRate;
-        if (edgeMode == MODE_METRO) rate = metroRate;
-        else if (edgeMode == MODE_BIKOLPO) rate = bikolpoRate;
-        else if (edgeMode == MODE_UTTARA) rate = uttaraRate;
-        
-        double costSeg = distSeg * rate;
-        
-        // Calculate travel time based on transportation
-        double speed = CAR_SPEED_PROBLEM6_KMH;
-        if (edgeMode == MODE_METRO) speed = METRO_SPEED_PROBLEM6_KMH;
-        else if (edgeMode == MODE_BIKOLPO) speed = BIKOLPO_SPEED_PROBLEM6_KMH;
-        else if (edgeMode == MODE_UTTARA) speed = UTTARA_SPEED_PROBLEM6_KMH;
-        
-        double travelTime = (distSeg / speed) * 60.0;
-        
-        totalDistance += distSeg;
-        totalCost += costSeg;
-        totalTravelTime += travelTime;
-
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-
-        printf("[%s] Ride %s from %s (%.6f, %.6f) to %s (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳%.2f\n",
-               timeBuffer, getModeName(edgeMode),
-               nodes[from].name, nodes[from].lon, nodes[from].lat,
-               nodes[to].name, nodes[to].lon, nodes[to].lat,
-               distSeg, travelTime, costSeg);
-        
-        currentTime += travelTime;
-        prevMode = edgeMode;
-        isFirstSegment = 0;
-    }
+            double travelTime = modeEdgeMin(modes, i, space->arrival[u] + waitTime) / trafficFactor(space->traffic, i);     // speed at the time we set off
+            double newArrivalTime = space->arrival[u] + waitTime + travelTime;
 
-    if (fabs(nodes[target].lat - destLat) > 1e-6 || fabs(nodes[target].lon - destLon) > 1e-6) 
-    {
-        double walkDist = haversineDistance(nodes[target].lat, nodes[target].lon, destLat, destLon);
-        double walkTime = (walkDist / WALK_SPEED_KMH) * 60.0;
-        
-        formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-
-        printf("[%s] Walk from %s (%.6f, %.6f) to Destination (%.6f, %.6f), Distance: %.3f km, Time: %.1f min, Cost: ৳0.00\n",
-               timeBuffer, nodes[target].name, nodes[target].lon, nodes[target].lat, 
-               destLon, destLat, walkDist, walkTime);
-        totalDistance += walkDist;
-        totalTravelTime += walkTime;
-        currentTime += walkTime;
-    }
+            if (newArrivalTime > deadlineMin) {
+                continue;  // Would miss deadline so we skip the edge
+            }
 
-    formatTime((int)currentTime, timeBuffer, sizeof(timeBuffer));
-    printf("\nArrival Time: %s\n", timeBuffer);
-    
-    if (currentTime <= deadlineMin) 
-    {
-        double slack = deadlineMin - currentTime;
-        printf("Status: ON TIME (%.0f minutes early)\n", slack);
-    } 
-    else 
-    {
-        double late = currentTime - deadlineMin;
-        printf("Status: LATE (%.0f minutes late)\n", late);
+            double newCost = space->dist[u] + fare[i];
+
+            // Update if cheaper and meets deadline
+            touchNode(space, v);
+            if (newCost < space->dist[v]) 
+            {
+                space->dist[v] = newCost;
+                space->prev[v] = u;
+                space->prevEdge[v] = i;
+                space->arrival[v] = newArrivalTime;
+                heapPush(space, newCost, v);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
     }
-    
-    printf("Total Distance: %.3f km\n", totalDistance);
-    printf("Total Travel Time: %.1f minutes (%.1f hours)\n", totalTravelTime, totalTravelTime / 60.0);
-    printf("Total Cost: ৳%.2f\n", totalCost);
+
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    PHASE_BEGIN(path);
+    int pathLen = finishPath(space, bestNode, bestArc, path, pathEdges);
+    *total = best;
+    PHASE_END(&space->stats, PHASE_PATH, path);
+    return pathLen;
 }
 
 void runProblem6() {
@@ -245,138 +246,60 @@ void runProblem6() {
         return;
     }
 
-    int source = findNearestNode(srcLat, srcLon);
-    int target = findNearestNode(destLat, destLon);
+    QueryStats stats;
+    clearQueryStats(&stats);
+
+    TRACE_BEGIN("problem6", "query");
+    PHASE_BEGIN(snap);
+    SnapPoint from, to;
+    int snapped = snapSource(srcLat, srcLon, TRANSIT_MODE_BITS, &from) == 0 && snapTarget(destLat, destLon, TRANSIT_MODE_BITS, &to) == 0;
+    PHASE_END(&stats, PHASE_SNAP, snap);
 
-    if (source == -1 || target == -1) {
+    if (!snapped) {
         printf("Error: Could not find nodes\n");
+        TRACE_END("problem6", "query");
         return;
     }
 
-    printf("\nUsing nearest nodes:\n");
-    printf("Source Node: %s (%.6f, %.6f)\n", nodes[source].name, nodes[source].lat, nodes[source].lon);
-    printf("Target Node: %s (%.6f, %.6f)\n", nodes[target].name, nodes[target].lat, nodes[target].lon);
-
-    for (int i = 0; i < numNodes; i++) 
-    {                                       // Now we optimize for the cost
-        dist[i] = INF;
-        prev[i] = -1;
-        prevEdge[i] = -1;
-        visited[i] = 0;
-        arrivalTime[i] = INF;
-    }
-    dist[source] = 0;
-    arrivalTime[source] = startTimeMin;
-
-    double carRate = 20.0;
-    double metroRate = 5.0;
-    double bikolpoRate = 7.0;
-    double uttaraRate = 10.0;
-
-    for (int count = 0; count < numNodes; count++) 
-    {
-        int u = -1;
-        double minCost = INF;
-
-        // Find unvisited node with minimum cost that can still meet deadline
-        for (int i = 0; i < numNodes; i++) 
-        {
-            if (!visited[i] && dist[i] < minCost) 
-            {
-                minCost = dist[i];
-                u = i;
-            }
-        }
-
-        if (u == -1 || u == target) break;
-
-        visited[u] = 1;
-
-        // Determine the mode used to ARRIVE at node u
-        Mode arrivalMode = MODE_CAR;
-
-        if (prevEdge[u] >= 0 && prevEdge[u] < numEdges) 
-        {
-            arrivalMode = edges[prevEdge[u]].mode;
-        }
-
-        for (int i = 0; i < numEdges; i++) 
-        {
-            if (edges[i].from == u) 
-            {
-                if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_METRO && 
-                    edges[i].mode != MODE_BIKOLPO && edges[i].mode != MODE_UTTARA) {
-                    continue;
-                }
-                
-                int v = edges[i].to;
-                
-                double waitTime = 0.0;
-
-                if (edges[i].mode != MODE_CAR && edges[i].mode != MODE_WALK) 
-                {
-                    if (edges[i].mode != arrivalMode || u == source) 
-                    {
-                        waitTime = getWaitingTimeProblem6((int)arrivalTime[u], edges[i].mode);
-
-                        if (waitTime >= INF) 
-                        {
-                            continue;  // Service not available
-                        }
-                    }
-                }
-                
-                double speed = CAR_SPEED_PROBLEM6_KMH;
-
-                if (edges[i].mode == MODE_METRO) speed = METRO_SPEED_PROBLEM6_KMH;
-                else if (edges[i].mode == MODE_BIKOLPO) speed = BIKOLPO_SPEED_PROBLEM6_KMH;
-                else if (edges[i].mode == MODE_UTTARA) speed = UTTARA_SPEED_PROBLEM6_KMH;
-                
-                double travelTime = (edges[i].distance / speed) * 60.0;
-                double newArrivalTime = arrivalTime[u] + waitTime + travelTime;
-                
-                if (newArrivalTime > deadlineMin) {
-                    continue;  // Would miss deadline so we skip the edge
-                }
-            
-                double rate = carRate;
-                if (edges[i].mode == MODE_METRO) rate = metroRate;
-                else if (edges[i].mode == MODE_BIKOLPO) rate = bikolpoRate;
-                else if (edges[i].mode == MODE_UTTARA) rate = uttaraRate;
-                
-                double edgeCost = edges[i].distance * rate;
-                double newCost = dist[u] + edgeCost;
-                
-                // Update if cheaper and meets deadline
-                if (newCost < dist[v]) 
-                {
-                    dist[v] = newCost;
-                    prev[v] = u;
-                    prevEdge[v] = i;
-                    arrivalTime[v] = newArrivalTime;
-                }
-            }
-        }
-    }
+    printf("\nSnapped to the nearest road:\n");
+    printSnapPoint("Source", &from);
+    printSnapPoint("Target", &to);
 
     int path[MAX_NODES];
     int pathEdges[MAX_NODES];
     int pathLen = 0;
-    for (int at = target; at != -1; at = prev[at]) {
-        path[pathLen] = at;
-        pathEdges[pathLen] = prevEdge[at];
-        pathLen++;
+    double total = INF;
+    RouteKey key = makeRouteKey(6, &from, &to, startTimeMin, deadlineMin);
+
+    if (!routeCacheLookup(&key, path, pathEdges, &pathLen, &total)) 
+    {
+        SearchSpace *space = sharedSearchSpace();
+        pathLen = solveProblem6(space, &from, &to, startTimeMin, deadlineMin, path, pathEdges, &total);
+        addQueryStats(&stats, &space->stats);
+        routeCacheStore(&key, path, pathEdges, pathLen, total);
     }
 
-    if (pathLen == 1 || dist[target] >= INF) {
+    if (total >= INF) {
         printf("No path found that meets the deadline constraint.\n");
+        if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+        TRACE_END("problem6", "query");
         return;
     }
 
-    printf("\nCheapest deadline-constrained path found with cost: ৳%.2f\n\n", dist[target]);
+    printf("\nCheapest deadline-constrained path found with cost: ৳%.2f\n\n", total);
+
+    PHASE_BEGIN(print);
+    ItineraryProfile profile = problemProfile(6);
+    Itinerary itinerary;
+    buildItinerary(path, pathEdges, pathLen, &from, &to, startTimeMin, &profile, &itinerary);
+    printProblem6Details(&itinerary, deadlineMin);
+    PHASE_END(&stats, PHASE_PRINT, print);
 
-    printProblem6DetailsWithEdges(path, pathEdges, pathLen, source, target, 
-                                  srcLat, srcLon, destLat, destLon, startTimeMin, deadlineMin);
+    PHASE_BEGIN(export);
+    exportItinerary(&itinerary, "route_problem6.kml");
+    freeItinerary(&itinerary);
+    PHASE_END(&stats, PHASE_EXPORT, export);
 
-    exportPathToKML(path, pathLen, "route_problem6.kml");
+    if (queryStatsEnabled()) printQueryStats(&stats, stdout);
+    TRACE_END("problem6", "query");
 }
\ No newline at end of file
@@ -1,13 +1,16 @@
 #ifndef problem6_H
 #define problem6_H
 
+#include "search.h"
+#include "itinerary.h"
+#include "snap.h"
+
 #include "mode.h"
 
-double getWaitingTimeProblem6(int currentTimeMin, Mode mode);
+double getWaitingTimeProblem6(int node, int currentTimeMin, Mode mode);
 
-void printProblem6DetailsWithEdges(int path[], int pathEdges[], int pathLen, int source, int target, 
-                                    double srcLat, double srcLon, double destLat, double destLon,
-                                    int startTimeMin, int deadlineMin);
+void printProblem6Details(const Itinerary *it, int deadlineMin);
+int solveProblem6(SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int startTimeMin, int deadlineMin, int path[], int pathEdges[], double *total);
 void runProblem6();
 
 #endif
\ No newline at end of file
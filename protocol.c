@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "protocol.h"
+
+static int writeAll(int fd, const char *data, size_t len) {
+
+    while (len > 0) 
+    {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int readAll(int fd, char *data, size_t len) {
+
+    while (len > 0) 
+    {
+        ssize_t n = read(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+int writeFrame(int fd, const char *data, uint32_t len) {
+
+    if (len > MAX_FRAME_BYTES) return -1;
+    if (writeAll(fd, (const char *)&len, sizeof(len)) != 0) return -1;
+
+    return writeAll(fd, data, len);
+}
+
+// Returns a malloc'd, NUL terminated payload, or NULL on EOF / error / oversize frame
+char *readFrame(int fd, uint32_t *len) {
+
+    uint32_t size;
+    if (readAll(fd, (char *)&size, sizeof(size)) != 0 || size > MAX_FRAME_BYTES) return NULL;
+
+    char *data = malloc(size + 1);
+    if (!data) return NULL;
+
+    if (readAll(fd, data, size) != 0) 
+    {
+        free(data);
+        return NULL;
+    }
+
+    data[size] = '\0';
+    if (len) *len = size;
+    return data;
+}
+
+int connectUnixSocket(const char *path) {
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) 
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
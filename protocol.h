@@ -0,0 +1,27 @@
+#ifndef protocol_H
+#define protocol_H
+
+#include <stdint.h>
+
+// Framing for the query daemon: a 4 byte length in host byte order (the socket is
+// local) followed by that many bytes of ASCII text.
+//
+// Request:  "<problem> <srcLat> <srcLon> <destLat> <destLon> [startMin] [deadlineMin]"
+//           times are minutes after midnight, only problems 4-6 use them
+// Response: "OK <total> <numLegs>\n" then one "<mode> <fromLat> <fromLon> <toLat> <toLon> <km>\n"
+//           per edge from source to target, or "NOPATH\n", or "ERR <reason>\n". Both points snap
+//           to the nearest road, the first and last lines may cover part of an edge only.
+//
+// Traffic:  "TRAFFIC <fromLat> <fromLon> <toLat> <toLon> <factor>", factor 0 closes the segment
+// Response: "OK <edgesPatched> <applyMicroseconds>\n"
+//
+// Reload:   "RELOAD" rebuilds the graph from the data files while other workers keep serving
+// Response: "OK <graphVersion> <milliseconds>\n"
+
+#define MAX_FRAME_BYTES (4 * 1024 * 1024)
+
+int writeFrame(int fd, const char *data, uint32_t len);
+char *readFrame(int fd, uint32_t *len);
+int connectUnixSocket(const char *path);
+
+#endif
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "nodesAndEdges.h"
+#include "routeCache.h"
+
+typedef struct CachedRoute 
+{
+    RouteKey key;
+    int graphVersion;
+    int pathLen;
+    int *path;              // one allocation, path then pathEdges
+    int *pathEdges;
+    double total;
+    struct CachedRoute *hashNext;
+    struct CachedRoute *lruPrev;        // most recently used at the head
+    struct CachedRoute *lruNext;
+} CachedRoute;
+
+static CachedRoute *buckets[ROUTE_CACHE_BUCKETS];
+static CachedRoute *lruHead = NULL;
+static CachedRoute *lruTail = NULL;
+static int entries = 0;
+static long hits = 0;
+static long misses = 0;
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+RouteKey makeRouteKey(int problem, const SnapPoint *from, const SnapPoint *to, int startTimeMin, int deadlineMin) {
+
+    RouteKey key;
+    memset(&key, 0, sizeof(key));
+
+    key.problem = problem;
+    key.srcLatE6 = (int)lround(from->lat * 1e6);
+    key.srcLonE6 = (int)lround(from->lon * 1e6);
+    key.destLatE6 = (int)lround(to->lat * 1e6);
+    key.destLonE6 = (int)lround(to->lon * 1e6);
+    key.startBucket = startTimeMin / ROUTE_CACHE_TIME_BUCKET_MIN;
+    key.deadlineBucket = deadlineMin / ROUTE_CACHE_TIME_BUCKET_MIN;
+    key.graphId = activeGraph ? activeGraph->id : 0;
+    key.graphVersion = __atomic_load_n(&graphVersion, __ATOMIC_ACQUIRE);
+
+    return key;
+}
+
+static unsigned hashKey(const RouteKey *key) {
+
+    unsigned h = 2166136261u;           // FNV-1a over the fields
+    int fields[8] = { key->problem, key->srcLatE6, key->srcLonE6, key->destLatE6, key->destLonE6,
+                      key->startBucket, key->deadlineBucket, key->graphId };
+
+    for (int i = 0; i < 8; i++) 
+    {
+        h ^= (unsigned)fields[i];
+        h *= 16777619u;
+    }
+
+    return h % ROUTE_CACHE_BUCKETS;
+}
+
+static int sameKey(const RouteKey *a, const RouteKey *b) {
+
+    return a->problem == b->problem && a->srcLatE6 == b->srcLatE6 && a->srcLonE6 == b->srcLonE6 &&
+           a->destLatE6 == b->destLatE6 && a->destLonE6 == b->destLonE6 && a->startBucket == b->startBucket &&
+           a->deadlineBucket == b->deadlineBucket && a->graphId == b->graphId;
+}
+
+static void lruUnlink(CachedRoute *entry) {
+
+    if (entry->lruPrev) entry->lruPrev->lruNext = entry->lruNext;
+    else lruHead = entry->lruNext;
+
+    if (entry->lruNext) entry->lruNext->lruPrev = entry->lruPrev;
+    else lruTail = entry->lruPrev;
+
+    entry->lruPrev = entry->lruNext = NULL;
+}
+
+static void lruPushFront(CachedRoute *entry) {
+
+    entry->lruPrev = NULL;
+    entry->lruNext = lruHead;
+
+    if (lruHead) lruHead->lruPrev = entry;
+    lruHead = entry;
+
+    if (!lruTail) lruTail = entry;
+}
+
+static void removeEntry(CachedRoute *entry) {
+
+    CachedRoute **link = &buckets[hashKey(&entry->key)];
+
+    while (*link != entry) link = &(*link)->hashNext;
+    *link = entry->hashNext;
+
+    lruUnlink(entry);
+    free(entry->path);
+    free(entry);
+    entries--;
+}
+
+// Copies a cached route into the caller's arrays; entries from an older graph are dropped on sight
+int routeCacheLookup(const RouteKey *key, int path[], int pathEdges[], int *pathLen, double *total) {
+
+    pthread_mutex_lock(&cacheLock);
+
+    CachedRoute *entry = buckets[hashKey(key)];
+    while (entry && !sameKey(&entry->key, key)) entry = entry->hashNext;
+
+    if (entry && entry->graphVersion != key->graphVersion) 
+    {
+        removeEntry(entry);
+        entry = NULL;
+    }
+
+    if (!entry) 
+    {
+        misses++;
+        pthread_mutex_unlock(&cacheLock);
+        return 0;
+    }
+
+    hits++;
+    lruUnlink(entry);
+    lruPushFront(entry);
+
+    memcpy(path, entry->path, sizeof(int) * entry->pathLen);
+    memcpy(pathEdges, entry->pathEdges, sizeof(int) * entry->pathLen);
+    *pathLen = entry->pathLen;
+    *total = entry->total;
+
+    pthread_mutex_unlock(&cacheLock);
+    return 1;
+}
+
+void routeCacheStore(const RouteKey *key, const int path[], const int pathEdges[], int pathLen, double total) {
+
+    pthread_mutex_lock(&cacheLock);
+
+    CachedRoute *entry = buckets[hashKey(key)];
+    while (entry && !sameKey(&entry->key, key)) entry = entry->hashNext;
+    if (entry) removeEntry(entry);
+
+    while (entries >= ROUTE_CACHE_CAPACITY && lruTail) removeEntry(lruTail);
+
+    entry = calloc(1, sizeof(CachedRoute));
+    entry->key = *key;
+    entry->graphVersion = key->graphVersion;       // an update racing the search leaves it tagged stale, never fresh
+    entry->pathLen = pathLen;
+    entry->path = malloc(sizeof(int) * (2 * pathLen + 1));
+    entry->pathEdges = entry->path + pathLen;
+    entry->total = total;
+
+    memcpy(entry->path, path, sizeof(int) * pathLen);
+    memcpy(entry->pathEdges, pathEdges, sizeof(int) * pathLen);
+
+    unsigned h = hashKey(key);
+    entry->hashNext = buckets[h];
+    buckets[h] = entry;
+    lruPushFront(entry);
+    entries++;
+
+    pthread_mutex_unlock(&cacheLock);
+}
+
+// Hook for anything that changes nodes[] or edges[] outside buildAdjacency()
+void routeCacheInvalidate() {
+
+    pthread_mutex_lock(&cacheLock);
+    while (lruHead) removeEntry(lruHead);
+    pthread_mutex_unlock(&cacheLock);
+}
+
+void routeCacheStats(long *hitCount, long *missCount, int *entryCount) {
+
+    pthread_mutex_lock(&cacheLock);
+    *hitCount = hits;
+    *missCount = misses;
+    *entryCount = entries;
+    pthread_mutex_unlock(&cacheLock);
+}
@@ -0,0 +1,29 @@
+#ifndef routeCache_H
+#define routeCache_H
+
+#define ROUTE_CACHE_CAPACITY 1024
+#define ROUTE_CACHE_BUCKETS 2048
+#define ROUTE_CACHE_TIME_BUCKET_MIN 1       // waits are whole minutes, so coarser buckets would change answers
+
+#include "snap.h"
+
+typedef struct 
+{
+    int problem;
+    int srcLatE6;           // query points to the microdegree: the walks to the road and to
+    int srcLonE6;           // every nearby stop all follow from them
+    int destLatE6;
+    int destLonE6;
+    int startBucket;
+    int deadlineBucket;
+    int graphId;            // pinned graph, node ids mean nothing in any other version
+    int graphVersion;       // weights the answer will be computed on, taken before the search starts
+} RouteKey;
+
+RouteKey makeRouteKey(int problem, const SnapPoint *from, const SnapPoint *to, int startTimeMin, int deadlineMin);
+int routeCacheLookup(const RouteKey *key, int path[], int pathEdges[], int *pathLen, double *total);
+void routeCacheStore(const RouteKey *key, const int path[], const int pathEdges[], int pathLen, double total);
+void routeCacheInvalidate();
+void routeCacheStats(long *hits, long *misses, int *entries);
+
+#endif
@@ -0,0 +1,476 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "itinerary.h"
+#include "snap.h"
+#include "routeExport.h"
+
+// Route geometry split into one leg per run of same-mode edges
+typedef struct 
+{
+    ShapePoint *points;
+    int numPoints;
+    int *legStart;          // first point of each leg, legStart[numLegs] == numPoints
+    Mode *legMode;
+    int numLegs;
+} RouteGeometry;
+
+typedef struct 
+{
+    FILE *f;
+    char data[EXPORT_BUFFER_BYTES];
+    int len;
+} OutBuffer;
+
+static void flushOut(OutBuffer *out) {
+
+    fwrite(out->data, 1, out->len, out->f);
+    out->len = 0;
+}
+
+static void putStr(OutBuffer *out, const char *s) {
+
+    while (*s) 
+    {
+        if (out->len == EXPORT_BUFFER_BYTES) flushOut(out);
+        out->data[out->len++] = *s++;
+    }
+}
+
+static void putInt(OutBuffer *out, long long v) {
+
+    char digits[24];
+    int n = 0;
+
+    if (out->len + 24 > EXPORT_BUFFER_BYTES) flushOut(out);
+    if (v < 0) 
+    {
+        out->data[out->len++] = '-';
+        v = -v;
+    }
+
+    do 
+    {
+        digits[n++] = '0' + (char)(v % 10);
+        v /= 10;
+    } while (v > 0);
+
+    while (n > 0) out->data[out->len++] = digits[--n];
+}
+
+// Same text as "%.6f" for coordinates, without going through printf
+static void putFixed6(OutBuffer *out, double v) {
+
+    long long scaled = llround(v * 1e6);
+
+    if (out->len + 32 > EXPORT_BUFFER_BYTES) flushOut(out);
+    if (scaled < 0) 
+    {
+        out->data[out->len++] = '-';
+        scaled = -scaled;
+    }
+
+    putInt(out, scaled / 1000000);
+    out->data[out->len++] = '.';
+
+    long long frac = scaled % 1000000;
+    for (long long div = 100000; div > 0; div /= 10) out->data[out->len++] = '0' + (char)((frac / div) % 10);
+}
+
+static void pushPoint(RouteGeometry *g, int *capacity, double lat, double lon) {
+
+    if (g->numPoints == *capacity) 
+    {
+        *capacity *= 2;
+        g->points = realloc(g->points, sizeof(ShapePoint) * *capacity);
+    }
+
+    g->points[g->numPoints].lat = lat;
+    g->points[g->numPoints].lon = lon;
+    g->numPoints++;
+}
+
+static void startLeg(RouteGeometry *g, int *capacity, Mode mode, double lat, double lon) {
+
+    g->legStart[g->numLegs] = g->numPoints;
+    g->legMode[g->numLegs] = mode;
+    g->numLegs++;
+    pushPoint(g, capacity, lat, lon);               // each leg repeats the joint point
+}
+
+// Edge geometry between two positions along it (0..1 by length), the start point excluded.
+// Whole edges are the common case; only the rides to and from a road point get clipped.
+static void pushEdgeShape(RouteGeometry *g, int *capacity, int edgeIdx, double startPos, double endPos) {
+
+    const Edge *e = &edges[edgeIdx];
+
+    if (startPos <= 0.0 && endPos >= 1.0) 
+    {
+        for (int s = 0; s < e->shapeCount; s++)            // contracted chains keep their full shape
+        {
+            ShapePoint *pt = &shapePoints[e->shapeStart + s];
+            pushPoint(g, capacity, pt->lat, pt->lon);
+        }
+
+        pushPoint(g, capacity, nodes[e->to].lat, nodes[e->to].lon);
+        return;
+    }
+
+    double length = 0, lat1, lon1, lat2, lon2;
+
+    for (int k = 0; k <= e->shapeCount; k++) 
+    {
+        edgeVertex(edgeIdx, k, &lat1, &lon1);
+        edgeVertex(edgeIdx, k + 1, &lat2, &lon2);
+        length += haversineDistance(lat1, lon1, lat2, lon2);
+    }
+
+    double walked = 0;
+
+    for (int k = 0; k <= e->shapeCount; k++) 
+    {
+        edgeVertex(edgeIdx, k, &lat1, &lon1);
+        edgeVertex(edgeIdx, k + 1, &lat2, &lon2);
+        double d = haversineDistance(lat1, lon1, lat2, lon2);
+
+        if (k == e->shapeCount || (length > 0 && (walked + d) / length >= endPos)) 
+        {
+            double t = d > 0 ? (endPos * length - walked) / d : 1.0;
+            if (t < 0) t = 0;
+            if (t > 1) t = 1;
+            pushPoint(g, capacity, lat1 + t * (lat2 - lat1), lon1 + t * (lon2 - lon1));
+            return;
+        }
+
+        if (length > 0 && (walked + d) / length > startPos) pushPoint(g, capacity, lat2, lon2);
+        walked += d;
+    }
+}
+
+// The itinerary legs plus the walks to and from the road
+static void buildGeometry(const Itinerary *it, RouteGeometry *g) {
+
+    int capacity = it->numEdges + 16;
+    double lat, lon;
+    g->points = malloc(sizeof(ShapePoint) * capacity);
+    g->legStart = malloc(sizeof(int) * (it->numLegs + 3));
+    g->legMode = malloc(sizeof(Mode) * (it->numLegs + 3));
+    g->numPoints = 0;
+    g->numLegs = 0;
+
+    if (it->walkInKm > 0) 
+    {
+        startLeg(g, &capacity, MODE_WALK, it->srcLat, it->srcLon);
+        itineraryPoint(it, it->source, 0, &lat, &lon);
+        pushPoint(g, &capacity, lat, lon);
+    }
+
+    for (int l = 0; l < it->numLegs; l++) 
+    {
+        const ItineraryLeg *leg = &it->legs[l];
+        itineraryPoint(it, leg->fromNode, 0, &lat, &lon);
+        startLeg(g, &capacity, leg->mode, lat, lon);
+
+        for (int k = leg->firstEdge; k < leg->firstEdge + leg->numEdges; k++) 
+        {
+            int edgeIdx = it->edgeIds[k];
+            if (edgeIdx < 0 || edgeIdx >= numEdges) continue;
+
+            pushEdgeShape(g, &capacity, edgeIdx, k == 0 ? it->firstEdgeStart : 0.0,
+                          k == it->numEdges - 1 ? it->lastEdgeEnd : 1.0);
+        }
+    }
+
+    if (it->walkOutKm > 0) 
+    {
+        itineraryPoint(it, it->target, 1, &lat, &lon);
+        startLeg(g, &capacity, MODE_WALK, lat, lon);
+        pushPoint(g, &capacity, it->destLat, it->destLon);
+    }
+
+    if (g->numLegs == 0)                    // source and target on the same point of the road
+    {
+        itineraryPoint(it, it->source, 0, &lat, &lon);
+        startLeg(g, &capacity, MODE_WALK, lat, lon);
+    }
+
+    g->legStart[g->numLegs] = g->numPoints;
+}
+
+// Distance in metres from p to segment a-b on a local flat projection, fine at city scale
+static double segmentDistanceM(const ShapePoint *p, const ShapePoint *a, const ShapePoint *b) {
+
+    double kx = cos(a->lat * PI / 180.0) * EARTH_RADIUS_KM * 1000.0 * PI / 180.0;
+    double ky = EARTH_RADIUS_KM * 1000.0 * PI / 180.0;
+    double bx = (b->lon - a->lon) * kx, by = (b->lat - a->lat) * ky;
+    double px = (p->lon - a->lon) * kx, py = (p->lat - a->lat) * ky;
+    double len2 = bx * bx + by * by;
+    double t = (len2 > 0) ? (px * bx + py * by) / len2 : 0;
+
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+
+    double dx = px - t * bx, dy = py - t * by;
+    return sqrt(dx * dx + dy * dy);
+}
+
+// Douglas-Peucker over points[first..last], with an explicit stack so long legs cannot overflow
+static void simplifyRange(const ShapePoint *points, int first, int last, double toleranceM, char keep[], int stack[]) {
+
+    int top = 0;
+    keep[first] = keep[last] = 1;
+    stack[top++] = first;
+    stack[top++] = last;
+
+    while (top > 0) 
+    {
+        int hi = stack[--top];
+        int lo = stack[--top];
+        int farthest = -1;
+        double maxDist = toleranceM;
+
+        for (int i = lo + 1; i < hi; i++) 
+        {
+            double d = segmentDistanceM(&points[i], &points[lo], &points[hi]);
+            if (d > maxDist) 
+            {
+                maxDist = d;
+                farthest = i;
+            }
+        }
+
+        if (farthest < 0) continue;
+
+        keep[farthest] = 1;
+        stack[top++] = lo;
+        stack[top++] = farthest;
+        stack[top++] = farthest;
+        stack[top++] = hi;
+    }
+}
+
+static const char *kmlModeColor(Mode mode) {          // aabbggrr
+
+    switch (mode) 
+    {
+        case MODE_WALK: return "ff9e9e9e";
+        case MODE_METRO: return "ffd08a1e";
+        case MODE_BIKOLPO: return "ff3c9b2e";
+        case MODE_UTTARA: return "ff0080ff";
+        default: return "ff2020d0";
+    }
+}
+
+static const char *htmlModeColor(Mode mode) {
+
+    switch (mode) 
+    {
+        case MODE_WALK: return "#9e9e9e";
+        case MODE_METRO: return "#1e8ad0";
+        case MODE_BIKOLPO: return "#2e9b3c";
+        case MODE_UTTARA: return "#ff8000";
+        default: return "#d02020";
+    }
+}
+
+static void writeKML(OutBuffer *out, const RouteGeometry *g, const char keep[]) {
+
+    putStr(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    putStr(out, "<kml xmlns=\"http://earth.google.com/kml/2.1\">\n<Document>\n<name>Route</name>\n");
+
+    for (int m = MODE_WALK; m <= MODE_UTTARA; m++) 
+    {
+        putStr(out, "<Style id=\"mode");
+        putInt(out, m);
+        putStr(out, "\"><LineStyle><color>");
+        putStr(out, kmlModeColor(m));
+        putStr(out, "</color><width>4</width></LineStyle></Style>\n");
+    }
+
+    for (int l = 0; l < g->numLegs; l++) 
+    {
+        putStr(out, "<Placemark>\n<name>Leg ");
+        putInt(out, l + 1);
+        putStr(out, ": ");
+        putStr(out, getModeName(g->legMode[l]));
+        putStr(out, "</name>\n<styleUrl>#mode");
+        putInt(out, g->legMode[l]);
+        putStr(out, "</styleUrl>\n<LineString>\n<tessellate>1</tessellate>\n<coordinates>\n");
+
+        for (int i = g->legStart[l]; i < g->legStart[l + 1]; i++) 
+        {
+            if (!keep[i]) continue;
+            putFixed6(out, g->points[i].lon);           // So that we dont accidently do rooftop parkour
+            putStr(out, ",");
+            putFixed6(out, g->points[i].lat);
+            putStr(out, ",0\n");
+        }
+
+        putStr(out, "</coordinates>\n</LineString>\n</Placemark>\n");
+    }
+
+    putStr(out, "</Document>\n</kml>\n");
+}
+
+static void writeGeoJSON(OutBuffer *out, const RouteGeometry *g, const char keep[]) {
+
+    putStr(out, "{\"type\":\"FeatureCollection\",\"features\":[\n");
+
+    for (int l = 0; l < g->numLegs; l++) 
+    {
+        putStr(out, "{\"type\":\"Feature\",\"properties\":{\"leg\":");
+        putInt(out, l + 1);
+        putStr(out, ",\"mode\":\"");
+        putStr(out, getModeName(g->legMode[l]));
+        putStr(out, "\",\"stroke\":\"");
+        putStr(out, htmlModeColor(g->legMode[l]));
+        putStr(out, "\"},\"geometry\":{\"type\":\"LineString\",\"coordinates\":[");
+
+        int first = 1;
+        for (int i = g->legStart[l]; i < g->legStart[l + 1]; i++) 
+        {
+            if (!keep[i]) continue;
+            putStr(out, first ? "[" : ",[");
+            putFixed6(out, g->points[i].lon);
+            putStr(out, ",");
+            putFixed6(out, g->points[i].lat);
+            putStr(out, "]");
+            first = 0;
+        }
+
+        putStr(out, l + 1 < g->numLegs ? "]}},\n" : "]}}\n");
+    }
+
+    putStr(out, "]}\n");
+}
+
+static void putPolylineValue(OutBuffer *out, long long delta) {
+
+    unsigned long long v = (delta < 0) ? ~((unsigned long long)delta << 1) : ((unsigned long long)delta << 1);
+    char chunk[2] = { 0, 0 };
+
+    while (v >= 0x20) 
+    {
+        chunk[0] = (char)((0x20 | (v & 0x1f)) + 63);
+        putStr(out, chunk);
+        v >>= 5;
+    }
+
+    chunk[0] = (char)(v + 63);
+    putStr(out, chunk);
+}
+
+// Google encoded polyline (precision 5), one "<mode>\t<polyline>" line per leg
+static void writePolyline(OutBuffer *out, const RouteGeometry *g, const char keep[]) {
+
+    for (int l = 0; l < g->numLegs; l++) 
+    {
+        long long prevLat = 0, prevLon = 0;
+
+        putStr(out, getModeName(g->legMode[l]));
+        putStr(out, "\t");
+
+        for (int i = g->legStart[l]; i < g->legStart[l + 1]; i++) 
+        {
+            if (!keep[i]) continue;
+
+            long long lat = llround(g->points[i].lat * 1e5);
+            long long lon = llround(g->points[i].lon * 1e5);
+            putPolylineValue(out, lat - prevLat);
+            putPolylineValue(out, lon - prevLon);
+            prevLat = lat;
+            prevLon = lon;
+        }
+
+        putStr(out, "\n");
+    }
+}
+
+ExportFormat exportFormatFromName(const char *filename) {
+
+    const char *dot = strrchr(filename, '.');
+
+    if (dot && (strcmp(dot, ".geojson") == 0 || strcmp(dot, ".json") == 0)) return EXPORT_GEOJSON;
+    if (dot && strcmp(dot, ".polyline") == 0) return EXPORT_POLYLINE;
+    return EXPORT_KML;
+}
+
+// Writes the route in one of the export formats. toleranceM > 0 runs Douglas-Peucker
+// per leg, leg end points are always kept so the legs still join up.
+int exportRoute(const Itinerary *it, const char *filename, ExportFormat format, double toleranceM) {
+
+    OutBuffer *out = malloc(sizeof(OutBuffer));
+    if (!out) return -1;
+
+    out->f = fopen(filename, "w");
+    out->len = 0;
+    if (!out->f) 
+    {
+        printf("Failed to open %s\n", filename);
+        free(out);
+        return -1;
+    }
+
+    RouteGeometry g;
+    buildGeometry(it, &g);
+
+    char *keep = malloc(g.numPoints + 1);
+    if (toleranceM > 0) 
+    {
+        int *stack = malloc(sizeof(int) * (2 * g.numPoints + 4));
+        memset(keep, 0, g.numPoints + 1);
+        for (int l = 0; l < g.numLegs; l++) 
+        {
+            if (g.legStart[l + 1] > g.legStart[l]) simplifyRange(g.points, g.legStart[l], g.legStart[l + 1] - 1, toleranceM, keep, stack);
+        }
+        free(stack);
+    }
+    else 
+    {
+        memset(keep, 1, g.numPoints + 1);
+    }
+
+    if (format == EXPORT_GEOJSON) writeGeoJSON(out, &g, keep);
+    else if (format == EXPORT_POLYLINE) writePolyline(out, &g, keep);
+    else writeKML(out, &g, keep);
+
+    flushOut(out);
+    fclose(out->f);              // Yet again the file is closed
+
+    free(keep);
+    free(g.points);
+    free(g.legStart);
+    free(g.legMode);
+    free(out);
+    return 0;
+}
+
+// Menu export. ROUTE_SIMPLIFY_M sets a Douglas-Peucker tolerance in metres and
+// ROUTE_EXPORT_FORMATS=geojson,polyline also writes those next to the KML.
+void exportItinerary(const Itinerary *it, const char *filename) {
+
+    const char *toleranceEnv = getenv("ROUTE_SIMPLIFY_M");
+    const char *formatsEnv = getenv("ROUTE_EXPORT_FORMATS");
+    double toleranceM = toleranceEnv ? atof(toleranceEnv) : 0.0;
+
+    if (exportRoute(it, filename, EXPORT_KML, toleranceM) != 0) return;
+    printf("Exported path to %s\n", filename);
+
+    if (!formatsEnv) return;
+
+    static const char *extensions[] = { ".kml", ".geojson", ".polyline" };
+    char other[512];
+    const char *dot = strrchr(filename, '.');
+    int stemLen = dot ? (int)(dot - filename) : (int)strlen(filename);
+
+    for (int format = EXPORT_GEOJSON; format <= EXPORT_POLYLINE; format++) 
+    {
+        if (!strstr(formatsEnv, extensions[format] + 1)) continue;
+
+        snprintf(other, sizeof(other), "%.*s%s", stemLen, filename, extensions[format]);
+        if (exportRoute(it, other, format, toleranceM) == 0) printf("Exported path to %s\n", other);
+    }
+}
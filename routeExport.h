@@ -0,0 +1,20 @@
+#ifndef routeExport_H
+#define routeExport_H
+
+#include "mode.h"
+#include "itinerary.h"
+
+#define EXPORT_BUFFER_BYTES (256 * 1024)
+
+typedef enum
+{
+    EXPORT_KML,
+    EXPORT_GEOJSON,
+    EXPORT_POLYLINE
+} ExportFormat;
+
+ExportFormat exportFormatFromName(const char *filename);
+int exportRoute(const Itinerary *it, const char *filename, ExportFormat format, double toleranceM);
+void exportItinerary(const Itinerary *it, const char *filename);
+
+#endif
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "nodesAndEdges.h"
+#include "search.h"
+#include "scheduler.h"
+
+// Work stealing over one batch of tasks. Each worker starts with a contiguous block of the
+// task ids in its own deque and pops from the back; an idle worker steals the front half
+// of someone else's. Tasks do not spawn tasks, so once a sweep finds every deque empty
+// there is nothing left to wait for and the worker leaves.
+
+typedef struct 
+{
+    int *tasks;                 // tasks[top..bottom) are waiting
+    int top;
+    int bottom;
+    pthread_mutex_t lock;
+    SearchSpace space;
+    SchedulerStats stats;
+} Worker;
+
+typedef struct 
+{
+    TaskFunc func;
+    void *arg;
+    Graph *graph;               // the caller's views, it holds them for the whole batch
+    Worker *workers;
+    int numWorkers;
+} Batch;
+
+typedef struct 
+{
+    Batch *batch;
+    int w;
+} WorkerArg;
+
+static pthread_mutex_t totalsLock = PTHREAD_MUTEX_INITIALIZER;
+static SchedulerStats totals;
+static int queuedTasks = 0;
+
+int defaultWorkers() {
+
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+}
+
+static int popTask(Worker *self) {
+
+    int task = -1;
+
+    pthread_mutex_lock(&self->lock);
+    if (self->bottom > self->top) task = self->tasks[--self->bottom];
+    pthread_mutex_unlock(&self->lock);
+
+    return task;
+}
+
+// Moves the front half of the first non-empty victim's deque into self's, which is empty,
+// so no thief reads self's array while it is filled
+static int stealTasks(Batch *batch, int w) {
+
+    Worker *self = &batch->workers[w];
+
+    for (int k = 1; k < batch->numWorkers; k++) 
+    {
+        Worker *victim = &batch->workers[(w + k) % batch->numWorkers];
+        int taken = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        int depth = victim->bottom - victim->top;
+        if (depth > 0) 
+        {
+            taken = (depth + 1) / 2;
+            memcpy(self->tasks, victim->tasks + victim->top, sizeof(int) * taken);
+            victim->top += taken;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (taken == 0) 
+        {
+            self->stats.failedSteals++;
+            continue;
+        }
+
+        pthread_mutex_lock(&self->lock);
+        self->top = 0;
+        self->bottom = taken;
+        pthread_mutex_unlock(&self->lock);
+
+        self->stats.steals++;
+        self->stats.tasksStolen += taken;
+        return taken;
+    }
+
+    return 0;
+}
+
+static void runWorker(Batch *batch, int w) {
+
+    Worker *self = &batch->workers[w];
+
+    while (1) 
+    {
+        int task = popTask(self);
+
+        if (task < 0) 
+        {
+            if (stealTasks(batch, w) == 0) break;
+            continue;
+        }
+
+        __atomic_fetch_sub(&queuedTasks, 1, __ATOMIC_RELAXED);
+        batch->func(batch->arg, task, &self->space);
+        self->stats.tasks++;
+    }
+}
+
+static void *workerThread(void *arg) {
+
+    WorkerArg *a = (WorkerArg *)arg;
+
+    useGraph(a->batch->graph);
+    runWorker(a->batch, a->w);
+    useGraph(NULL);
+
+    return NULL;
+}
+
+// Runs func(arg, task, space) for every task in [0, numTasks) on numWorkers workers, the
+// caller being one of them, and returns when all are done. stats may be NULL.
+void runTasks(TaskFunc func, void *arg, int numTasks, int numWorkers, SchedulerStats *stats) {
+
+    if (numWorkers < 1) numWorkers = 1;
+    if (numWorkers > numTasks) numWorkers = numTasks > 0 ? numTasks : 1;
+
+    Batch batch = { func, arg, activeGraph, calloc(numWorkers, sizeof(Worker)), numWorkers };
+    SchedulerStats run;
+    memset(&run, 0, sizeof(run));
+
+    for (int w = 0; w < numWorkers; w++) 
+    {
+        Worker *worker = &batch.workers[w];
+        int first = (int)((long)numTasks * w / numWorkers);
+        int last = (int)((long)numTasks * (w + 1) / numWorkers);
+
+        worker->tasks = malloc(sizeof(int) * (numTasks + 1));
+        for (int t = first; t < last; t++) worker->tasks[worker->bottom++] = last - 1 - (t - first);    // popped in order
+        pthread_mutex_init(&worker->lock, NULL);
+        if (last - first > run.maxQueueDepth) run.maxQueueDepth = last - first;
+    }
+
+    __atomic_fetch_add(&queuedTasks, numTasks, __ATOMIC_RELAXED);
+
+    pthread_t *threads = malloc(sizeof(pthread_t) * numWorkers);
+    WorkerArg *args = malloc(sizeof(WorkerArg) * numWorkers);
+
+    for (int w = 1; w < numWorkers; w++) 
+    {
+        args[w].batch = &batch;
+        args[w].w = w;
+        pthread_create(&threads[w], NULL, workerThread, &args[w]);
+    }
+    runWorker(&batch, 0);
+    for (int w = 1; w < numWorkers; w++) pthread_join(threads[w], NULL);
+
+    for (int w = 0; w < numWorkers; w++) 
+    {
+        Worker *worker = &batch.workers[w];
+        run.tasks += worker->stats.tasks;
+        run.steals += worker->stats.steals;
+        run.tasksStolen += worker->stats.tasksStolen;
+        run.failedSteals += worker->stats.failedSteals;
+        freeSearchSpace(&worker->space);
+        pthread_mutex_destroy(&worker->lock);
+        free(worker->tasks);
+    }
+    run.runs = 1;
+
+    pthread_mutex_lock(&totalsLock);
+    totals.runs++;
+    totals.tasks += run.tasks;
+    totals.steals += run.steals;
+    totals.tasksStolen += run.tasksStolen;
+    totals.failedSteals += run.failedSteals;
+    if (run.maxQueueDepth > totals.maxQueueDepth) totals.maxQueueDepth = run.maxQueueDepth;
+    pthread_mutex_unlock(&totalsLock);
+
+    run.queuedTasks = __atomic_load_n(&queuedTasks, __ATOMIC_RELAXED);
+    if (stats) *stats = run;
+
+    free(threads);
+    free(args);
+    free(batch.workers);
+}
+
+// Everything run since startup
+void schedulerTotals(SchedulerStats *out) {
+
+    pthread_mutex_lock(&totalsLock);
+    *out = totals;
+    pthread_mutex_unlock(&totalsLock);
+
+    out->queuedTasks = __atomic_load_n(&queuedTasks, __ATOMIC_RELAXED);
+}
+
+void printSchedulerStats(const SchedulerStats *stats, FILE *out) {
+
+    fprintf(out, "Scheduler: %ld tasks in %ld batches, %ld steals took %ld tasks, %ld empty victims, "
+            "max queue depth %d, %d queued\n", stats->tasks, stats->runs, stats->steals, stats->tasksStolen,
+            stats->failedSteals, stats->maxQueueDepth, stats->queuedTasks);
+}
@@ -0,0 +1,27 @@
+#ifndef scheduler_H
+#define scheduler_H
+
+#include <stdio.h>
+#include "search.h"
+
+// One task of a batch. space belongs to the worker running it and starts out empty, so a
+// task that never searches costs nothing; beginSearch sizes it on first use.
+typedef void (*TaskFunc)(void *arg, int task, SearchSpace *space);
+
+typedef struct 
+{
+    long runs;
+    long tasks;
+    long steals;                // successful steals, each takes half of the victim's deque
+    long tasksStolen;
+    long failedSteals;          // victims found empty
+    int maxQueueDepth;          // deepest any deque got
+    int queuedTasks;            // waiting right now, over every running batch
+} SchedulerStats;
+
+int defaultWorkers();
+void runTasks(TaskFunc func, void *arg, int numTasks, int numWorkers, SchedulerStats *stats);
+void schedulerTotals(SchedulerStats *totals);
+void printSchedulerStats(const SchedulerStats *stats, FILE *out);
+
+#endif
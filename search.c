@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "search.h"
+#include "instrument.h"
+
+void initSearchSpace(SearchSpace *space) {
+
+    space->capacity = numNodes;
+    space->dist = malloc(sizeof(double) * (numNodes + 1));
+    space->arrival = malloc(sizeof(double) * (numNodes + 1));
+    space->prev = malloc(sizeof(int) * (numNodes + 1));
+    space->prevEdge = malloc(sizeof(int) * (numNodes + 1));
+    space->settled = malloc(numNodes + 1);
+    space->stamp = calloc(numNodes + 1, sizeof(unsigned));
+    space->epoch = 0;
+    space->heapCapacity = numEdges + numNodes + 1;          // lazy heap, one entry per relaxation at most
+    space->heap = malloc(sizeof(HeapEntry) * space->heapCapacity);
+    space->heapSize = 0;
+    space->traffic = NULL;
+    clearQueryStats(&space->stats);
+}
+
+void freeSearchSpace(SearchSpace *space) {
+
+    free(space->dist);
+    free(space->arrival);
+    free(space->prev);
+    free(space->prevEdge);
+    free(space->settled);
+    free(space->stamp);
+    free(space->heap);
+    releaseTraffic(space->traffic);
+    memset(space, 0, sizeof(*space));
+}
+
+// O(1) start of a new query: bumping the epoch invalidates every node entry at once
+void beginSearch(SearchSpace *space) {
+
+    if (space->capacity < numNodes || space->heapCapacity < numEdges + numNodes + 1)       // a reload grew the graph
+    {
+        TrafficSnapshot *traffic = space->traffic;
+        space->traffic = NULL;
+        freeSearchSpace(space);
+        initSearchSpace(space);
+        space->traffic = traffic;
+    }
+
+    if (++space->epoch == 0) 
+    {
+        memset(space->stamp, 0, sizeof(unsigned) * (space->capacity + 1));
+        space->epoch = 1;
+    }
+
+    space->heapSize = 0;
+    clearQueryStats(&space->stats);
+
+    releaseTraffic(space->traffic);             // pin the live weights for the whole query
+    space->traffic = acquireTraffic();
+}
+
+// Workspace for the interactive menu, rebuilt if the graph has grown since
+SearchSpace *sharedSearchSpace() {
+
+    static SearchSpace shared;
+    static int initialized = 0;
+
+    if (initialized && (shared.capacity != numNodes || shared.heapCapacity < numEdges + numNodes + 1)) 
+    {
+        freeSearchSpace(&shared);
+        initialized = 0;
+    }
+
+    if (!initialized) 
+    {
+        initSearchSpace(&shared);
+        initialized = 1;
+    }
+
+    return &shared;
+}
+
+void heapPush(SearchSpace *space, double key, int node) {
+
+    int i = space->heapSize++;
+
+    while (i > 0) 
+    {
+        int parent = (i - 1) / 2;
+        if (space->heap[parent].key <= key) break;
+
+        space->heap[i] = space->heap[parent];
+        i = parent;
+    }
+
+    space->heap[i].key = key;
+    space->heap[i].node = node;
+}
+
+int heapPop(SearchSpace *space, double *key) {
+
+    if (space->heapSize == 0) return -1;
+
+    HeapEntry top = space->heap[0];
+    HeapEntry last = space->heap[--space->heapSize];
+    int i = 0;
+
+    while (1) 
+    {
+        int child = 2 * i + 1;
+        if (child >= space->heapSize) break;
+        if (child + 1 < space->heapSize && space->heap[child + 1].key < space->heap[child].key) child++;
+        if (last.key <= space->heap[child].key) break;
+
+        space->heap[i] = space->heap[child];
+        i = child;
+    }
+
+    if (space->heapSize > 0) space->heap[i] = last;
+
+    *key = top.key;
+    return top.node;
+}
+
+// Car-only Dijkstra on distance. Stops as soon as every target is settled, or runs
+// to exhaustion when numTargets is 0. Returns how many distinct targets were reached.
+int runCarSearch(SearchSpace *space, int source, const int targets[], int numTargets) {
+
+    PHASE_BEGIN(reset);
+    beginSearch(space);
+    PHASE_END(&space->stats, PHASE_RESET, reset);
+    PHASE_BEGIN(search);
+
+    int remaining = 0;
+    for (int t = 0; t < numTargets; t++) 
+    {
+        touchNode(space, targets[t]);
+        if (space->settled[targets[t]] == 2) continue;
+        space->settled[targets[t]] = 2;             // 2 marks a pending target
+        remaining++;
+    }
+    int uniqueTargets = remaining;
+    const int *carStart = profileAdjStart[PROFILE_CAR];
+    const int *carList = profileAdjList[PROFILE_CAR];
+
+    touchNode(space, source);
+    space->dist[source] = 0;
+    heapPush(space, 0, source);
+    double key;
+    int u;
+
+    while ((u = heapPop(space, &key)) != -1) 
+    {
+        if (key > space->dist[u] || space->settled[u] == 1) continue;
+
+        if (space->settled[u] == 2 && --remaining == 0 && numTargets > 0) 
+        {
+            space->settled[u] = 1;
+            STAT_INC(&space->stats, nodesSettled);
+            break;
+        }
+
+        space->settled[u] = 1;
+        STAT_INC(&space->stats, nodesSettled);
+
+        for (int k = carStart[u]; k < carStart[u + 1]; k++) 
+        {
+            STAT_INC(&space->stats, edgesScanned);
+            const Edge *e = &edges[carList[k]];
+            if (isEdgeClosed(space->traffic, carList[k])) continue;
+
+            touchNode(space, e->to);
+            double newDist = key + e->distance;
+            if (newDist < space->dist[e->to]) 
+            {
+                space->dist[e->to] = newDist;
+                space->prev[e->to] = u;
+                space->prevEdge[e->to] = carList[k];
+                heapPush(space, newDist, e->to);
+                STAT_INC(&space->stats, edgesRelaxed);
+            }
+        }
+    }
+
+    PHASE_END(&space->stats, PHASE_SEARCH, search);
+    return uniqueTargets - remaining;
+}
+
+// Walks prev[] back from target, filling path[] target first. Returns its length.
+int tracePath(SearchSpace *space, int target, int path[], int pathEdges[]) {
+
+    touchNode(space, target);
+    int pathLen = 0;
+
+    for (int at = target; at != -1; at = space->prev[at]) 
+    {
+        path[pathLen] = at;
+        pathEdges[pathLen] = space->prevEdge[at];
+        pathLen++;
+    }
+
+    return pathLen;
+}
+
+// The route of a search that finished through arc bestArc of the destination: path[0] is
+// the destination point itself, the rest walks back to the source. 0 when no node was used.
+int finishPath(SearchSpace *space, int bestNode, int bestArc, int path[], int pathEdges[]) {
+
+    if (bestNode < 0) return 0;
+
+    path[0] = SNAP_POINT_NODE;
+    pathEdges[0] = ARC_CODE(bestArc);
+    return 1 + tracePath(space, bestNode, path + 1, pathEdges + 1);
+}
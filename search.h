@@ -0,0 +1,90 @@
+#ifndef search_H
+#define search_H
+
+#include "nodesAndEdges.h"
+#include "instrument.h"
+#include "traffic.h"
+#include "snap.h"
+
+typedef struct 
+{
+    double key;
+    int node;
+} HeapEntry;
+
+// Per-thread scratch for one search, so several searches can run side by side.
+// Node entries are only valid when stamp[v] == epoch; touchNode() lazily resets them,
+// so a query pays for the nodes it reaches instead of all numNodes.
+typedef struct 
+{
+    double *dist;
+    double *arrival;        // clock minutes, used by the schedule problems
+    int *prev;
+    int *prevEdge;
+    char *settled;
+    unsigned *stamp;
+    unsigned epoch;
+    int capacity;
+    HeapEntry *heap;
+    int heapSize;
+    int heapCapacity;
+    QueryStats stats;       // counters and phase times of the last query
+    TrafficSnapshot *traffic;       // live weights the current query runs on
+} SearchSpace;
+
+void initSearchSpace(SearchSpace *space);
+void freeSearchSpace(SearchSpace *space);
+void beginSearch(SearchSpace *space);
+SearchSpace *sharedSearchSpace();
+void heapPush(SearchSpace *space, double key, int node);
+int heapPop(SearchSpace *space, double *key);
+int runCarSearch(SearchSpace *space, int source, const int targets[], int numTargets);
+int tracePath(SearchSpace *space, int target, int path[], int pathEdges[]);
+int finishPath(SearchSpace *space, int bestNode, int bestArc, int path[], int pathEdges[]);
+
+static inline void touchNode(SearchSpace *space, int v) {
+
+    if (space->stamp[v] == space->epoch) return;
+
+    space->stamp[v] = space->epoch;
+    space->dist[v] = INF;
+    space->arrival[v] = INF;
+    space->prev[v] = -1;
+    space->prevEdge[v] = -1;
+    space->settled[v] = 0;
+}
+
+// Starts the search at v with what it took to get there from the snapped point, by its arc a
+static inline void seedNode(SearchSpace *space, int v, double key, double arrivalMin, int a) {
+
+    touchNode(space, v);
+    if (key >= space->dist[v]) return;
+
+    space->dist[v] = key;
+    space->arrival[v] = arrivalMin;
+    space->prevEdge[v] = ARC_CODE(a);
+    heapPush(space, key, v);
+}
+
+// Flags the nodes the destination can be reached from (settled == 2), so a popped node
+// only looks at the destination's arcs when it is one of them
+static inline void markTargets(SearchSpace *space, const SnapPoint *to) {
+
+    for (int a = 0; a < to->numArcs; a++) 
+    {
+        touchNode(space, to->arcs[a].node);
+        space->settled[to->arcs[a].node] = 2;
+    }
+}
+
+static inline double searchDist(const SearchSpace *space, int v) {
+
+    return (space->stamp[v] == space->epoch) ? space->dist[v] : INF;
+}
+
+static inline int isSettled(const SearchSpace *space, int v) {
+
+    return space->stamp[v] == space->epoch && space->settled[v] == 1;
+}
+
+#endif
@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <sys/time.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "timeHandling.h"
+#include "routeCache.h"
+#include "search.h"
+#include "graphLoad.h"
+#include "traffic.h"
+#include "snap.h"
+#include "protocol.h"
+#include "problem1.h"
+#include "problem2.h"
+#include "problem3.h"
+#include "problem4.h"
+#include "problem5.h"
+#include "problem6.h"
+#include "server.h"
+
+#define DEFAULT_SERVER_WORKERS 4
+#define FRAME_TIMEOUT_SEC 2             // longest a worker waits on the rest of a frame, or on a client to read its answer
+
+typedef struct 
+{
+    char *data;
+    size_t len;
+    size_t capacity;
+} ResponseBuffer;
+
+static int listenFd = -1;
+static char socketPath[108];
+
+static void appendf(ResponseBuffer *buf, const char *fmt, ...) {
+
+    va_list args;
+
+    while (1) 
+    {
+        va_start(args, fmt);
+        int n = vsnprintf(buf->data + buf->len, buf->capacity - buf->len, fmt, args);
+        va_end(args);
+
+        if (n < 0) return;
+        if (buf->len + n < buf->capacity) 
+        {
+            buf->len += n;
+            return;
+        }
+
+        size_t newCapacity = buf->capacity * 2 + n;
+        char *grown = realloc(buf->data, newCapacity);
+        if (!grown) return;
+
+        buf->data = grown;
+        buf->capacity = newCapacity;
+    }
+}
+
+// One word per mode so response lines split on spaces
+static const char *modeToken(Mode mode) {
+
+    switch (mode) 
+    {
+        case MODE_WALK: return "walk";
+        case MODE_METRO: return "metro";
+        case MODE_BIKOLPO: return "bikolpo";
+        case MODE_UTTARA: return "uttara";
+        default: return "car";
+    }
+}
+
+static int solveRequest(int problem, SearchSpace *space, const SnapPoint *from, const SnapPoint *to, int startTimeMin,
+                        int deadlineMin, int path[], int pathEdges[], double *total) {
+
+    switch (problem) 
+    {
+        case 1: return routeProblem1(space, from, to, path, pathEdges, total);
+        case 2: return solveProblem2(space, from, to, path, pathEdges, total);
+        case 3: return solveProblem3(space, from, to, path, pathEdges, total);
+        case 4: return solveProblem4(space, from, to, startTimeMin, path, pathEdges, total);
+        case 5: return solveProblem5(space, from, to, startTimeMin, path, pathEdges, total);
+        default: return solveProblem6(space, from, to, startTimeMin, deadlineMin, path, pathEdges, total);
+    }
+}
+
+static void appendRide(ResponseBuffer *buf, Mode mode, double fromLat, double fromLon, double toLat, double toLon, double km) {
+
+    appendf(buf, "%s %.6f %.6f %.6f %.6f %.3f\n", modeToken(mode), fromLat, fromLon, toLat, toLon, km);
+}
+
+// Stops a problem may walk to, the same masks its run function snaps with
+static unsigned problemStopModes(int problem) {
+
+    if (problem == 1) return 0;
+    if (problem == 2) return MODE_BIT(MODE_METRO);
+    return TRANSIT_MODE_BITS;
+}
+
+// The rides of a solved route: the partial ride off the source's road point, the path
+// edges, the partial ride onto the destination's, or the one ride along a shared road
+static void appendRoute(ResponseBuffer *buf, const SnapPoint *from, const SnapPoint *to, const int path[],
+                        const int pathEdges[], int pathLen, double total) {
+
+    const SnapArc *in = routeStartArc(from, pathEdges, pathLen);
+    const SnapArc *out = routeEndArc(to, pathEdges, pathLen);
+    int partialIn = in && in->edge >= 0;
+    int partialOut = out && out->edge >= 0;
+    SnapArc direct;
+    double directStart;
+
+    if (pathLen == 0) 
+    {
+        snapDirectRide(from, to, &direct, &directStart);
+        appendf(buf, "OK %.3f 1\n", total);
+        appendRide(buf, MODE_CAR, from->roadLat, from->roadLon, to->roadLat, to->roadLon, arcDistance(&direct));
+        return;
+    }
+
+    appendf(buf, "OK %.3f %d\n", total, pathLen - 2 + partialIn + partialOut);
+
+    if (partialIn) 
+    {
+        int whole = in->fraction >= 1.0;
+        const Node *start = &nodes[edges[in->edge].from];
+        appendRide(buf, MODE_CAR, whole ? start->lat : from->roadLat, whole ? start->lon : from->roadLon,
+                   nodes[in->node].lat, nodes[in->node].lon, arcDistance(in));
+    }
+
+    for (int i = pathLen - 1; i > 1; i--)              // path[0] is the destination point
+    {
+        const Edge *e = &edges[pathEdges[i - 1]];
+        appendRide(buf, e->mode, nodes[path[i]].lat, nodes[path[i]].lon, nodes[path[i - 1]].lat, nodes[path[i - 1]].lon,
+                   e->distance);
+    }
+
+    if (partialOut) 
+    {
+        int whole = out->fraction >= 1.0;
+        const Node *end = &nodes[edges[out->edge].to];
+        appendRide(buf, MODE_CAR, nodes[out->node].lat, nodes[out->node].lon, whole ? end->lat : to->roadLat,
+                   whole ? end->lon : to->roadLon, arcDistance(out));
+    }
+}
+
+// Parses one request line and fills *response (malloc'd). Returns its length.
+int answerRequest(SearchSpace *space, const char *request, char **response) {
+
+    ResponseBuffer buf = { malloc(256), 0, 256 };
+    int problem, startTimeMin = 9 * 60, deadlineMin = 0;
+    double srcLat, srcLon, destLat, destLon;
+
+    pinGraph(NULL);                 // each request runs on the newest graph, start to finish
+
+    if (strcmp(request, "RELOAD") == 0) 
+    {
+        double startMs = monotonicMs();
+        int id = reloadGraph();
+
+        if (id == 0) appendf(&buf, "ERR reload already running\n");
+        else if (id < 0) appendf(&buf, "ERR input files did not build, current version kept\n");
+        else appendf(&buf, "OK %d %.0f\n", id, monotonicMs() - startMs);      // graph version, milliseconds
+
+        *response = buf.data;
+        return (int)buf.len;
+    }
+
+    if (strncmp(request, "TRAFFIC", 7) == 0)        // TRAFFIC fromLat fromLon toLat toLon factor
+    {
+        TrafficUpdate update;
+        double elapsedMs;
+
+        if (sscanf(request + 7, "%lf %lf %lf %lf %f", &update.fromLat, &update.fromLon, &update.toLat, &update.toLon,
+                   &update.factor) != 5 || update.factor < 0) 
+        {
+            appendf(&buf, "ERR expected: TRAFFIC fromLat fromLon toLat toLon factor\n");
+        }
+        else 
+        {
+            int patched = applyTrafficUpdates(&update, 1, &elapsedMs);
+            appendf(&buf, "OK %d %.0f\n", patched, elapsedMs * 1000.0);       // edges patched, microseconds
+        }
+
+        *response = buf.data;
+        return (int)buf.len;
+    }
+
+    int fields = sscanf(request, "%d %lf %lf %lf %lf %d %d", &problem, &srcLat, &srcLon, &destLat, &destLon,
+                        &startTimeMin, &deadlineMin);
+
+    if (fields < 5 || problem < 1 || problem > 6) 
+    {
+        appendf(&buf, "ERR expected: problem srcLat srcLon destLat destLon [startMin] [deadlineMin]\n");
+    }
+    else if (problem == 6 && (fields < 7 || deadlineMin <= startTimeMin)) 
+    {
+        appendf(&buf, "ERR problem 6 needs a start and a later deadline\n");
+    }
+    else 
+    {
+        SnapPoint from, to;
+        unsigned stopModes = problemStopModes(problem);
+        int snapped = snapSource(srcLat, srcLon, stopModes, &from) == 0 && snapTarget(destLat, destLon, stopModes, &to) == 0;
+
+        static __thread int *path = NULL;          // per worker, kept across requests
+        static __thread int *pathEdges = NULL;
+
+        if (!path) 
+        {
+            path = malloc(sizeof(int) * MAX_NODES);
+            pathEdges = malloc(sizeof(int) * MAX_NODES);
+        }
+
+        int pathLen = 0;
+        double total = INF;
+
+        if (problem < 4) startTimeMin = 0;
+        if (problem < 6) deadlineMin = 0;
+
+        if (!snapped) 
+        {
+            appendf(&buf, "ERR could not find nodes\n");
+        }
+        else 
+        {
+            RouteKey key = makeRouteKey(problem, &from, &to, startTimeMin, deadlineMin);
+
+            if (!routeCacheLookup(&key, path, pathEdges, &pathLen, &total)) 
+            {
+                pathLen = solveRequest(problem, space, &from, &to, startTimeMin, deadlineMin, path, pathEdges, &total);
+                routeCacheStore(&key, path, pathEdges, pathLen, total);
+            }
+
+            if (total >= INF) 
+            {
+                appendf(&buf, "NOPATH\n");
+            }
+            else 
+            {
+                appendRoute(&buf, &from, &to, path, pathEdges, pathLen, total);
+            }
+        }
+
+    }
+
+    *response = buf.data;
+    return (int)buf.len;
+}
+
+// Connections waiting for a worker. The dispatcher polls the idle ones and queues a
+// connection once it has a request to read; the worker answers that one request and hands
+// the connection back, so a client that keeps its socket open ties up no worker between
+// requests; one that stalls halfway through a frame holds it FRAME_TIMEOUT_SEC at most.
+// A ring, so connections are served in the order their requests came in.
+static int *readyFds = NULL;
+static int readyHead = 0;               // oldest waiting
+static int numReady = 0;
+static int readyCapacity = 0;
+static int serverStopping = 0;
+static pthread_mutex_t readyLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t readyCond = PTHREAD_COND_INITIALIZER;
+
+static int wakePipe[2] = { -1, -1 };        // connections coming back, and -1 from the signal handler
+static volatile sig_atomic_t stopRequested = 0;
+
+static void queueReady(int fd) {
+
+    pthread_mutex_lock(&readyLock);
+
+    if (numReady == readyCapacity)          // unwrap into a bigger ring
+    {
+        int grown = readyCapacity ? readyCapacity * 2 : 64;
+        int *fds = malloc(sizeof(int) * grown);
+        for (int i = 0; i < numReady; i++) fds[i] = readyFds[(readyHead + i) % readyCapacity];
+
+        free(readyFds);
+        readyFds = fds;
+        readyHead = 0;
+        readyCapacity = grown;
+    }
+    readyFds[(readyHead + numReady++) % readyCapacity] = fd;
+
+    pthread_cond_signal(&readyCond);
+    pthread_mutex_unlock(&readyLock);
+}
+
+// Next connection with a request waiting, -1 once the server stops and the queue is empty
+static int takeReady() {
+
+    pthread_mutex_lock(&readyLock);
+
+    while (numReady == 0 && !serverStopping) pthread_cond_wait(&readyCond, &readyLock);
+    int fd = -1;
+    if (numReady > 0) 
+    {
+        fd = readyFds[readyHead];
+        readyHead = (readyHead + 1) % readyCapacity;
+        numReady--;
+    }
+
+    pthread_mutex_unlock(&readyLock);
+    return fd;
+}
+
+// Each worker answers one request at a time off the ready queue, reusing one SearchSpace
+// for everything it serves.
+static void *serverWorker(void *arg) {
+
+    (void)arg;
+    SearchSpace space;
+    pinGraph(NULL);
+    initSearchSpace(&space);
+
+    int fd;
+    while ((fd = takeReady()) >= 0) 
+    {
+        char *request = readFrame(fd, NULL);
+        if (!request)                   // hung up, a broken frame, or stuck FRAME_TIMEOUT_SEC into one
+        {
+            close(fd);
+            continue;
+        }
+
+        char *response;
+        int len = answerRequest(&space, request, &response);
+        int sent = writeFrame(fd, response, len);
+
+        free(request);
+        free(response);
+
+        int stopping = __atomic_load_n(&serverStopping, __ATOMIC_RELAXED);
+        if (sent != 0 || stopping || write(wakePipe[1], &fd, sizeof(fd)) != sizeof(fd)) close(fd);
+    }
+
+    freeSearchSpace(&space);
+    unpinGraph();
+    return NULL;
+}
+
+// Only flags the stop and wakes the dispatcher, which shuts down outside the handler so
+// the normal exit path still runs (the trace flush is an atexit handler)
+static void stopServer(int sig) {
+
+    (void)sig;
+    int stop = -1;
+
+    stopRequested = 1;
+    if (write(wakePipe[1], &stop, sizeof(stop)) < 0) return;
+}
+
+// Polls the listening socket, the wake pipe and every idle connection until a stop signal
+static void dispatchConnections() {
+
+    int *idle = NULL;
+    int numIdle = 0, idleCapacity = 0;
+    struct pollfd *polled = NULL;
+    int polledCapacity = 0;
+
+    while (!stopRequested) 
+    {
+        if (numIdle + 2 > polledCapacity) 
+        {
+            polledCapacity = (numIdle + 2) * 2;
+            polled = realloc(polled, sizeof(struct pollfd) * polledCapacity);
+        }
+
+        polled[0] = (struct pollfd){ listenFd, POLLIN, 0 };
+        polled[1] = (struct pollfd){ wakePipe[0], POLLIN, 0 };
+        for (int i = 0; i < numIdle; i++) polled[i + 2] = (struct pollfd){ idle[i], POLLIN, 0 };
+
+        int numPolled = numIdle + 2;
+        if (poll(polled, numPolled, -1) < 0) continue;          // EINTR from the stop signal
+
+        int kept = 0;                   // readable idle connections go to the workers
+        for (int i = 2; i < numPolled; i++) 
+        {
+            if (polled[i].revents) queueReady(polled[i].fd);
+            else idle[kept++] = polled[i].fd;
+        }
+        numIdle = kept;
+
+        int returned[64];
+        ssize_t got;
+        if ((polled[1].revents & POLLIN) && (got = read(wakePipe[0], returned, sizeof(returned))) > 0) 
+        {
+            for (int i = 0; i < (int)(got / sizeof(int)); i++) 
+            {
+                if (returned[i] < 0) continue;          // the stop, stopRequested is already set
+
+                if (numIdle == idleCapacity) 
+                {
+                    idleCapacity = idleCapacity ? idleCapacity * 2 : 64;
+                    idle = realloc(idle, sizeof(int) * idleCapacity);
+                }
+                idle[numIdle++] = returned[i];
+            }
+        }
+
+        if (polled[0].revents & POLLIN) 
+        {
+            int fd = accept(listenFd, NULL, NULL);
+            if (fd >= 0) 
+            {
+                // poll only says a frame has started; a client that stops halfway must
+                // not hold the worker reading it
+                struct timeval timeout = { FRAME_TIMEOUT_SEC, 0 };
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                queueReady(fd);                         // a new client speaks first
+            }
+        }
+    }
+
+    for (int i = 0; i < numIdle; i++) close(idle[i]);
+    free(idle);
+    free(polled);
+}
+
+// main serve <socket> [workers]
+int runServerCommand(int argc, char **argv) {
+
+    if (argc < 1) 
+    {
+        printf("Usage: main serve <socket path> [workers]\n");
+        return 1;
+    }
+
+    int numWorkers = (argc > 1) ? atoi(argv[1]) : DEFAULT_SERVER_WORKERS;
+    if (numWorkers < 1) numWorkers = 1;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (strlen(argv[0]) >= sizeof(addr.sun_path)) 
+    {
+        printf("Socket path too long: %s\n", argv[0]);
+        return 1;
+    }
+    strcpy(addr.sun_path, argv[0]);
+    strcpy(socketPath, argv[0]);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath);                         // left over from a previous run
+
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd, 64) != 0) 
+    {
+        printf("Failed to listen on %s\n", socketPath);
+        return 1;
+    }
+
+    if (pipe(wakePipe) != 0) 
+    {
+        printf("Failed to create the wake pipe\n");
+        return 1;
+    }
+
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    signal(SIGPIPE, SIG_IGN);                   // a client hanging up must not kill the daemon
+
+    printf("Serving on %s with %d workers\n", socketPath, numWorkers);
+    fflush(stdout);
+
+    pthread_t *threads = malloc(sizeof(pthread_t) * numWorkers);
+    for (int t = 0; t < numWorkers; t++) pthread_create(&threads[t], NULL, serverWorker, NULL);
+
+    dispatchConnections();
+
+    close(listenFd);                            // no new clients while the workers finish
+    unlink(socketPath);
+
+    pthread_mutex_lock(&readyLock);
+    __atomic_store_n(&serverStopping, 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&readyCond);
+    pthread_mutex_unlock(&readyLock);
+
+    for (int t = 0; t < numWorkers; t++) pthread_join(threads[t], NULL);
+
+    printf("Server stopped\n");
+    free(threads);
+    free(readyFds);
+    return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef server_H
+#define server_H
+
+#include "search.h"
+
+int answerRequest(SearchSpace *space, const char *request, char **response);
+int runServerCommand(int argc, char **argv);
+
+#endif
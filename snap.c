@@ -0,0 +1,481 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "speedProfile.h"
+#include "timeHandling.h"
+#include "traffic.h"
+#include "snap.h"
+
+#define SNAP_END_EPS 1e-9
+
+static double kmPerDegLat() {
+
+    return EARTH_RADIUS_KM * PI / 180.0;
+}
+
+// Vertex k of an edge polyline: the from node, the shape points, then the to node
+void edgeVertex(int edgeIdx, int k, double *lat, double *lon) {
+
+    const Edge *e = &edges[edgeIdx];
+
+    if (k == 0) 
+    {
+        *lat = nodes[e->from].lat;
+        *lon = nodes[e->from].lon;
+    }
+    else if (k > e->shapeCount) 
+    {
+        *lat = nodes[e->to].lat;
+        *lon = nodes[e->to].lon;
+    }
+    else 
+    {
+        *lat = shapePoints[e->shapeStart + k - 1].lat;
+        *lon = shapePoints[e->shapeStart + k - 1].lon;
+    }
+}
+
+static int clampIndex(int value, int limit) {
+
+    if (value < 0) return 0;
+    if (value >= limit) return limit - 1;
+    return value;
+}
+
+// The named stations a transit line leaves from, a bit per mode boarding there
+static unsigned char *findStops() {
+
+    unsigned char *modes = calloc(numNodes + 1, 1);
+
+    for (int i = 0; i < numEdges; i++) 
+    {
+        Mode m = edges[i].mode;
+        if (m == MODE_CAR || m == MODE_WALK || !isNamedStation(edges[i].from)) continue;
+        modes[edges[i].from] |= MODE_BIT(m);
+    }
+
+    return modes;
+}
+
+// Runs on g's views, right after the build has settled the edges
+void buildSnapIndex(Graph *g) {
+
+    double startMs = monotonicMs();
+    SnapIndex *idx = calloc(1, sizeof(SnapIndex));
+    double minLat = 90, maxLat = -90, minLon = 180, maxLon = -180;
+
+    for (int i = 0; i < numNodes; i++) 
+    {
+        if (nodes[i].lat < minLat) minLat = nodes[i].lat;
+        if (nodes[i].lat > maxLat) maxLat = nodes[i].lat;
+        if (nodes[i].lon < minLon) minLon = nodes[i].lon;
+        if (nodes[i].lon > maxLon) maxLon = nodes[i].lon;
+    }
+
+    for (int i = 0; i < numShapePoints; i++) 
+    {
+        if (shapePoints[i].lat < minLat) minLat = shapePoints[i].lat;
+        if (shapePoints[i].lat > maxLat) maxLat = shapePoints[i].lat;
+        if (shapePoints[i].lon < minLon) minLon = shapePoints[i].lon;
+        if (shapePoints[i].lon > maxLon) maxLon = shapePoints[i].lon;
+    }
+
+    if (numNodes == 0) minLat = maxLat = minLon = maxLon = 0;
+
+    double midLat = (minLat + maxLat) / 2.0;
+    idx->minLat = minLat;
+    idx->minLon = minLon;
+    idx->cellLat = SNAP_CELL_KM / kmPerDegLat();
+    idx->cellLon = SNAP_CELL_KM / (kmPerDegLat() * cos(midLat * PI / 180.0));
+    idx->rows = (int)((maxLat - minLat) / idx->cellLat) + 1;
+    idx->cols = (int)((maxLon - minLon) / idx->cellLon) + 1;
+
+    int cells = idx->rows * idx->cols;
+    idx->cellStart = calloc(cells + 2, sizeof(int));
+
+    // Two passes over the same boxes: count per cell, then fill
+    for (int pass = 0; pass < 2; pass++) 
+    {
+        int *fill = NULL;
+
+        if (pass == 1) 
+        {
+            for (int c = 0; c < cells; c++) idx->cellStart[c + 1] += idx->cellStart[c];
+            idx->count = idx->cellStart[cells];
+            idx->segEdge = malloc(sizeof(int) * (idx->count + 1));
+            idx->segPiece = malloc(sizeof(int) * (idx->count + 1));
+            fill = malloc(sizeof(int) * (cells + 1));
+            for (int c = 0; c < cells; c++) fill[c] = idx->cellStart[c];
+        }
+
+        for (int i = 0; i < numEdges; i++) 
+        {
+            if (edges[i].mode != MODE_CAR) continue;
+
+            for (int k = 0; k <= edges[i].shapeCount; k++) 
+            {
+                double lat1, lon1, lat2, lon2;
+                edgeVertex(i, k, &lat1, &lon1);
+                edgeVertex(i, k + 1, &lat2, &lon2);
+
+                int r1 = clampIndex((int)((fmin(lat1, lat2) - minLat) / idx->cellLat), idx->rows);
+                int r2 = clampIndex((int)((fmax(lat1, lat2) - minLat) / idx->cellLat), idx->rows);
+                int c1 = clampIndex((int)((fmin(lon1, lon2) - minLon) / idx->cellLon), idx->cols);
+                int c2 = clampIndex((int)((fmax(lon1, lon2) - minLon) / idx->cellLon), idx->cols);
+
+                for (int r = r1; r <= r2; r++) 
+                {
+                    for (int c = c1; c <= c2; c++) 
+                    {
+                        int cell = r * idx->cols + c;
+
+                        if (pass == 0) 
+                        {
+                            idx->cellStart[cell + 1]++;
+                        }
+                        else 
+                        {
+                            idx->segEdge[fill[cell]] = i;
+                            idx->segPiece[fill[cell]] = k;
+                            fill[cell]++;
+                        }
+                    }
+                }
+            }
+        }
+
+        free(fill);
+    }
+
+    idx->stopModes = findStops();
+    buildNodeGridWhere(&idx->stops, MAX_WALK_DISTANCE_KM, idx->stopModes);
+
+    g->snap = idx;
+    printf("Snap index: %d road segments in %d cells, %d stops in %.1f ms\n", idx->count, cells, idx->stops.count,
+           monotonicMs() - startMs);
+}
+
+void freeSnapIndex(Graph *g) {
+
+    SnapIndex *idx = g->snap;
+    if (!idx) return;
+
+    free(idx->cellStart);
+    free(idx->segEdge);
+    free(idx->segPiece);
+    freeSpatialGrid(&idx->stops);
+    free(idx->stopModes);
+    free(idx);
+    g->snap = NULL;
+}
+
+// Distance from the origin to segment a-b on a local flat projection (km), t is where it lands
+static double projectOnSegment(double ax, double ay, double bx, double by, double *t) {
+
+    double dx = bx - ax, dy = by - ay;
+    double len2 = dx * dx + dy * dy;
+
+    *t = len2 > 0 ? -(ax * dx + ay * dy) / len2 : 0.0;
+    if (*t < 0) *t = 0;
+    if (*t > 1) *t = 1;
+
+    double px = ax + *t * dx, py = ay + *t * dy;
+    return sqrt(px * px + py * py);
+}
+
+// Rings of cells around the point until nothing closer can be left outside them
+static int nearestSegment(double lat, double lon, int *bestEdge, int *bestPiece, double *bestT) {
+
+    const SnapIndex *idx = activeGraph ? activeGraph->snap : NULL;
+    if (!idx || idx->count == 0) return 0;
+
+    double kmLat = kmPerDegLat();
+    double kmLon = kmLat * cos(lat * PI / 180.0);
+    int row = (int)floor((lat - idx->minLat) / idx->cellLat);
+    int col = (int)floor((lon - idx->minLon) / idx->cellLon);
+    int maxRing = (int)(SNAP_MAX_RADIUS_KM / SNAP_CELL_KM) + 1;
+    double cellKm = fmin(SNAP_CELL_KM, idx->cellLon * kmLon);
+    double best = SNAP_MAX_RADIUS_KM;
+
+    *bestEdge = -1;
+
+    for (int ring = 0; ring <= maxRing; ring++) 
+    {
+        for (int r = row - ring; r <= row + ring; r++) 
+        {
+            if (r < 0 || r >= idx->rows) continue;
+
+            int onEdgeRow = (r == row - ring || r == row + ring);
+            int step = onEdgeRow ? 1 : 2 * ring;
+
+            for (int c = col - ring; c <= col + ring; c += (step > 0 ? step : 1)) 
+            {
+                if (c < 0 || c >= idx->cols) continue;
+
+                int cell = r * idx->cols + c;
+                for (int k = idx->cellStart[cell]; k < idx->cellStart[cell + 1]; k++) 
+                {
+                    int e = idx->segEdge[k];
+                    int piece = idx->segPiece[k];
+                    double lat1, lon1, lat2, lon2, t;
+                    edgeVertex(e, piece, &lat1, &lon1);
+                    edgeVertex(e, piece + 1, &lat2, &lon2);
+
+                    double d = projectOnSegment((lon1 - lon) * kmLon, (lat1 - lat) * kmLat,
+                                                (lon2 - lon) * kmLon, (lat2 - lat) * kmLat, &t);
+                    if (d < best) 
+                    {
+                        best = d;
+                        *bestEdge = e;
+                        *bestPiece = piece;
+                        *bestT = t;
+                    }
+                }
+            }
+        }
+
+        if (*bestEdge >= 0 && best <= ring * cellKm) break;            // the next ring starts further out
+    }
+
+    return *bestEdge >= 0;
+}
+
+// The same road the other way round, if it is two-way
+static int reverseTwin(int edgeIdx) {
+
+    const Edge *e = &edges[edgeIdx];
+    int twin = -1;
+    double bestGap = INF;
+
+    for (int k = adjStart[e->to]; k < adjStart[e->to + 1]; k++) 
+    {
+        int i = adjList[k];
+        if (edges[i].mode != MODE_CAR || edges[i].to != e->from) continue;
+
+        double gap = fabs(edges[i].distance - e->distance);
+        if (gap < bestGap) 
+        {
+            bestGap = gap;
+            twin = i;
+        }
+    }
+
+    return twin;
+}
+
+static void addArc(SnapPoint *p, int node, int edgeIdx, double fraction, double walkKm) {
+
+    SnapArc *a = &p->arcs[p->numArcs++];
+    a->node = node;
+    a->edge = fraction > SNAP_END_EPS ? edgeIdx : -1;
+    a->fraction = fraction > SNAP_END_EPS ? fraction : 0.0;
+    a->walkKm = walkKm;
+}
+
+static int compareStopDistance(const void *a, const void *b) {
+
+    double x = ((const SnapArc *)a)->walkKm;
+    double y = ((const SnapArc *)b)->walkKm;
+    return (x > y) - (x < y);
+}
+
+// Every stop of the wanted modes within walking distance, nearest first
+static void addStopArcs(SnapPoint *p, unsigned stopModes) {
+
+    const SnapIndex *idx = activeGraph ? activeGraph->snap : NULL;
+    int candidates[256];
+    SnapArc stops[256];
+    int numStops = 0;
+
+    if (!stopModes || !idx || idx->stops.count == 0) return;
+
+    int found = queryGridRadius(&idx->stops, p->lat, p->lon, MAX_WALK_DISTANCE_KM, candidates, 256);
+    if (found > 256) found = 256;
+
+    for (int k = 0; k < found; k++) 
+    {
+        int n = candidates[k];
+        if (!(idx->stopModes[n] & stopModes)) continue;
+
+        stops[numStops].node = n;
+        stops[numStops].edge = -1;
+        stops[numStops].fraction = 0.0;
+        stops[numStops].walkKm = haversineDistance(p->lat, p->lon, nodes[n].lat, nodes[n].lon);
+        numStops++;
+    }
+
+    qsort(stops, numStops, sizeof(SnapArc), compareStopDistance);
+    if (numStops > SNAP_MAX_STOPS) numStops = SNAP_MAX_STOPS;
+
+    for (int k = 0; k < numStops; k++) p->arcs[p->numArcs++] = stops[k];
+    p->numStops = numStops;
+}
+
+static int snapPoint(double lat, double lon, unsigned stopModes, SnapPoint *p, int asTarget) {
+
+    int e = -1, piece = 0;
+    double t = 0.0;
+
+    p->lat = p->roadLat = lat;
+    p->lon = p->roadLon = lon;
+    p->walkKm = 0.0;
+    p->position = 0.0;
+    p->numArcs = 0;
+    p->numStops = 0;
+    p->edge = -1;
+
+    if (!nearestSegment(lat, lon, &e, &piece, &t)) 
+    {
+        addStopArcs(p, stopModes);
+        return p->numArcs > 0 ? 0 : -1;
+    }
+
+    // Position by length along the whole polyline, so partial costs scale edges[e].distance
+    double before = 0, total = 0, pieceKm = 0;
+    double lat1, lon1, lat2, lon2;
+
+    for (int k = 0; k <= edges[e].shapeCount; k++) 
+    {
+        edgeVertex(e, k, &lat1, &lon1);
+        edgeVertex(e, k + 1, &lat2, &lon2);
+        double d = haversineDistance(lat1, lon1, lat2, lon2);
+
+        if (k < piece) before += d;
+        if (k == piece) 
+        {
+            pieceKm = d;
+            p->roadLat = lat1 + t * (lat2 - lat1);
+            p->roadLon = lon1 + t * (lon2 - lon1);
+        }
+        total += d;
+    }
+
+    p->edge = e;
+    p->position = total > 0 ? (before + t * pieceKm) / total : 0.0;
+    if (p->position < SNAP_END_EPS) p->position = 0.0;
+    if (p->position > 1.0 - SNAP_END_EPS) p->position = 1.0;
+    p->walkKm = haversineDistance(lat, lon, p->roadLat, p->roadLon);
+
+    int twin = reverseTwin(e);
+    double pos = p->position;
+
+    double walk = p->walkKm;
+
+    // Towards the from node: riding the twin when leaving, e itself when arriving
+    if (pos == 0.0) addArc(p, edges[e].from, -1, 0.0, walk);
+    else if (asTarget) addArc(p, edges[e].from, e, pos, walk);
+    else if (twin >= 0) addArc(p, edges[e].from, twin, pos, walk);
+
+    // Towards the to node: e itself when leaving, the twin when arriving
+    if (pos == 1.0) addArc(p, edges[e].to, -1, 0.0, walk);
+    else if (!asTarget) addArc(p, edges[e].to, e, 1.0 - pos, walk);
+    else if (twin >= 0) addArc(p, edges[e].to, twin, 1.0 - pos, walk);
+
+    addStopArcs(p, stopModes);
+
+    return p->numArcs > 0 ? 0 : -1;
+}
+
+// Snaps a trip start onto the nearest car road, plus the stops of stopModes (MODE_BIT)
+// within walking distance. Returns -1 if there is nothing nearby.
+int snapSource(double lat, double lon, unsigned stopModes, SnapPoint *p) {
+
+    return snapPoint(lat, lon, stopModes, p, 0);
+}
+
+int snapTarget(double lat, double lon, unsigned stopModes, SnapPoint *p) {
+
+    return snapPoint(lat, lon, stopModes, p, 1);
+}
+
+// A point sitting on a node, for callers that already have one
+void snapAtNode(int node, SnapPoint *p) {
+
+    p->lat = p->roadLat = nodes[node].lat;
+    p->lon = p->roadLon = nodes[node].lon;
+    p->walkKm = 0.0;
+    p->edge = -1;
+    p->position = 0.0;
+    p->numArcs = 0;
+    p->numStops = 0;
+    addArc(p, node, -1, 0.0, 0.0);
+}
+
+// The arc a solved path left the source by, NULL for a ride that never reaches a node
+const SnapArc *routeStartArc(const SnapPoint *from, const int pathEdges[], int pathLen) {
+
+    if (pathLen < 2 || pathEdges[pathLen - 1] > ARC_CODE(0)) return NULL;
+    return &from->arcs[ARC_OF_CODE(pathEdges[pathLen - 1])];
+}
+
+// The arc a solved path reached the destination by
+const SnapArc *routeEndArc(const SnapPoint *to, const int pathEdges[], int pathLen) {
+
+    if (pathLen < 2 || pathEdges[0] > ARC_CODE(0)) return NULL;
+    return &to->arcs[ARC_OF_CODE(pathEdges[0])];
+}
+
+// Both points on the same road: the ride between them that never reaches a node, when the
+// road runs that way. ride->fraction is the share covered, *startPos where along it boards.
+int snapDirectRide(const SnapPoint *from, const SnapPoint *to, SnapArc *ride, double *startPos) {
+
+    int e = from->edge;
+    if (e < 0 || to->edge < 0) return 0;
+
+    int twin = reverseTwin(e);
+    double toPos;
+
+    if (to->edge == e) toPos = to->position;
+    else if (to->edge == twin) toPos = 1.0 - to->position;
+    else return 0;
+
+    ride->node = -1;
+
+    if (toPos >= from->position) 
+    {
+        ride->edge = e;
+        ride->fraction = toPos - from->position;
+        *startPos = from->position;
+    }
+    else 
+    {
+        if (twin < 0) return 0;                 // one-way, the long way round is up to the search
+        ride->edge = twin;
+        ride->fraction = from->position - toPos;
+        *startPos = 1.0 - from->position;
+    }
+
+    return 1;
+}
+
+// A point that landed on a node prints as that node, like the node snapping always did
+void printSnapPoint(const char *label, const SnapPoint *p) {
+
+    if ((p->edge < 0 && p->numStops == 0) || (p->edge >= 0 && (p->position == 0.0 || p->position == 1.0))) 
+    {
+        int node = p->edge < 0 ? p->arcs[0].node : (p->position == 0.0 ? edges[p->edge].from : edges[p->edge].to);
+        printf("%s Node: %s (%.6f, %.6f)\n", label, nodes[node].name, nodes[node].lat, nodes[node].lon);
+    }
+    else if (p->edge >= 0) 
+    {
+        const Edge *e = &edges[p->edge];
+        printf("%s Road: (%.6f, %.6f) between %s and %s, %.0f m off the road\n", label, p->roadLat, p->roadLon,
+               nodes[e->from].name, nodes[e->to].name, p->walkKm * 1000.0);
+    }
+
+    if (p->numStops > 0) 
+    {
+        printf("%s Stops: %d within %.0f m, nearest %s\n", label, p->numStops, MAX_WALK_DISTANCE_KM * 1000.0,
+               nodes[p->arcs[p->numArcs - p->numStops].node].name);
+    }
+}
+
+double arcTravelMin(const SnapArc *a, double speedKmh, double departMin, const TrafficSnapshot *t) {
+
+    if (a->edge < 0) return 0.0;
+
+    double minutes = profileTravelMin(edgeProfile[a->edge], speedKmh, arcDistance(a), departMin);
+    return minutes / trafficFactor(t, a->edge);
+}
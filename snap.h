@@ -0,0 +1,91 @@
+#ifndef snap_H
+#define snap_H
+
+#include "nodesAndEdges.h"
+#include "spatialGrid.h"
+#include "traffic.h"
+
+#define SNAP_CELL_KM 0.25               // segment buckets, about a city block
+#define SNAP_MAX_RADIUS_KM 5.0          // past this a point is not on the map
+#define SNAP_MAX_STOPS 16               // stops within walking distance that seed a search
+#define SNAP_MAX_ARCS (2 + SNAP_MAX_STOPS)
+
+// How a path entry was reached when it was not by an edge: arc a of the snapped point.
+// pathEdges[pathLen-1] holds the source's arc; path[0] is the destination point itself
+// (SNAP_POINT_NODE) and pathEdges[0] the arc that reaches it.
+#define SNAP_POINT_NODE -1
+#define ARC_CODE(a) (-2 - (a))
+#define ARC_OF_CODE(code) (-2 - (code))
+
+// Car road geometry bucketed per cell: every polyline segment is listed in each cell its
+// bounding box touches, so the nearest road to a point is a few cells away at most.
+// Transit stops get a grid of their own for the walks to and from them.
+typedef struct SnapIndex 
+{
+    double minLat;
+    double minLon;
+    double cellLat;
+    double cellLon;
+    int rows;
+    int cols;
+    int *cellStart;         // rows*cols+1 offsets into segEdge/segPiece
+    int *segEdge;
+    int *segPiece;          // 0 is from -> first shape point, shapeCount is last shape point -> to
+    int count;
+    SpatialGrid stops;
+    unsigned char *stopModes;       // per node, bit per transit mode boarding there, 0 if not a stop
+} SnapIndex;
+
+// One way onto (source) or off (target) the network: walk to the road and ride part of the
+// snapped edge to one of its ends, or walk straight to a stop within MAX_WALK_DISTANCE_KM.
+// A source arc goes from the point to node, a target arc from node to the point.
+typedef struct 
+{
+    int node;
+    int edge;               // -1 when nothing is ridden
+    double fraction;        // share of the edge ridden
+    double walkKm;          // between the query point and where the ride starts or ends
+} SnapArc;
+
+// Where a query point joins the road network
+typedef struct 
+{
+    double lat, lon;                // query point
+    double roadLat, roadLon;        // projected point on the road
+    double walkKm;                  // query point to the road
+    int edge;                       // snapped car edge, -1 for a node snap
+    double position;                // along the edge from its from node, 0..1 by length
+    SnapArc arcs[SNAP_MAX_ARCS];    // the snapped edge, its reverse twin, then the stops
+    int numArcs;
+    int numStops;                   // the last numStops arcs, nearest first
+} SnapPoint;
+
+void buildSnapIndex(Graph *g);
+void freeSnapIndex(Graph *g);
+int snapSource(double lat, double lon, unsigned stopModes, SnapPoint *p);
+int snapTarget(double lat, double lon, unsigned stopModes, SnapPoint *p);
+void snapAtNode(int node, SnapPoint *p);
+const SnapArc *routeStartArc(const SnapPoint *from, const int pathEdges[], int pathLen);
+const SnapArc *routeEndArc(const SnapPoint *to, const int pathEdges[], int pathLen);
+int snapDirectRide(const SnapPoint *from, const SnapPoint *to, SnapArc *ride, double *startPos);
+void printSnapPoint(const char *label, const SnapPoint *p);
+void edgeVertex(int edgeIdx, int k, double *lat, double *lon);
+
+static inline double arcDistance(const SnapArc *a) {
+
+    return a->edge >= 0 ? edges[a->edge].distance * a->fraction : 0.0;
+}
+
+static inline double arcWalkMin(const SnapArc *a) {
+
+    return (a->walkKm / WALK_SPEED_KMH) * 60.0;
+}
+
+static inline int isArcClosed(const TrafficSnapshot *t, const SnapArc *a) {
+
+    return a->edge >= 0 && isEdgeClosed(t, a->edge);
+}
+
+double arcTravelMin(const SnapArc *a, double speedKmh, double departMin, const TrafficSnapshot *t);
+
+#endif
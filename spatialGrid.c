@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <math.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "spatialGrid.h"
+
+static int cellOf(const SpatialGrid *grid, double lat, double lon, int *row, int *col) {
+
+    *row = (int)((lat - grid->minLat) / grid->cellLat);
+    *col = (int)((lon - grid->minLon) / grid->cellLon);
+
+    if (*row < 0) *row = 0;
+    if (*col < 0) *col = 0;
+    if (*row >= grid->rows) *row = grid->rows - 1;
+    if (*col >= grid->cols) *col = grid->cols - 1;
+
+    return *row * grid->cols + *col;
+}
+
+void buildNodeGrid(SpatialGrid *grid, double cellKm) {
+
+    buildNodeGridWhere(grid, cellKm, NULL);
+}
+
+// Only the nodes with keep[i] set, all of them when keep is NULL
+void buildNodeGridWhere(SpatialGrid *grid, double cellKm, const unsigned char *keep) {
+
+    double minLat = 90, maxLat = -90, minLon = 180, maxLon = -180;
+
+    for (int i = 0; i < numNodes; i++) 
+    {
+        if (nodes[i].lat < minLat) minLat = nodes[i].lat;
+        if (nodes[i].lat > maxLat) maxLat = nodes[i].lat;
+        if (nodes[i].lon < minLon) minLon = nodes[i].lon;
+        if (nodes[i].lon > maxLon) maxLon = nodes[i].lon;
+    }
+
+    if (numNodes == 0) minLat = maxLat = minLon = maxLon = 0;
+
+    double midLat = (minLat + maxLat) / 2.0;
+    double kmPerDegLat = EARTH_RADIUS_KM * PI / 180.0;
+
+    grid->minLat = minLat;
+    grid->minLon = minLon;
+    grid->cellLat = cellKm / kmPerDegLat;
+    grid->cellLon = cellKm / (kmPerDegLat * cos(midLat * PI / 180.0));
+    grid->rows = (int)((maxLat - minLat) / grid->cellLat) + 1;
+    grid->cols = (int)((maxLon - minLon) / grid->cellLon) + 1;
+
+    int cells = grid->rows * grid->cols;
+    grid->cellStart = calloc(cells + 1, sizeof(int));
+    grid->items = malloc(sizeof(int) * (numNodes + 1));
+
+    int *cellIdx = malloc(sizeof(int) * (numNodes + 1));
+    int row, col;
+
+    grid->count = 0;
+
+    for (int i = 0; i < numNodes; i++) 
+    {
+        if (keep && !keep[i]) continue;
+        cellIdx[i] = cellOf(grid, nodes[i].lat, nodes[i].lon, &row, &col);
+        grid->cellStart[cellIdx[i] + 1]++;
+        grid->count++;
+    }
+
+    for (int c = 0; c < cells; c++) grid->cellStart[c + 1] += grid->cellStart[c];
+
+    int *fill = malloc(sizeof(int) * (cells + 1));
+    for (int c = 0; c < cells; c++) fill[c] = grid->cellStart[c];
+    for (int i = 0; i < numNodes; i++) if (!keep || keep[i]) grid->items[fill[cellIdx[i]]++] = i;
+
+    free(fill);
+    free(cellIdx);
+}
+
+// Every node within radiusKm of (lat, lon) in no particular order; returns the full count even past maxOut
+int queryGridRadius(const SpatialGrid *grid, double lat, double lon, double radiusKm, int out[], int maxOut) {
+
+    int row, col;
+    cellOf(grid, lat, lon, &row, &col);
+
+    double kmPerDegLat = EARTH_RADIUS_KM * PI / 180.0;
+    int spanRows = (int)ceil(radiusKm / kmPerDegLat / grid->cellLat);
+    int spanCols = (int)ceil(radiusKm / kmPerDegLat / cos(lat * PI / 180.0) / grid->cellLon);
+    int found = 0;
+
+    for (int r = row - spanRows; r <= row + spanRows; r++) 
+    {
+        if (r < 0 || r >= grid->rows) continue;
+
+        for (int c = col - spanCols; c <= col + spanCols; c++) 
+        {
+            if (c < 0 || c >= grid->cols) continue;
+
+            int cell = r * grid->cols + c;
+            for (int k = grid->cellStart[cell]; k < grid->cellStart[cell + 1]; k++) 
+            {
+                int n = grid->items[k];
+                if (haversineDistance(lat, lon, nodes[n].lat, nodes[n].lon) > radiusKm) continue;
+
+                if (found < maxOut) out[found] = n;
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+void freeSpatialGrid(SpatialGrid *grid) {
+
+    free(grid->cellStart);
+    free(grid->items);
+    grid->cellStart = NULL;
+    grid->items = NULL;
+    grid->count = 0;
+}
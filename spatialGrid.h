@@ -0,0 +1,22 @@
+#ifndef spatialGrid_H
+#define spatialGrid_H
+
+typedef struct 
+{
+    double minLat;
+    double minLon;
+    double cellLat;     // cell size in degrees, roughly square on the ground
+    double cellLon;
+    int rows;
+    int cols;
+    int *cellStart;     // rows*cols+1 offsets into items
+    int *items;
+    int count;
+} SpatialGrid;
+
+void buildNodeGrid(SpatialGrid *grid, double cellKm);
+void buildNodeGridWhere(SpatialGrid *grid, double cellKm, const unsigned char *keep);
+int queryGridRadius(const SpatialGrid *grid, double lat, double lon, double radiusKm, int out[], int maxOut);
+void freeSpatialGrid(SpatialGrid *grid);
+
+#endif
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "csvParse.h"
+#include "timeHandling.h"
+#include "speedProfile.h"
+
+__thread SpeedProfile *speedProfiles = NULL;
+__thread int numSpeedProfiles = 0;
+__thread unsigned char *edgeProfile = NULL;
+
+static int findProfile(const char *name) {
+
+    for (int p = 1; p < numSpeedProfiles; p++) 
+    {
+        if (strcmp(speedProfiles[p].name, name) == 0) return p;
+    }
+
+    return -1;
+}
+
+// Reads "profile,<name>,H:MM,factor,..." rows, then assigns them to edges with
+// "mode,<mode>,<name>" and "area,minLat,minLon,maxLat,maxLon,<name>" rows, later rows win.
+// The roadmap has no road classes, so mode and area stand in for them.
+// Returns the number of edges given a profile, or -1 if the file is missing.
+int loadSpeedProfiles(const char *filename) {
+
+    FILE *f = fopen(filename, "r");
+    memset(edgeProfile, 0, sizeof(unsigned char) * numEdges);
+    numSpeedProfiles = 1;
+    strcpy(speedProfiles[0].name, "flat");
+    speedProfiles[0].numPoints = 0;
+
+    if (!f) return -1;
+
+    char line[1024];
+    char *tokens[2 * MAX_PROFILE_POINTS + 8];
+    int lineNo = 0;
+
+    while (fgets(line, sizeof(line), f)) 
+    {
+        lineNo++;
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '#' || line[0] == '\0') continue;
+
+        int count = split_csv(line, tokens, 2 * MAX_PROFILE_POINTS + 8);
+        if (count == 0) continue;
+
+        if (strcmp(tokens[0], "profile") == 0 && count >= 4 && count % 2 == 0) 
+        {
+            if (numSpeedProfiles == MAX_SPEED_PROFILES || findProfile(tokens[1]) > 0) 
+            {
+                printf("%s:%d: too many or duplicate profiles\n", filename, lineNo);
+                continue;
+            }
+            if ((count - 2) / 2 > MAX_PROFILE_POINTS) 
+            {
+                printf("%s:%d: more than %d breakpoints\n", filename, lineNo, MAX_PROFILE_POINTS);
+                continue;
+            }
+
+            SpeedProfile *p = &speedProfiles[numSpeedProfiles];
+            snprintf(p->name, sizeof(p->name), "%s", tokens[1]);
+            p->numPoints = 0;
+            int ok = 1;
+
+            for (int t = 2; t + 1 < count; t += 2) 
+            {
+                int minute = parseClockMin(tokens[t]);
+                double factor = atof(tokens[t + 1]);
+
+                if (minute < 0 || factor < 0.05 || (p->numPoints > 0 && minute <= p->minute[p->numPoints - 1])) ok = 0;
+                p->minute[p->numPoints] = (unsigned short)minute;
+                p->factor[p->numPoints] = (float)factor;
+                p->numPoints++;
+            }
+
+            if (!ok || p->minute[p->numPoints - 1] >= MINUTES_PER_DAY) 
+            {
+                printf("%s:%d: breakpoints must be increasing times before 24:00 with factors >= 0.05\n", filename, lineNo);
+                continue;
+            }
+
+            numSpeedProfiles++;
+        }
+        else if (strcmp(tokens[0], "mode") == 0 && count == 3) 
+        {
+            Mode mode;
+            int p = findProfile(tokens[2]);
+            if (!parseModeToken(tokens[1], &mode) || p < 0) 
+            {
+                printf("%s:%d: unknown mode or profile\n", filename, lineNo);
+                continue;
+            }
+
+            for (int i = 0; i < numEdges; i++) if (edges[i].mode == mode) edgeProfile[i] = (unsigned char)p;
+        }
+        else if (strcmp(tokens[0], "area") == 0 && count == 6) 
+        {
+            double minLat = atof(tokens[1]), minLon = atof(tokens[2]);
+            double maxLat = atof(tokens[3]), maxLon = atof(tokens[4]);
+            int p = findProfile(tokens[5]);
+            if (p < 0) 
+            {
+                printf("%s:%d: unknown profile\n", filename, lineNo);
+                continue;
+            }
+
+            for (int i = 0; i < numEdges; i++) 
+            {
+                if (edges[i].mode == MODE_WALK || edges[i].mode == MODE_METRO) continue;         // off the roads
+
+                double lat = (nodes[edges[i].from].lat + nodes[edges[i].to].lat) / 2;
+                double lon = (nodes[edges[i].from].lon + nodes[edges[i].to].lon) / 2;
+                if (lat >= minLat && lat <= maxLat && lon >= minLon && lon <= maxLon) edgeProfile[i] = (unsigned char)p;
+            }
+        }
+        else 
+        {
+            printf("%s:%d: unrecognised row\n", filename, lineNo);
+        }
+    }
+
+    fclose(f);
+
+    int assigned = 0;
+    for (int i = 0; i < numEdges; i++) if (edgeProfile[i]) assigned++;
+    return assigned;
+}
+
+// Breakpoint segment containing minute-of-day t, wrapping from the last point to the first
+static int profileSegment(const SpeedProfile *p, double t, double *startMin, double *endMin) {
+
+    int k = p->numPoints - 1;
+    for (int i = 0; i < p->numPoints; i++) 
+    {
+        if (p->minute[i] > t) break;
+        k = i;
+    }
+
+    int next = (k + 1) % p->numPoints;
+    *startMin = p->minute[k];
+    *endMin = p->minute[next];
+
+    if (t < p->minute[0]) *startMin -= MINUTES_PER_DAY;          // before the first point, still on the wrap segment
+    if (*endMin <= *startMin) *endMin += MINUTES_PER_DAY;
+
+    return k;
+}
+
+double speedFactorAt(int profile, double minute) {
+
+    const SpeedProfile *p = &speedProfiles[profile];
+    if (profile <= 0 || p->numPoints == 0) return 1.0;
+    if (p->numPoints == 1) return p->factor[0];
+
+    double t = fmod(minute, MINUTES_PER_DAY);
+    if (t < 0) t += MINUTES_PER_DAY;
+
+    double startMin, endMin;
+    int k = profileSegment(p, t, &startMin, &endMin);
+    double f0 = p->factor[k];
+    double f1 = p->factor[(k + 1) % p->numPoints];
+
+    return f0 + (f1 - f0) * (t - startMin) / (endMin - startMin);
+}
+
+// Minutes to cover distanceKm leaving at departMin: walks the profile segments, within each
+// the speed is linear in time, so the distance covered is a quadratic we can solve exactly.
+double profileTravelMin(int profile, double speedKmh, double distanceKm, double departMin) {
+
+    const SpeedProfile *p = &speedProfiles[profile];
+    double perMin = speedKmh / 60.0;
+
+    if (distanceKm <= 0) return 0.0;
+    if (profile <= 0 || p->numPoints <= 1) return distanceKm / (perMin * speedFactorAt(profile, departMin));
+
+    double t = departMin;
+    double remaining = distanceKm;
+
+    for (int guard = 0; guard < 4 * MAX_PROFILE_POINTS * 7; guard++)        // a week of segments is plenty
+    {
+        double tod = fmod(t, MINUTES_PER_DAY);
+        if (tod < 0) tod += MINUTES_PER_DAY;
+
+        double startMin, endMin;
+        int k = profileSegment(p, tod, &startMin, &endMin);
+        double f0 = p->factor[k];
+        double f1 = p->factor[(k + 1) % p->numPoints];
+        double slope = perMin * (f1 - f0) / (endMin - startMin);          // km/min per min
+        double v = perMin * f0 + slope * (tod - startMin);                  // km/min right now
+        double span = endMin - tod;
+        double covered = v * span + 0.5 * slope * span * span;
+
+        if (covered >= remaining) 
+        {
+            double x = (fabs(slope) < 1e-12) ? remaining / v : (-v + sqrt(v * v + 2.0 * slope * remaining)) / slope;
+            return t + x - departMin;
+        }
+
+        remaining -= covered;
+        t += span;
+    }
+
+    return t - departMin + remaining / (perMin * speedFactorAt(profile, t));
+}
@@ -0,0 +1,37 @@
+#ifndef speedProfile_H
+#define speedProfile_H
+
+#include "nodesAndEdges.h"
+
+#define MAX_SPEED_PROFILES 32           // profile 0 is the flat one
+#define MAX_PROFILE_POINTS 24
+#define MINUTES_PER_DAY 1440
+
+// Speed factor against time of day, linear between breakpoints and repeating every day.
+// Travel time comes from integrating the speed over the trip, so leaving later never
+// gets you there earlier (FIFO) even where the factor rises steeply.
+typedef struct SpeedProfile 
+{
+    char name[24];
+    int numPoints;
+    unsigned short minute[MAX_PROFILE_POINTS];
+    float factor[MAX_PROFILE_POINTS];
+} SpeedProfile;
+
+extern __thread SpeedProfile *speedProfiles;           // views into the pinned Graph
+extern __thread int numSpeedProfiles;
+extern __thread unsigned char *edgeProfile;             // one byte per edge
+
+int loadSpeedProfiles(const char *filename);
+double speedFactorAt(int profile, double minute);
+double profileTravelMin(int profile, double speedKmh, double distanceKm, double departMin);
+
+static inline double edgeTravelMin(int edgeIdx, double speedKmh, double departMin) {
+
+    int profile = edgeProfile[edgeIdx];
+    if (profile == 0) return (edges[edgeIdx].distance / speedKmh) * 60.0;
+
+    return profileTravelMin(profile, speedKmh, edges[edgeIdx].distance, departMin);
+}
+
+#endif
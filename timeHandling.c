@@ -1,10 +1,13 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 #include "mode.h"
 #include "nodesAndEdges.h"
-
-double arrivalTime[MAX_NODES];
+#include "csvParse.h"
+#include "timetable.h"
+#include "timeHandling.h"
 
 int parseTime(const char* timeStr) {
 
@@ -54,25 +57,87 @@ void formatTime(int minutes, char* buffer, int bufferSize) {
     snprintf(buffer, bufferSize, "%d:%02d %s", displayHour, min, period);
 }
 
-double getWaitingTime(int currentTimeMin, Mode mode) {
+int parseClockMin(const char *s) {              // "H:MM", 24 hour, up to 24:00
+
+    int h, m;
+    if (sscanf(s, "%d:%d", &h, &m) != 2 || h < 0 || h > 24 || m < 0 || m > 59) return -1;
+
+    int minute = h * 60 + m;
+    return minute <= 24 * 60 ? minute : -1;
+}
+
+double getWaitingTime(int node, int currentTimeMin, Mode mode) {
     
     if (mode == MODE_CAR || mode == MODE_WALK) 
     {
         return 0.0;
     }
     
-    if (currentTimeMin < SCHEDULE_START_MIN || currentTimeMin >= SCHEDULE_END_MIN) 
+    return nextDepartureWait(&activeGraph->timetables[TIMETABLE_DEFAULT], node, mode, currentTimeMin);
+}
+
+// The mode.h constants, used for anything the schedule file leaves out
+void defaultSchedules(Graph *g) {
+
+    for (int m = 0; m < NUM_MODES; m++) 
     {
-        return INF;
+        g->schedule[m] = (ServiceSchedule){ SCHEDULE_START_MIN, SCHEDULE_END_MIN, SCHEDULE_INTERVAL_MIN };
     }
-    
-    int minutesSinceStart = currentTimeMin - SCHEDULE_START_MIN;
-    
-    int minutesToNext = SCHEDULE_INTERVAL_MIN - (minutesSinceStart % SCHEDULE_INTERVAL_MIN);
-    if (minutesToNext == SCHEDULE_INTERVAL_MIN) 
+
+    g->problem6Schedule[MODE_METRO] = (ServiceSchedule){ METRO_START_MIN, METRO_END_MIN, METRO_INTERVAL_MIN };
+    g->problem6Schedule[MODE_BIKOLPO] = (ServiceSchedule){ BIKOLPO_START_MIN, BIKOLPO_END_MIN, BIKOLPO_INTERVAL_MIN };
+    g->problem6Schedule[MODE_UTTARA] = (ServiceSchedule){ UTTARA_START_MIN, UTTARA_END_MIN, UTTARA_INTERVAL_MIN };
+    g->problem6Schedule[MODE_WALK] = g->problem6Schedule[MODE_CAR] = (ServiceSchedule){ 0, 24 * 60, 1 };
+}
+
+// Rows are "<default|problem6>,<mode>,H:MM,H:MM,headwayMin" and override the defaults
+// of the graph being built. Returns the rows applied, or -1 if the file is missing.
+int loadSchedules(Graph *g, const char *filename) {
+
+    defaultSchedules(g);
+
+    FILE *f = fopen(filename, "r");
+    if (!f) return -1;
+
+    char line[256];
+    char *tokens[8];
+    int lineNo = 0, applied = 0;
+
+    while (fgets(line, sizeof(line), f)) 
     {
-        minutesToNext = 0;  
+        lineNo++;
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '#' || line[0] == '\0') continue;
+
+        Mode mode;
+        if (split_csv(line, tokens, 8) != 5 || !parseModeToken(tokens[1], &mode)) 
+        {
+            printf("%s:%d: expected set,mode,first,last,headway\n", filename, lineNo);
+            continue;
+        }
+
+        ServiceSchedule s = { parseClockMin(tokens[2]), parseClockMin(tokens[3]), atoi(tokens[4]) };
+        if (s.startMin < 0 || s.endMin <= s.startMin || s.intervalMin <= 0) 
+        {
+            printf("%s:%d: bad service hours or headway\n", filename, lineNo);
+            continue;
+        }
+
+        if (strcmp(tokens[0], "default") == 0) g->schedule[mode] = s;
+        else if (strcmp(tokens[0], "problem6") == 0) g->problem6Schedule[mode] = s;
+        else continue;
+
+        applied++;
     }
-    
-    return (double)minutesToNext;
+
+    fclose(f);
+    return applied;
+}
+
+double monotonicMs() {          // wall clock for timing, not the schedule clock
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
 }
\ No newline at end of file
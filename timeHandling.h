@@ -4,10 +4,12 @@
 #include "mode.h"
 #include "nodesAndEdges.h"
 
-extern double arrivalTime[MAX_NODES];
-
 int parseTime(const char* timeStr);
 void formatTime(int minutes, char* buffer, int bufferSize);
-double getWaitingTime(int currentTimeMin, Mode mode);
+int parseClockMin(const char *s);
+double getWaitingTime(int node, int currentTimeMin, Mode mode);
+void defaultSchedules(Graph *g);
+int loadSchedules(Graph *g, const char *filename);
+double monotonicMs();
 
 #endif
@@ -0,0 +1,438 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "spatialGrid.h"
+#include "timeHandling.h"
+#include "timetable.h"
+
+#define MAX_FEED_LINE 1024
+#define MAX_FEED_FIELDS 32
+#define MAX_FEED_ID 48
+#define STOP_MATCH_KM 0.05
+#define MAX_STOP_CANDIDATES 256
+
+// A GTFS-like feed in one directory, only the columns used here are read:
+//   stops.txt       stop_id, stop_lat, stop_lon
+//   routes.txt      route_id, route_mode (walk/metro/car/bikolpo/uttara, not standard GTFS)
+//   trips.txt       trip_id, route_id, service_id ("default" or "problem6")
+//   stop_times.txt  trip_id, departure_time (H:MM or H:MM:SS), stop_id
+// None ships as GTFS-Dhaka; GTFS-Dhaka-sample has three Line 6 stations in that layout, the
+// benchmark checks its waits. Stops are matched to nodes by position, so list stations only.
+
+typedef struct 
+{
+    char id[MAX_FEED_ID];
+    int value;                  // stop index, mode, or mode + set packed for trips
+} FeedId;
+
+typedef struct 
+{
+    int node;
+    int mode;
+    int minute;
+} Departure;
+
+typedef struct 
+{
+    FeedId *items;
+    int count;
+    int capacity;
+} FeedIds;
+
+// Splits in place and keeps empty fields, which GTFS uses a lot (strtok would drop them)
+static int splitFields(char *line, char **fields, int maxFields) {
+
+    int count = 0;
+    char *p = line;
+
+    while (count < maxFields) 
+    {
+        fields[count++] = p;
+        char *comma = strchr(p, ',');
+        if (!comma) break;
+        *comma = '\0';
+        p = comma + 1;
+    }
+
+    for (int i = 0; i < count; i++) 
+    {
+        char *f = fields[i];
+        size_t n = strlen(f);
+        if (n >= 2 && f[0] == '"' && f[n - 1] == '"')          // ids are sometimes quoted
+        {
+            f[n - 1] = '\0';
+            fields[i] = f + 1;
+        }
+    }
+
+    return count;
+}
+
+static int columnOf(char **header, int count, const char *name) {
+
+    for (int i = 0; i < count; i++) if (strcmp(header[i], name) == 0) return i;
+    return -1;
+}
+
+static FILE *openFeedFile(const char *feedDir, const char *name, char *line, char **header, int *numColumns) {
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", feedDir, name);
+
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+
+    if (!fgets(line, MAX_FEED_LINE, f)) 
+    {
+        fclose(f);
+        return NULL;
+    }
+
+    line[strcspn(line, "\r\n")] = 0;
+    if ((unsigned char)line[0] == 0xEF) memmove(line, line + 3, strlen(line + 3) + 1);       // UTF-8 BOM
+    *numColumns = splitFields(line, header, MAX_FEED_FIELDS);
+
+    return f;
+}
+
+static void addFeedId(FeedIds *ids, const char *id, int value) {
+
+    if (ids->count == ids->capacity) 
+    {
+        ids->capacity = ids->capacity ? ids->capacity * 2 : 256;
+        ids->items = realloc(ids->items, sizeof(FeedId) * ids->capacity);
+    }
+
+    snprintf(ids->items[ids->count].id, MAX_FEED_ID, "%s", id);
+    ids->items[ids->count].value = value;
+    ids->count++;
+}
+
+static int compareFeedIds(const void *a, const void *b) {
+
+    return strcmp(((const FeedId *)a)->id, ((const FeedId *)b)->id);
+}
+
+static int findFeedId(const FeedIds *ids, const char *id) {
+
+    FeedId key;
+    snprintf(key.id, MAX_FEED_ID, "%s", id);
+
+    FeedId *hit = bsearch(&key, ids->items, ids->count, sizeof(FeedId), compareFeedIds);
+    return hit ? hit->value : -1;
+}
+
+static int compareDepartures(const void *a, const void *b) {
+
+    const Departure *x = (const Departure *)a;
+    const Departure *y = (const Departure *)b;
+
+    if (x->node != y->node) return x->node - y->node;
+    if (x->mode != y->mode) return x->mode - y->mode;
+    return x->minute - y->minute;
+}
+
+static int parseDepartureTime(const char *s) {          // GTFS allows 25:10:00 for trips past midnight
+
+    int h, m, sec = 0;
+    if (sscanf(s, "%d:%d:%d", &h, &m, &sec) < 2 || h < 0 || m < 0 || m > 59) return -1;
+
+    return h * 60 + m + (sec > 0 ? 1 : 0);              // can't board something that already left
+}
+
+// Nearest node within STOP_MATCH_KM that the given mode departs from
+static int matchStop(const SpatialGrid *grid, const unsigned char *nodeModes, double lat, double lon, int mode) {
+
+    int candidates[MAX_STOP_CANDIDATES];
+    int found = queryGridRadius(grid, lat, lon, STOP_MATCH_KM, candidates, MAX_STOP_CANDIDATES);
+    if (found > MAX_STOP_CANDIDATES) found = MAX_STOP_CANDIDATES;
+
+    int best = -1;
+    double bestKm = STOP_MATCH_KM;
+
+    for (int k = 0; k < found; k++) 
+    {
+        int n = candidates[k];
+        if (!(nodeModes[n] & (1 << mode))) continue;
+
+        double d = haversineDistance(lat, lon, nodes[n].lat, nodes[n].lon);
+        if (d <= bestKm) 
+        {
+            bestKm = d;
+            best = n;
+        }
+    }
+
+    return best;
+}
+
+// Reads the feed into one list of departures per service set. Returns the number of
+// stop_times rows used, or -1 if there is no feed.
+static int readFeed(const char *feedDir, Departure **sets, int setCounts[]) {
+
+    char line[MAX_FEED_LINE];
+    char *fields[MAX_FEED_FIELDS];
+    int numColumns;
+    FILE *f;
+
+    if (!(f = openFeedFile(feedDir, "stops.txt", line, fields, &numColumns))) 
+    {
+        printf("Timetable feed %s: no readable stops.txt, headway schedules only\n", feedDir);
+        return -1;
+    }
+
+    int idCol = columnOf(fields, numColumns, "stop_id");
+    int latCol = columnOf(fields, numColumns, "stop_lat");
+    int lonCol = columnOf(fields, numColumns, "stop_lon");
+
+    FeedIds stops = { NULL, 0, 0 };
+    double *stopLat = NULL, *stopLon = NULL;
+
+    while (idCol >= 0 && latCol >= 0 && lonCol >= 0 && fgets(line, sizeof(line), f)) 
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        if (splitFields(line, fields, MAX_FEED_FIELDS) <= idCol || fields[idCol][0] == '\0') continue;
+
+        stopLat = realloc(stopLat, sizeof(double) * (stops.count + 1));
+        stopLon = realloc(stopLon, sizeof(double) * (stops.count + 1));
+        stopLat[stops.count] = atof(fields[latCol]);
+        stopLon[stops.count] = atof(fields[lonCol]);
+        addFeedId(&stops, fields[idCol], stops.count);
+    }
+    fclose(f);
+    qsort(stops.items, stops.count, sizeof(FeedId), compareFeedIds);
+
+    FeedIds routes = { NULL, 0, 0 };
+    if ((f = openFeedFile(feedDir, "routes.txt", line, fields, &numColumns))) 
+    {
+        idCol = columnOf(fields, numColumns, "route_id");
+        int modeCol = columnOf(fields, numColumns, "route_mode");
+
+        while (idCol >= 0 && modeCol >= 0 && fgets(line, sizeof(line), f)) 
+        {
+            line[strcspn(line, "\r\n")] = 0;
+            Mode mode;
+            int n = splitFields(line, fields, MAX_FEED_FIELDS);
+            if (n > idCol && n > modeCol && parseModeToken(fields[modeCol], &mode)) addFeedId(&routes, fields[idCol], mode);
+        }
+        fclose(f);
+    }
+    qsort(routes.items, routes.count, sizeof(FeedId), compareFeedIds);
+
+    FeedIds trips = { NULL, 0, 0 };
+    if ((f = openFeedFile(feedDir, "trips.txt", line, fields, &numColumns))) 
+    {
+        idCol = columnOf(fields, numColumns, "trip_id");
+        int routeCol = columnOf(fields, numColumns, "route_id");
+        int serviceCol = columnOf(fields, numColumns, "service_id");
+
+        while (idCol >= 0 && routeCol >= 0 && serviceCol >= 0 && fgets(line, sizeof(line), f)) 
+        {
+            line[strcspn(line, "\r\n")] = 0;
+            int n = splitFields(line, fields, MAX_FEED_FIELDS);
+            if (n <= idCol || n <= routeCol || n <= serviceCol) continue;
+
+            int mode = findFeedId(&routes, fields[routeCol]);
+            int set = strcmp(fields[serviceCol], "default") == 0 ? TIMETABLE_DEFAULT
+                    : strcmp(fields[serviceCol], "problem6") == 0 ? TIMETABLE_PROBLEM6 : -1;
+            if (mode >= 0 && set >= 0) addFeedId(&trips, fields[idCol], set * NUM_MODES + mode);
+        }
+        fclose(f);
+    }
+    qsort(trips.items, trips.count, sizeof(FeedId), compareFeedIds);
+
+    unsigned char *nodeModes = calloc(numNodes + 1, 1);         // bit per mode departing the node
+    for (int i = 0; i < numEdges; i++) nodeModes[edges[i].from] |= 1 << edges[i].mode;
+
+    int *stopNode = malloc(sizeof(int) * (stops.count * NUM_MODES + 1));      // matched lazily per mode
+    for (int i = 0; i < stops.count * NUM_MODES; i++) stopNode[i] = -2;
+
+    SpatialGrid grid;
+    buildNodeGrid(&grid, STOP_MATCH_KM);
+
+    int setCapacity[NUM_TIMETABLES] = { 0 };
+    int used = 0, unmatched = 0;
+
+    if ((f = openFeedFile(feedDir, "stop_times.txt", line, fields, &numColumns))) 
+    {
+        int tripCol = columnOf(fields, numColumns, "trip_id");
+        int timeCol = columnOf(fields, numColumns, "departure_time");
+        int stopCol = columnOf(fields, numColumns, "stop_id");
+
+        while (tripCol >= 0 && timeCol >= 0 && stopCol >= 0 && fgets(line, sizeof(line), f)) 
+        {
+            line[strcspn(line, "\r\n")] = 0;
+            int n = splitFields(line, fields, MAX_FEED_FIELDS);
+            if (n <= tripCol || n <= timeCol || n <= stopCol) continue;
+
+            int trip = findFeedId(&trips, fields[tripCol]);
+            int stop = findFeedId(&stops, fields[stopCol]);
+            int minute = parseDepartureTime(fields[timeCol]);
+            if (trip < 0 || stop < 0 || minute < 0 || minute > 65535) continue;
+
+            int set = trip / NUM_MODES, mode = trip % NUM_MODES;
+            int *node = &stopNode[stop * NUM_MODES + mode];
+            if (*node == -2) 
+            {
+                *node = matchStop(&grid, nodeModes, stopLat[stop], stopLon[stop], mode);
+                if (*node < 0) unmatched++;
+            }
+            if (*node < 0) continue;
+
+            if (setCounts[set] == setCapacity[set]) 
+            {
+                setCapacity[set] = setCapacity[set] ? setCapacity[set] * 2 : 1024;
+                sets[set] = realloc(sets[set], sizeof(Departure) * setCapacity[set]);
+            }
+            sets[set][setCounts[set]++] = (Departure){ *node, mode, minute };
+            used++;
+        }
+        fclose(f);
+    }
+
+    printf("Timetable feed %s: %d stops (%d unmatched), %d trips, %d departures\n", feedDir, stops.count, unmatched,
+           trips.count, used);
+
+    freeSpatialGrid(&grid);
+    free(stopNode);
+    free(nodeModes);
+    free(stopLat);
+    free(stopLon);
+    free(stops.items);
+    free(routes.items);
+    free(trips.items);
+
+    return used;
+}
+
+// Packs the sorted departures into rows, then appends the headway row
+static void buildTimetable(Timetable *t, Departure *list, int count, const ServiceSchedule schedule[]) {
+
+    qsort(list, count, sizeof(Departure), compareDepartures);
+
+    t->feedModes = 0;
+    for (int i = 0; i < count; i++) t->feedModes |= 1 << list[i].mode;
+
+    // Shape points are the unnamed nodes on a line of a mode the feed times, roads and
+    // the lines it leaves out keep the headway row
+    t->nodeRow = malloc(sizeof(int) * (numNodes + 1));
+    for (int i = 0; i < numNodes; i++) t->nodeRow[i] = -1;
+    for (int i = 0; i < numEdges; i++) 
+    {
+        int from = edges[i].from;
+        if ((t->feedModes & (1 << edges[i].mode)) && !isNamedStation(from)) t->nodeRow[from] = -2;
+    }
+
+    t->numRows = 0;
+    for (int i = 0; i < count; i++) 
+    {
+        if (t->nodeRow[list[i].node] < 0) t->nodeRow[list[i].node] = t->numRows++;
+    }
+
+    int headwayCount = 0;
+    for (int m = 0; m < NUM_MODES; m++) 
+    {
+        t->window[m] = schedule[m];
+        if (m != MODE_CAR && m != MODE_WALK) headwayCount += (schedule[m].endMin - schedule[m].startMin) / schedule[m].intervalMin + 2;
+    }
+
+    int numSlots = (t->numRows + 1) * NUM_MODES;
+    t->rowStart = calloc(numSlots + 1, sizeof(int));
+    t->departures = malloc(sizeof(unsigned short) * (count + headwayCount + 1));
+    t->numDepartures = 0;
+
+    int k = 0;
+    for (int slot = 0; slot < t->numRows * NUM_MODES; slot++) 
+    {
+        t->rowStart[slot] = t->numDepartures;
+
+        while (k < count && t->nodeRow[list[k].node] * NUM_MODES + list[k].mode == slot) 
+        {
+            unsigned short minute = (unsigned short)list[k].minute;
+            int start = t->rowStart[slot];
+            if (t->numDepartures == start || t->departures[t->numDepartures - 1] != minute) t->departures[t->numDepartures++] = minute;
+            k++;
+        }
+    }
+
+    // Every grid departure a rider arriving within the service hours can catch,
+    // the same answers the old modulo formula gave
+    for (int m = 0; m < NUM_MODES; m++) 
+    {
+        int slot = t->numRows * NUM_MODES + m;
+        t->rowStart[slot] = t->numDepartures;
+        if (m == MODE_CAR || m == MODE_WALK) continue;
+
+        const ServiceSchedule *s = &schedule[m];
+        for (int minute = s->startMin; minute - s->intervalMin < s->endMin - 1; minute += s->intervalMin) 
+        {
+            t->departures[t->numDepartures++] = (unsigned short)minute;
+        }
+    }
+
+    t->rowStart[numSlots] = t->numDepartures;
+}
+
+// Builds both service sets of the graph being loaded. The feed is optional, the
+// headway schedules cover whatever it leaves out. Returns the feed departures used.
+int loadTimetables(Graph *g, const char *feedDir) {
+
+    Departure *sets[NUM_TIMETABLES] = { NULL };
+    int setCounts[NUM_TIMETABLES] = { 0 };
+
+    int used = readFeed(feedDir, sets, setCounts);
+
+    g->timetables = calloc(NUM_TIMETABLES, sizeof(Timetable));
+    buildTimetable(&g->timetables[TIMETABLE_DEFAULT], sets[TIMETABLE_DEFAULT], setCounts[TIMETABLE_DEFAULT], g->schedule);
+    buildTimetable(&g->timetables[TIMETABLE_PROBLEM6], sets[TIMETABLE_PROBLEM6], setCounts[TIMETABLE_PROBLEM6], g->problem6Schedule);
+
+    for (int s = 0; s < NUM_TIMETABLES; s++) free(sets[s]);
+    return used;
+}
+
+// Minutes until the next departure of mode from node, INF when nothing leaves later that day.
+// A stop the feed covers for this mode uses its own departures, any other one the headway
+// row, which is only boardable within the service hours. The feed lists stations only, so
+// once it times a mode the shape points of that mode's lines are INF, riders pass through
+// them but never board there; without a feed every node keeps the headway row as before.
+double nextDepartureWait(const Timetable *t, int node, Mode mode, int currentTimeMin) {
+
+    int row = t->nodeRow[node];
+    int slot = row * NUM_MODES + mode;
+
+    if (row < 0 || t->rowStart[slot] == t->rowStart[slot + 1]) 
+    {
+        if (row == -2 && (t->feedModes & (1 << mode))) return INF;
+        const ServiceSchedule *w = &t->window[mode];
+        if (currentTimeMin < w->startMin || currentTimeMin >= w->endMin) return INF;
+        slot = t->numRows * NUM_MODES + mode;
+    }
+
+    int lo = t->rowStart[slot], hi = t->rowStart[slot + 1];
+    while (lo < hi)                                     // first departure at or after now
+    {
+        int mid = (lo + hi) / 2;
+        if (t->departures[mid] < currentTimeMin) lo = mid + 1;
+        else hi = mid;
+    }
+
+    if (lo == t->rowStart[slot + 1]) return INF;
+    return (double)(t->departures[lo] - currentTimeMin);
+}
+
+void freeTimetables(Graph *g) {
+
+    if (!g->timetables) return;
+
+    for (int s = 0; s < NUM_TIMETABLES; s++) 
+    {
+        free(g->timetables[s].nodeRow);
+        free(g->timetables[s].rowStart);
+        free(g->timetables[s].departures);
+    }
+
+    free(g->timetables);
+    g->timetables = NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef timetable_H
+#define timetable_H
+
+#include "mode.h"
+#include "nodesAndEdges.h"
+
+#define TIMETABLE_DEFAULT 0         // problems 4 and 5
+#define TIMETABLE_PROBLEM6 1
+#define NUM_TIMETABLES 2
+
+// Departures of one service set, columnar: row r of a stop holds the sorted minutes of
+// mode m in departures[rowStart[r * NUM_MODES + m] .. rowStart[r * NUM_MODES + m + 1]-1].
+// Nodes the feed does not cover share the last row, generated from the headway schedule,
+// except the shape points between stations: a line the feed times cannot be boarded there.
+typedef struct Timetable 
+{
+    int *nodeRow;                   // graph node -> stop row, -1 for the headway row, -2 for a shape point
+    unsigned char feedModes;        // bit per mode the feed has departures for
+    int numRows;                    // feed stops, the headway row comes after them
+    int *rowStart;
+    unsigned short *departures;     // minutes after midnight, past 24:00 for late trips
+    int numDepartures;
+    ServiceSchedule window[NUM_MODES];      // boarding hours of the headway row
+} Timetable;
+
+int loadTimetables(Graph *g, const char *feedDir);
+double nextDepartureWait(const Timetable *t, int node, Mode mode, int currentTimeMin);
+void freeTimetables(Graph *g);
+
+#endif
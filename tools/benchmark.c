@@ -0,0 +1,607 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "graphLoad.h"
+#include "timeHandling.h"
+#include "search.h"
+#include "snap.h"
+#include "hierarchy.h"
+#include "phast.h"
+#include "deltaStep.h"
+#include "scheduler.h"
+#include "overlay.h"
+#include "isochrone.h"
+#include "modeProfile.h"
+#include "timetable.h"
+#include "problem1.h"
+#include "problem2.h"
+#include "problem3.h"
+#include "problem4.h"
+#include "problem5.h"
+#include "problem6.h"
+
+// Latency benchmark over reproducible random OD pairs.
+// Usage: benchmark [queriesPerClass] [seed] [out.csv]
+// The CSV goes to stdout unless a file is given; everything else, loading included, to stderr.
+// Times solveProblemN on already snapped nodes, the route cache is not involved.
+// Road snapping is timed separately on points scattered around the nodes, on stderr.
+// So are full car trees: Dijkstra against PHAST one tree at a time and PHAST_LANES at once,
+// and against delta-stepping at 1 to 16 threads. Then a batch of short trips followed by
+// long ones runs through the work-stealing scheduler. Last, problem 1 is checked against
+// the overlay query, and closures are re-customized against a full customization. Finally
+// transit isochrones must reach stops that are only a road walk and a transfer away, and
+// the sample GTFS feed must give the waits its stop_times.txt lists.
+
+#define NUM_CLASSES 3
+#define MAX_PAIR_ATTEMPTS 100000         // random pairs tried per query before a class counts as exhausted
+
+typedef struct 
+{
+    SnapPoint from;
+    SnapPoint to;
+    int startTimeMin;
+    int deadlineMin;
+} BenchQuery;
+
+static const char *classNames[NUM_CLASSES] = { "short", "medium", "long" };
+static const double classMinKm[NUM_CLASSES] = { 0.0, 2.0, 8.0 };
+static const double classMaxKm[NUM_CLASSES] = { 2.0, 8.0, 1000.0 };
+
+static unsigned long long rngState;
+
+static unsigned long long nextRandom() {          // xorshift64*, same sequence on every libc
+
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 2685821657736338717ULL;
+}
+
+static int randomBelow(int n) {
+
+    return (int)(nextRandom() % (unsigned long long)n);
+}
+
+static int compareDoubles(const void *a, const void *b) {
+
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, double p) {
+
+    int idx = (int)(p * (count - 1) + 0.5);
+    return sorted[idx];
+}
+
+// Returns how many queries it found, fewer than count when the class has (next to) no pairs
+static int generateQueries(BenchQuery *queries, int count, int cls) {
+
+    for (int q = 0; q < count; q++) 
+    {
+        int s, t, attempts = 0;
+        double d;
+
+        do 
+        {
+            if (attempts++ == MAX_PAIR_ATTEMPTS) 
+            {
+                fprintf(stderr, "Only %d %s pairs (%.0f-%.0f km) in %d tries, the class is cut short\n", q,
+                        classNames[cls], classMinKm[cls], classMaxKm[cls], MAX_PAIR_ATTEMPTS);
+                return q;
+            }
+            s = randomBelow(numNodes);
+            t = randomBelow(numNodes);
+            d = haversineDistance(nodes[s].lat, nodes[s].lon, nodes[t].lat, nodes[t].lon);
+        } while (s == t || d < classMinKm[cls] || d >= classMaxKm[cls]);
+
+        snapAtNode(s, &queries[q].from);
+        snapAtNode(t, &queries[q].to);
+        queries[q].startTimeMin = 6 * 60 + randomBelow(15 * 60);           // 6 AM to 9 PM
+        queries[q].deadlineMin = queries[q].startTimeMin + 60 + randomBelow(121);
+    }
+
+    return count;
+}
+
+static int solve(int problem, SearchSpace *space, const BenchQuery *q, int path[], int pathEdges[], double *total) {
+
+    switch (problem) 
+    {
+        case 1: return solveProblem1(space, &q->from, &q->to, path, pathEdges, total);
+        case 2: return solveProblem2(space, &q->from, &q->to, path, pathEdges, total);
+        case 3: return solveProblem3(space, &q->from, &q->to, path, pathEdges, total);
+        case 4: return solveProblem4(space, &q->from, &q->to, q->startTimeMin, path, pathEdges, total);
+        case 5: return solveProblem5(space, &q->from, &q->to, q->startTimeMin, path, pathEdges, total);
+        default: return solveProblem6(space, &q->from, &q->to, q->startTimeMin, q->deadlineMin, path, pathEdges, total);
+    }
+}
+
+// Points up to ~200 m off a random node, like a phone's fix of someone standing near a road
+static void benchmarkSnapping(int count) {
+
+    double *latencies = malloc(sizeof(double) * count);
+    int snapped = 0;
+    double startMs = monotonicMs();
+
+    for (int q = 0; q < count; q++) 
+    {
+        int n = randomBelow(numNodes);
+        double lat = nodes[n].lat + (randomBelow(3601) - 1800) * 1e-6;
+        double lon = nodes[n].lon + (randomBelow(3601) - 1800) * 1e-6;
+        SnapPoint p;
+
+        double t0 = monotonicMs();
+        if (snapSource(lat, lon, TRANSIT_MODE_BITS, &p) == 0) snapped++;
+        latencies[q] = (monotonicMs() - t0) * 1000.0;
+    }
+
+    double elapsedMs = monotonicMs() - startMs;
+    qsort(latencies, count, sizeof(double), compareDoubles);
+    fprintf(stderr, "Snap: %d points, %d on a road, %.0f per second, p50 %.1f us, p99 %.1f us\n", count, snapped,
+            count / (elapsedMs / 1000.0), percentile(latencies, count, 0.50), percentile(latencies, count, 0.99));
+
+    free(latencies);
+}
+
+// Counts the nodes of a tree more than a metre off the reference
+static long treeMismatches(const double *tree, const double *reference, size_t count) {
+
+    long mismatches = 0;
+
+    for (size_t i = 0; i < count; i++) 
+    {
+        double expected = reference[i];
+        if (expected < INF ? (tree[i] - expected > 1e-3 || expected - tree[i] > 1e-3) : tree[i] < INF) mismatches++;
+    }
+
+    return mismatches;
+}
+
+// Every tree is checked against Dijkstra's once the timed runs are over
+static void benchmarkTrees(int count) {
+
+    SearchSpace space;
+    initSearchSpace(&space);
+    SnapPoint *sources = malloc(sizeof(SnapPoint) * count);
+    double *reference = malloc(sizeof(double) * (size_t)count * numNodes);
+    double *single = malloc(sizeof(double) * (size_t)count * numNodes);
+    double *lanes = malloc(sizeof(double) * (size_t)count * numNodes);
+
+    for (int s = 0; s < count; s++) snapAtNode(randomBelow(numNodes), &sources[s]);
+
+    const Hierarchy *h = carHierarchy();
+
+    double startMs = monotonicMs();
+    for (int s = 0; s < count; s++) dijkstraTree(&space, &sources[s], reference + (size_t)s * numNodes);
+    double dijkstraMs = (monotonicMs() - startMs) / count;
+
+    startMs = monotonicMs();
+    for (int s = 0; s < count; s++) phastTree(&space, &sources[s], single + (size_t)s * numNodes);
+    double phastMs = (monotonicMs() - startMs) / count;
+
+    startMs = monotonicMs();
+    for (int s = 0; s < count; s += PHAST_LANES) 
+    {
+        int lanesUsed = count - s < PHAST_LANES ? count - s : PHAST_LANES;
+        phastTrees(&space, &sources[s], lanesUsed, lanes + (size_t)s * numNodes);
+    }
+    double lanesMs = (monotonicMs() - startMs) / count;
+
+    long mismatches = treeMismatches(single, reference, (size_t)count * numNodes) +
+                      treeMismatches(lanes, reference, (size_t)count * numNodes);
+
+    fprintf(stderr, "Trees: %d sources, hierarchy %.0f ms with %d shortcuts, dijkstra %.2f ms, phast %.2f ms (%.1fx), "
+            "phast x%d %.2f ms per tree (%.1fx), %ld mismatches\n", count, h->buildMs, h->numShortcuts, dijkstraMs, phastMs,
+            dijkstraMs / phastMs, PHAST_LANES, lanesMs, dijkstraMs / lanesMs, mismatches);
+
+    freeSearchSpace(&space);
+    free(sources);
+    free(reference);
+    free(single);
+    free(lanes);
+}
+
+static void benchmarkDeltaStepping(int count) {
+
+    static const int threadCounts[] = { 1, 2, 4, 8, 16 };
+    int numCounts = sizeof(threadCounts) / sizeof(threadCounts[0]);
+
+    SearchSpace space;
+    initSearchSpace(&space);
+    SnapPoint *sources = malloc(sizeof(SnapPoint) * count);
+    double *reference = malloc(sizeof(double) * (size_t)count * numNodes);
+    double *trees = malloc(sizeof(double) * (size_t)count * numNodes);
+    long mismatches = 0;
+
+    for (int s = 0; s < count; s++) snapAtNode(randomBelow(numNodes), &sources[s]);
+
+    double startMs = monotonicMs();
+    for (int s = 0; s < count; s++) dijkstraTree(&space, &sources[s], reference + (size_t)s * numNodes);
+    double dijkstraMs = (monotonicMs() - startMs) / count;
+
+    fprintf(stderr, "Delta-stepping: %d sources, delta %.2f km, dijkstra %.2f ms", count, DELTA_STEP_KM, dijkstraMs);
+
+    for (int c = 0; c < numCounts; c++) 
+    {
+        startMs = monotonicMs();
+        for (int s = 0; s < count; s++) deltaStepTree(&space, &sources[s], DELTA_STEP_KM, threadCounts[c], trees + (size_t)s * numNodes);
+        double ms = (monotonicMs() - startMs) / count;
+
+        mismatches += treeMismatches(trees, reference, (size_t)count * numNodes);
+        fprintf(stderr, ", %d threads %.2f ms (%.2fx)", threadCounts[c], ms, dijkstraMs / ms);
+    }
+
+    fprintf(stderr, ", %ld mismatches\n", mismatches);
+
+    freeSearchSpace(&space);
+    free(sources);
+    free(reference);
+    free(trees);
+}
+
+typedef struct 
+{
+    const BenchQuery *queries;
+    int found;
+} BenchBatch;
+
+static void batchQuery(void *arg, int task, SearchSpace *space) {
+
+    BenchBatch *batch = (BenchBatch *)arg;
+    int *path = malloc(sizeof(int) * MAX_NODES);
+    int *pathEdges = malloc(sizeof(int) * MAX_NODES);
+    double total;
+
+    if (solve(1, space, &batch->queries[task], path, pathEdges, &total) > 0 && total < INF) 
+    {
+        __atomic_fetch_add(&batch->found, 1, __ATOMIC_RELAXED);
+    }
+
+    free(path);
+    free(pathEdges);
+}
+
+// Short trips first, long ones last: a static split hands all the long ones to one worker
+static void benchmarkScheduler(int perClass) {
+
+    static const int workerCounts[] = { 1, 4, 16 };
+    BenchQuery *queries = malloc(sizeof(BenchQuery) * perClass * 2);
+
+    int count = generateQueries(queries, perClass, 0);
+    count += generateQueries(queries + count, perClass, NUM_CLASSES - 1);
+
+    for (int c = 0; c < (int)(sizeof(workerCounts) / sizeof(workerCounts[0])); c++) 
+    {
+        BenchBatch batch = { queries, 0 };
+        SchedulerStats stats;
+        double startMs = monotonicMs();
+
+        runTasks(batchQuery, &batch, count, workerCounts[c], &stats);
+
+        fprintf(stderr, "Batch: %d queries (%d found) on %d workers in %.1f ms, %ld steals took %ld tasks, "
+                "%ld empty victims, max queue depth %d\n", count, batch.found, workerCounts[c],
+                monotonicMs() - startMs, stats.steals, stats.tasksStolen, stats.failedSteals, stats.maxQueueDepth);
+    }
+
+    free(queries);
+}
+
+// Road distance of an unpacked route, partial rides at both ends included
+static double routeDistance(const BenchQuery *q, const int pathEdges[], int pathLen) {
+
+    double d = arcDistance(routeStartArc(&q->from, pathEdges, pathLen)) + arcDistance(routeEndArc(&q->to, pathEdges, pathLen));
+    for (int i = 1; i < pathLen; i++) 
+    {
+        if (pathEdges[i] >= 0) d += edges[pathEdges[i]].distance;
+    }
+
+    return d;
+}
+
+static void benchmarkOverlay(int perClass) {
+
+    static int path[MAX_NODES];
+    static int pathEdges[MAX_NODES];
+    const Overlay *o = carOverlay();
+    BenchQuery *queries = malloc(sizeof(BenchQuery) * perClass);
+    SearchSpace space;
+    initSearchSpace(&space);
+
+    for (int cls = 0; cls < NUM_CLASSES; cls++) 
+    {
+        int count = generateQueries(queries, perClass, cls);
+        if (count == 0) continue;
+
+        double dijkstraMs = 0.0, overlayMs = 0.0;
+        long dijkstraSettled = 0, overlaySettled = 0;
+        int mismatches = 0;
+
+        for (int q = 0; q < count; q++) 
+        {
+            double expected, total;
+            double startMs = monotonicMs();
+            solveProblem1(&space, &queries[q].from, &queries[q].to, path, pathEdges, &expected);
+            dijkstraMs += monotonicMs() - startMs;
+            dijkstraSettled += space.stats.nodesSettled;
+
+            startMs = monotonicMs();
+            int pathLen = overlayRoute(&space, &queries[q].from, &queries[q].to, path, pathEdges, &total);
+            overlayMs += monotonicMs() - startMs;
+            overlaySettled += space.stats.nodesSettled;
+
+            if (fabs(total - expected) > 1e-6 && (total < INF || expected < INF)) mismatches++;
+            else if (pathLen > 0 && fabs(routeDistance(&queries[q], pathEdges, pathLen) - total) > 1e-6) mismatches++;
+        }
+
+        fprintf(stderr, "Overlay %s: dijkstra %.1f us / %.0f settled, overlay %.1f us / %.0f settled (%.1fx), %d mismatches\n",
+                classNames[cls], dijkstraMs * 1000.0 / count, (double)dijkstraSettled / count,
+                overlayMs * 1000.0 / count, (double)overlaySettled / count, dijkstraMs / overlayMs, mismatches);
+    }
+
+    // a few closed roads: only their cells are redone
+    TrafficSnapshot closed = { malloc(sizeof(float) * numEdges), numEdges, 0, 1, 1, NULL };
+    for (int i = 0; i < numEdges; i++) closed.factor[i] = 1.0f;
+    for (int k = 0; k < 10; k++) 
+    {
+        closed.factor[randomBelow(numEdges)] = 0.0f;
+        closed.numClosed++;
+    }
+
+    OverlayMetric partial, full;
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        partial.clique[l] = malloc(sizeof(double) * (o->cliqueSize[l] + 1));
+        full.clique[l] = malloc(sizeof(double) * (o->cliqueSize[l] + 1));
+    }
+
+    int redone = recustomizeOverlay(o, &closed, &partial);
+    customizeOverlay(o, &closed, &full, 1);
+
+    long differ = 0;
+    for (int l = 0; l < OVERLAY_LEVELS; l++) 
+    {
+        for (int k = 0; k < o->cliqueSize[l]; k++) differ += partial.clique[l][k] != full.clique[l][k];
+    }
+
+    fprintf(stderr, "Overlay customization: full %.1f ms, %d closures redid %d cells in %.1f ms, %ld clique entries differ\n",
+            full.customizeMs, closed.numClosed, redone, partial.customizeMs, differ);
+
+    freeOverlayMetric(&partial);
+    freeOverlayMetric(&full);
+    free(closed.factor);
+    freeSearchSpace(&space);
+    free(queries);
+}
+
+// Sources one road edge short of a transfer: the stop behind it is only in the budget when a
+// walk over the road may go on over the transfer
+static void checkIsochroneTransfers(int count) {
+
+    SearchSpace space;
+    initSearchSpace(&space);
+    double walkSpeed = getModeProfile(6)->speed[MODE_WALK];
+    int tried = 0, missed = 0;
+
+    for (int attempt = 0; attempt < count * 100 && tried < count; attempt++) 
+    {
+        int transfer = randomBelow(numEdges);
+        const Edge *walk = &edges[transfer];
+        if (walk->mode != MODE_WALK) continue;
+
+        int road = -1;
+        for (int k = adjStart[walk->from]; k < adjStart[walk->from + 1] && road < 0; k++) 
+        {
+            const Edge *e = &edges[adjList[k]];
+            if (e->mode == MODE_CAR && e->to != walk->from && e->to != walk->to) road = adjList[k];
+        }
+        if (road < 0) continue;
+
+        // the way back along the same road leads to the transfer
+        int source = edges[road].to;
+        double roadKm = -1.0;
+        for (int k = adjStart[source]; k < adjStart[source + 1]; k++) 
+        {
+            const Edge *e = &edges[adjList[k]];
+            if (e->mode == MODE_CAR && e->to == walk->from) roadKm = e->distance;
+        }
+        if (roadKm < 0.0) continue;
+
+        double budget = (roadKm + walk->distance) / walkSpeed * 60.0 + 1.0;
+        runIsochrone(&space, source, 8 * 60, budget, ISOCHRONE_TRANSIT);
+        tried++;
+        if (!isSettled(&space, walk->to) || space.dist[walk->to] > 8 * 60 + budget) missed++;
+    }
+
+    fprintf(stderr, "Isochrone transfers: %d stops one road walk and a transfer away, %d missed\n", tried, missed);
+
+    freeSearchSpace(&space);
+}
+
+// The metro node a feed stop at lat/lon matches, like the loader does it
+static int metroStop(double lat, double lon) {
+
+    int best = -1;
+    double bestKm = 0.05;
+
+    for (int i = 0; i < numEdges; i++) 
+    {
+        if (edges[i].mode != MODE_METRO) continue;
+
+        int n = edges[i].from;
+        double d = haversineDistance(lat, lon, nodes[n].lat, nodes[n].lon);
+        if (d <= bestKm) 
+        {
+            bestKm = d;
+            best = n;
+        }
+    }
+
+    return best;
+}
+
+// A metro node that is (shapePoint) or is not a named station and has no feed row
+static int metroNodeWithoutRow(const Timetable *t, int shapePoint) {
+
+    for (int i = 0; i < numEdges; i++) 
+    {
+        int n = edges[i].from;
+        if (edges[i].mode == MODE_METRO && t->nodeRow[n] < 0 && isNamedStation(n) != shapePoint) return n;
+    }
+
+    return -1;
+}
+
+// Waits from GTFS-Dhaka-sample against the departures its stop_times.txt lists, on a copy
+// of the graph so the live timetables stay as they are
+static void checkTimetableFeed() {
+
+    Graph sample = *activeGraph;
+    sample.timetables = NULL;
+    loadTimetables(&sample, "GTFS-Dhaka-sample");
+
+    const Timetable *normal = &sample.timetables[TIMETABLE_DEFAULT];
+    const Timetable *late = &sample.timetables[TIMETABLE_PROBLEM6];
+    int cant = metroStop(23.834145, 90.363833);
+    int mir12 = metroStop(23.828335, 90.364255);
+    int purobi = metroStop(23.819055, 90.365345);
+    int station = metroNodeWithoutRow(normal, 0);
+    int shape = metroNodeWithoutRow(normal, 1);
+
+    struct 
+    {
+        const Timetable *t;
+        int node;
+        int now;
+        double wait;
+    } cases[] = {
+        { normal, cant, 6 * 60 + 50, 10 },
+        { normal, cant, 7 * 60, 0 },
+        { normal, cant, 7 * 60 + 1, 20 },          // 7:20:30 leaves at 7:21
+        { normal, cant, 23 * 60, 70 },              // 24:10 is past midnight
+        { normal, cant, 24 * 60 + 11, INF },
+        { normal, mir12, 7 * 60 + 4, 20 },
+        { normal, purobi, 7 * 60 + 6, 0 },
+        { late, mir12, 7 * 60 + 58, 2 },
+        { late, mir12, 8 * 60 + 1, INF },
+        { normal, station, 7 * 60 + 1, 14 },        // not in the feed, the 15 minute headway row
+        { normal, station, 5 * 60, INF },
+        { normal, shape, 7 * 60 + 1, INF },         // the feed times metro, no boarding between stations
+    };
+    int numCases = sizeof(cases) / sizeof(cases[0]);
+    int wrong = 0;
+
+    for (int c = 0; c < numCases; c++) 
+    {
+        double wait = cases[c].node >= 0 ? nextDepartureWait(cases[c].t, cases[c].node, MODE_METRO, cases[c].now) : -1.0;
+        if (wait != cases[c].wait) 
+        {
+            fprintf(stderr, "Timetable case %d: node %d at %d waits %.0f, expected %.0f\n", c, cases[c].node,
+                    cases[c].now, wait, cases[c].wait);
+            wrong++;
+        }
+    }
+
+    // The sample only times metro, so nothing off a metro line may lose its headway row
+    unsigned char *onMetro = calloc(numNodes + 1, 1);
+    for (int i = 0; i < numEdges; i++) 
+    {
+        if (edges[i].mode == MODE_METRO) onMetro[edges[i].from] = 1;
+    }
+
+    int strayShapePoints = 0;
+    for (int i = 0; i < numNodes; i++) 
+    {
+        if (normal->nodeRow[i] == -2 && !onMetro[i]) strayShapePoints++;
+    }
+    free(onMetro);
+
+    fprintf(stderr, "Timetable feed: %d waits checked, %d wrong, %d shape points off the metro lines\n", numCases,
+            wrong, strayShapePoints);
+
+    freeTimetables(&sample);
+}
+
+int main(int argc, char **argv) {
+
+    int perClass = (argc > 1) ? atoi(argv[1]) : 200;
+    rngState = (argc > 2) ? strtoull(argv[2], NULL, 10) : 42;
+    FILE *out = (argc > 3) ? fopen(argv[3], "w") : fdopen(dup(STDOUT_FILENO), "w");
+
+    if (perClass < 1 || rngState == 0 || !out) 
+    {
+        printf("Usage: benchmark [queriesPerClass] [seed] [out.csv]\n");
+        return 1;
+    }
+
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);             // the loaders' status lines, so stdout is nothing but CSV
+    setvbuf(stdout, NULL, _IOLBF, 0);               // in step with the stderr lines
+
+    loadGraph();
+
+    static int path[MAX_NODES];
+    static int pathEdges[MAX_NODES];
+    BenchQuery *queries = malloc(sizeof(BenchQuery) * perClass);
+    double *latencies = malloc(sizeof(double) * perClass);
+    SearchSpace space;
+    initSearchSpace(&space);
+
+    fprintf(out, "problem,class,queries,found,qps,p50_us,p95_us,p99_us,mean_settled,mean_scanned,mean_relaxed,mean_waits,mean_inf_waits,reset_us,search_us,path_us\n");
+
+    for (int cls = 0; cls < NUM_CLASSES; cls++) 
+    {
+        int count = generateQueries(queries, perClass, cls);
+        if (count == 0) continue;
+
+        for (int problem = 1; problem <= 6; problem++) 
+        {
+            QueryStats stats;
+            clearQueryStats(&stats);
+            int found = 0;
+            double total;
+            double startMs = monotonicMs();
+
+            for (int q = 0; q < count; q++) 
+            {
+                double t0 = monotonicMs();
+                int pathLen = solve(problem, &space, &queries[q], path, pathEdges, &total);
+                latencies[q] = (monotonicMs() - t0) * 1000.0;
+
+                addQueryStats(&stats, &space.stats);
+                if (pathLen > 0 && total < INF) found++;
+            }
+
+            double elapsedMs = monotonicMs() - startMs;
+            qsort(latencies, count, sizeof(double), compareDoubles);
+
+            fprintf(out, "%d,%s,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,%.1f,%.2f\n", problem, classNames[cls],
+                    count, found, count / (elapsedMs / 1000.0), percentile(latencies, count, 0.50),
+                    percentile(latencies, count, 0.95), percentile(latencies, count, 0.99),
+                    (double)stats.nodesSettled / count, (double)stats.edgesScanned / count,
+                    (double)stats.edgesRelaxed / count, (double)stats.waitsComputed / count,
+                    (double)stats.infWaitsSkipped / count, stats.phaseMs[PHASE_RESET] * 1000.0 / count,
+                    stats.phaseMs[PHASE_SEARCH] * 1000.0 / count, stats.phaseMs[PHASE_PATH] * 1000.0 / count);
+        }
+    }
+
+    benchmarkSnapping(perClass * NUM_CLASSES);
+    benchmarkTrees(64);
+    benchmarkDeltaStepping(16);
+    benchmarkScheduler(perClass);
+    benchmarkOverlay(perClass);
+    checkIsochroneTransfers(100);
+    checkTimetableFeed();
+
+    fclose(out);
+    freeSearchSpace(&space);
+    free(queries);
+    free(latencies);
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "protocol.h"
+
+// Sends routing requests to a running "main serve" daemon.
+// Usage: client <socket> <problem> <srcLat> <srcLon> <destLat> <destLon> [startMin] [deadlineMin]
+//        client <socket>              (one request per line on stdin)
+
+static int sendRequest(int fd, const char *request) {
+
+    if (writeFrame(fd, request, strlen(request)) != 0) return -1;
+
+    char *response = readFrame(fd, NULL);
+    if (!response) return -1;
+
+    fputs(response, stdout);
+    free(response);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+
+    if (argc < 2 || (argc > 2 && argc < 7)) 
+    {
+        printf("Usage: client <socket> [problem srcLat srcLon destLat destLon [startMin] [deadlineMin]]\n");
+        return 1;
+    }
+
+    int fd = connectUnixSocket(argv[1]);
+    if (fd < 0) 
+    {
+        printf("Could not connect to %s\n", argv[1]);
+        return 1;
+    }
+
+    int status = 0;
+
+    if (argc > 2) 
+    {
+        char request[256] = "";
+        for (int i = 2; i < argc; i++) 
+        {
+            strncat(request, argv[i], sizeof(request) - strlen(request) - 2);
+            strcat(request, " ");
+        }
+        status = sendRequest(fd, request);
+    }
+    else 
+    {
+        char line[256];
+        while (status == 0 && fgets(line, sizeof(line), stdin)) 
+        {
+            line[strcspn(line, "\n")] = 0;
+            if (line[0] == '\0') continue;
+            status = sendRequest(fd, line);
+        }
+    }
+
+    close(fd);
+
+    if (status != 0) printf("Connection to %s lost\n", argv[1]);
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "protocol.h"
+
+// Closed-loop load generator for "main serve": every connection sends its next request
+// as soon as the previous answer arrives. Points are drawn uniformly from central Dhaka.
+// Usage: loadgen <socket> [connections] [requestsPerConnection] [seed] [problem]
+// problem 0 (default) mixes all six.
+
+#define MIN_LAT 23.72
+#define MAX_LAT 23.88
+#define MIN_LON 90.34
+#define MAX_LON 90.44
+
+typedef struct 
+{
+    const char *socketPath;
+    int requests;
+    int problem;
+    unsigned long long rng;
+    double *latencies;          // microseconds
+    int ok;
+    int noPath;
+    int failed;
+    int answered;
+} LoadWorker;
+
+static double nowMs() {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static unsigned long long nextRandom(unsigned long long *state) {          // xorshift64*
+
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static double randomUnit(unsigned long long *state) {
+
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void *loadWorker(void *arg) {
+
+    LoadWorker *w = (LoadWorker *)arg;
+    int fd = connectUnixSocket(w->socketPath);
+
+    for (int i = 0; i < w->requests; i++) 
+    {
+        if (fd < 0) 
+        {
+            w->failed += w->requests - i;
+            break;
+        }
+
+        int problem = w->problem ? w->problem : 1 + (int)(nextRandom(&w->rng) % 6);
+        int startMin = 6 * 60 + (int)(nextRandom(&w->rng) % (15 * 60));
+        int deadlineMin = startMin + 60 + (int)(nextRandom(&w->rng) % 121);
+        char request[160];
+
+        snprintf(request, sizeof(request), "%d %.6f %.6f %.6f %.6f %d %d", problem,
+                 MIN_LAT + randomUnit(&w->rng) * (MAX_LAT - MIN_LAT), MIN_LON + randomUnit(&w->rng) * (MAX_LON - MIN_LON),
+                 MIN_LAT + randomUnit(&w->rng) * (MAX_LAT - MIN_LAT), MIN_LON + randomUnit(&w->rng) * (MAX_LON - MIN_LON),
+                 startMin, deadlineMin);
+
+        double t0 = nowMs();
+        char *response = (writeFrame(fd, request, strlen(request)) == 0) ? readFrame(fd, NULL) : NULL;
+
+        if (!response) 
+        {
+            w->failed += w->requests - i;
+            break;
+        }
+
+        w->latencies[w->answered++] = (nowMs() - t0) * 1000.0;
+
+        if (strncmp(response, "OK", 2) == 0) w->ok++;
+        else if (strncmp(response, "NOPATH", 6) == 0) w->noPath++;
+        else w->failed++;
+
+        free(response);
+    }
+
+    if (fd >= 0) close(fd);
+    return NULL;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+
+    if (argc < 2) 
+    {
+        printf("Usage: loadgen <socket> [connections] [requestsPerConnection] [seed] [problem]\n");
+        return 1;
+    }
+
+    int connections = (argc > 2) ? atoi(argv[2]) : 4;
+    int perConnection = (argc > 3) ? atoi(argv[3]) : 250;
+    unsigned long long seed = (argc > 4) ? strtoull(argv[4], NULL, 10) : 42;
+    int problem = (argc > 5) ? atoi(argv[5]) : 0;
+
+    if (connections < 1 || perConnection < 1 || seed == 0 || problem < 0 || problem > 6) 
+    {
+        printf("Usage: loadgen <socket> [connections] [requestsPerConnection] [seed] [problem]\n");
+        return 1;
+    }
+
+    LoadWorker *workers = calloc(connections, sizeof(LoadWorker));
+    pthread_t *threads = malloc(sizeof(pthread_t) * connections);
+    double *latencies = malloc(sizeof(double) * connections * perConnection);
+
+    for (int c = 0; c < connections; c++) 
+    {
+        workers[c].socketPath = argv[1];
+        workers[c].requests = perConnection;
+        workers[c].problem = problem;
+        workers[c].rng = seed + c * 7919ULL;
+        workers[c].latencies = latencies + (size_t)c * perConnection;
+    }
+
+    double startMs = nowMs();
+    for (int c = 0; c < connections; c++) pthread_create(&threads[c], NULL, loadWorker, &workers[c]);
+    for (int c = 0; c < connections; c++) pthread_join(threads[c], NULL);
+    double elapsedMs = nowMs() - startMs;
+
+    int ok = 0, noPath = 0, failed = 0, answered = 0;
+    for (int c = 0; c < connections; c++) 
+    {
+        ok += workers[c].ok;
+        noPath += workers[c].noPath;
+        failed += workers[c].failed;
+
+        for (int i = 0; i < workers[c].answered; i++) latencies[answered++] = workers[c].latencies[i];
+    }
+
+    printf("%d connections, %d requests in %.1f ms: %d ok, %d no path, %d failed\n",
+           connections, connections * perConnection, elapsedMs, ok, noPath, failed);
+
+    if (answered > 0) 
+    {
+        qsort(latencies, answered, sizeof(double), compareDoubles);
+        printf("QPS %.1f, latency us p50 %.1f, p95 %.1f, p99 %.1f, max %.1f\n", answered / (elapsedMs / 1000.0),
+               latencies[(int)(0.50 * (answered - 1))], latencies[(int)(0.95 * (answered - 1))],
+               latencies[(int)(0.99 * (answered - 1))], latencies[answered - 1]);
+    }
+
+    free(workers);
+    free(threads);
+    free(latencies);
+    return failed == 0 ? 0 : 1;
+}
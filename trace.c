@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "timeHandling.h"
+#include "trace.h"
+
+#define TRACE_NAME_LEN 32
+
+typedef struct 
+{
+    char name[TRACE_NAME_LEN];
+    const char *category;           // always a string literal
+    char phase;                     // 'B' or 'E'
+    int tid;
+    double ts;                      // microseconds since traceInit
+} TraceEvent;
+
+int traceEnabled = 0;
+
+static TraceEvent *events = NULL;
+static int numEvents = 0;
+static int eventCapacity = 0;
+static char tracePath[512];
+static double traceStartMs = 0;
+static int nextTid = 0;
+static __thread int threadTid = -1;
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+
+void traceInit() {
+
+    const char *env = getenv("ROUTE_TRACE");
+    if (!env || !*env || traceEnabled) return;
+
+    snprintf(tracePath, sizeof(tracePath), "%s", env);
+    traceStartMs = monotonicMs();
+    traceEnabled = 1;
+    atexit(traceFlush);
+}
+
+void traceEvent(const char *name, const char *category, char phase) {
+
+    double ts = (monotonicMs() - traceStartMs) * 1000.0;
+
+    if (threadTid < 0) threadTid = __atomic_fetch_add(&nextTid, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&traceLock);
+
+    if (numEvents == eventCapacity) 
+    {
+        int newCapacity = eventCapacity ? eventCapacity * 2 : 4096;
+        TraceEvent *grown = realloc(events, sizeof(TraceEvent) * newCapacity);
+
+        if (!grown)                 // out of memory, drop the event rather than the run
+        {
+            pthread_mutex_unlock(&traceLock);
+            return;
+        }
+
+        events = grown;
+        eventCapacity = newCapacity;
+    }
+
+    TraceEvent *e = &events[numEvents++];
+    snprintf(e->name, TRACE_NAME_LEN, "%s", name);
+    e->category = category;
+    e->phase = phase;
+    e->tid = threadTid;
+    e->ts = ts;
+
+    pthread_mutex_unlock(&traceLock);
+}
+
+// Runs from atexit, so also after the menu quits or a batch command returns
+void traceFlush() {
+
+    if (!traceEnabled) return;
+
+    pthread_mutex_lock(&traceLock);
+
+    FILE *f = fopen(tracePath, "w");
+    if (!f) 
+    {
+        printf("Failed to open %s\n", tracePath);
+    }
+    else 
+    {
+        fprintf(f, "{\"traceEvents\":[\n");
+        for (int i = 0; i < numEvents; i++) 
+        {
+            fprintf(f, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}%s\n",
+                    events[i].name, events[i].category, events[i].phase, events[i].tid, events[i].ts,
+                    i + 1 < numEvents ? "," : "");
+        }
+        fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+        fclose(f);
+        printf("Trace: wrote %d events to %s\n", numEvents, tracePath);
+    }
+
+    free(events);
+    events = NULL;
+    numEvents = eventCapacity = 0;
+    traceEnabled = 0;
+
+    pthread_mutex_unlock(&traceLock);
+}
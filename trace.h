@@ -0,0 +1,26 @@
+#ifndef trace_H
+#define trace_H
+
+// Chrome trace-event output (chrome://tracing, Perfetto). Set ROUTE_TRACE=file.json
+// and begin/end spans are kept in memory, then written once at exit.
+// Compiled out together with the counters by -DNO_INSTRUMENT.
+
+void traceInit();
+void traceEvent(const char *name, const char *category, char phase);
+void traceFlush();
+
+extern int traceEnabled;
+
+#ifndef NO_INSTRUMENT
+
+#define TRACE_BEGIN(name, category) do { if (traceEnabled) traceEvent(name, category, 'B'); } while (0)
+#define TRACE_END(name, category) do { if (traceEnabled) traceEvent(name, category, 'E'); } while (0)
+
+#else
+
+#define TRACE_BEGIN(name, category) ((void)0)
+#define TRACE_END(name, category) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,493 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "csvParse.h"
+#include "timeHandling.h"
+#include "graphLoad.h"
+#include "traffic.h"
+
+#define POINT_HASH_SIZE (1 << 18)
+#define MAX_TRAFFIC_BATCH 4096
+
+// Polyline points of every non-walk edge, hashed by coordinate so an update can find the
+// edge a segment belongs to, including segments folded into a contracted chain.
+// One per graph version, built the first time that version gets an update.
+typedef struct PointIndex 
+{
+    int *head;
+    int *next;
+    int *edge;
+    int *position;          // 0 is the from node, shapeCount + 1 the to node
+    int count;
+} PointIndex;
+
+static TrafficSnapshot *retired = NULL;
+static TrafficUpdate *liveUpdates = NULL;       // everything still in force, replayed onto new graphs
+static int numLiveUpdates = 0;
+static int liveCapacity = 0;
+static pthread_mutex_t snapshotLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t updateLock = PTHREAD_MUTEX_INITIALIZER;
+
+static TrafficSnapshot *newSnapshot(const TrafficSnapshot *from) {
+
+    TrafficSnapshot *s = calloc(1, sizeof(TrafficSnapshot));
+    s->numEdges = numEdges;
+    s->factor = malloc(sizeof(float) * (numEdges + 1));
+
+    if (from) 
+    {
+        memcpy(s->factor, from->factor, sizeof(float) * numEdges);
+        s->version = from->version + 1;
+        s->numClosed = from->numClosed;
+    }
+    else 
+    {
+        for (int i = 0; i < numEdges; i++) s->factor[i] = 1.0f;
+    }
+
+    return s;
+}
+
+static void freeSnapshot(TrafficSnapshot *s) {
+
+    free(s->factor);
+    free(s);
+}
+
+// Caller holds snapshotLock
+static void reclaimRetired() {
+
+    TrafficSnapshot **link = &retired;
+
+    while (*link) 
+    {
+        TrafficSnapshot *s = *link;
+        if (s->refs == 0) 
+        {
+            *link = s->retiredNext;
+            freeSnapshot(s);
+        }
+        else 
+        {
+            link = &s->retiredNext;
+        }
+    }
+}
+
+// Caller holds snapshotLock
+static void retireSnapshot(TrafficSnapshot *s) {
+
+    if (!s) return;
+
+    s->retiredNext = retired;
+    retired = s;
+    reclaimRetired();
+}
+
+static void publishSnapshot(Graph *g, TrafficSnapshot *s) {
+
+    pthread_mutex_lock(&snapshotLock);
+
+    TrafficSnapshot *old = g->traffic;
+    g->traffic = s;
+    retireSnapshot(old);
+
+    pthread_mutex_unlock(&snapshotLock);
+}
+
+static unsigned pointHash(long long qLat, long long qLon) {
+
+    unsigned long long h = (unsigned long long)qLat * 73856093ULL ^ (unsigned long long)qLon * 19349663ULL;
+    return (unsigned)(h % POINT_HASH_SIZE);
+}
+
+static void edgePoint(int edgeIdx, int position, double *lat, double *lon) {
+
+    const Edge *e = &edges[edgeIdx];
+
+    if (position == 0) 
+    {
+        *lat = nodes[e->from].lat;
+        *lon = nodes[e->from].lon;
+    }
+    else if (position > e->shapeCount) 
+    {
+        *lat = nodes[e->to].lat;
+        *lon = nodes[e->to].lon;
+    }
+    else 
+    {
+        *lat = shapePoints[e->shapeStart + position - 1].lat;
+        *lon = shapePoints[e->shapeStart + position - 1].lon;
+    }
+}
+
+static PointIndex *buildPointIndex() {
+
+    PointIndex *idx = calloc(1, sizeof(PointIndex));
+    int total = 0;
+
+    for (int i = 0; i < numEdges; i++) if (edges[i].mode != MODE_WALK) total += edges[i].shapeCount + 2;
+
+    idx->head = malloc(sizeof(int) * POINT_HASH_SIZE);
+    idx->next = malloc(sizeof(int) * (total + 1));
+    idx->edge = malloc(sizeof(int) * (total + 1));
+    idx->position = malloc(sizeof(int) * (total + 1));
+    for (int b = 0; b < POINT_HASH_SIZE; b++) idx->head[b] = -1;
+
+    for (int i = 0; i < numEdges; i++) 
+    {
+        if (edges[i].mode == MODE_WALK) continue;
+
+        for (int p = 0; p <= edges[i].shapeCount + 1; p++) 
+        {
+            double lat, lon;
+            edgePoint(i, p, &lat, &lon);
+
+            unsigned b = pointHash(llround(lat / TRAFFIC_MATCH_DEG), llround(lon / TRAFFIC_MATCH_DEG));
+            int k = idx->count++;
+            idx->edge[k] = i;
+            idx->position[k] = p;
+            idx->next[k] = idx->head[b];
+            idx->head[b] = k;
+        }
+    }
+
+    return idx;
+}
+
+static void freePointIndex(PointIndex *idx) {
+
+    if (!idx) return;
+
+    free(idx->head);
+    free(idx->next);
+    free(idx->edge);
+    free(idx->position);
+    free(idx);
+}
+
+static int samePoint(double lat1, double lon1, double lat2, double lon2) {
+
+    return fabs(lat1 - lat2) < TRAFFIC_MATCH_DEG && fabs(lon1 - lon2) < TRAFFIC_MATCH_DEG;
+}
+
+// Collects every edge holding the segment from -> to, either as one step of its polyline
+// or end to end; a contracted chain takes the factor as a whole. mark[] stops an edge
+// from being listed twice for the same update.
+static int matchSegment(const PointIndex *idx, const TrafficUpdate *u, int stamp, int *mark, int out[], int maxOut) {
+
+    long long qLat = llround(u->fromLat / TRAFFIC_MATCH_DEG);
+    long long qLon = llround(u->fromLon / TRAFFIC_MATCH_DEG);
+    int matched = 0;
+
+    for (long long dLat = -1; dLat <= 1; dLat++) 
+    {
+        for (long long dLon = -1; dLon <= 1; dLon++) 
+        {
+            for (int k = idx->head[pointHash(qLat + dLat, qLon + dLon)]; k != -1; k = idx->next[k]) 
+            {
+                int e = idx->edge[k];
+                int p = idx->position[k];
+                double lat, lon, nextLat, nextLon;
+
+                if (mark[e] == stamp || p > edges[e].shapeCount) continue;
+
+                edgePoint(e, p, &lat, &lon);
+                if (!samePoint(lat, lon, u->fromLat, u->fromLon)) continue;
+
+                edgePoint(e, p + 1, &nextLat, &nextLon);
+                edgePoint(e, edges[e].shapeCount + 1, &lat, &lon);
+
+                if ((samePoint(nextLat, nextLon, u->toLat, u->toLon) || (p == 0 && samePoint(lat, lon, u->toLat, u->toLon)))
+                    && matched < maxOut) 
+                {
+                    mark[e] = stamp;
+                    out[matched++] = e;
+                }
+            }
+        }
+    }
+
+    return matched;
+}
+
+// Patches s in place for the graph the views point at; later updates win. Caller holds updateLock.
+static int patchSnapshot(Graph *g, TrafficSnapshot *s, const TrafficUpdate updates[], int count) {
+
+    if (count == 0) return 0;
+    if (!g->trafficIndex) g->trafficIndex = buildPointIndex();
+
+    int *mark = calloc(numEdges + 1, sizeof(int));
+    int matched[64];
+    int patched = 0;
+
+    for (int u = 0; u < count; u++) 
+    {
+        int n = matchSegment(g->trafficIndex, &updates[u], u + 1, mark, matched, 64);
+        for (int i = 0; i < n; i++) 
+        {
+            s->numClosed += (updates[u].factor <= 0.0f) - (s->factor[matched[i]] <= 0.0f);
+            s->factor[matched[i]] = updates[u].factor;
+        }
+        patched += n;
+    }
+
+    free(mark);
+    return patched;
+}
+
+// The first reader of a new graph version replays the live updates onto it. Caller holds updateLock.
+static void ensureTraffic(Graph *g) {
+
+    if (g->traffic) return;
+
+    TrafficSnapshot *s = newSnapshot(NULL);
+    patchSnapshot(g, s, liveUpdates, numLiveUpdates);
+    publishSnapshot(g, s);
+}
+
+// Keeps one entry per segment so a reload replays only what is still in force
+static void recordLiveUpdate(const TrafficUpdate *u) {
+
+    for (int i = 0; i < numLiveUpdates; i++) 
+    {
+        TrafficUpdate *l = &liveUpdates[i];
+        if (!samePoint(l->fromLat, l->fromLon, u->fromLat, u->fromLon) || !samePoint(l->toLat, l->toLon, u->toLat, u->toLon)) continue;
+
+        if (u->factor == 1.0f) *l = liveUpdates[--numLiveUpdates];
+        else l->factor = u->factor;
+        return;
+    }
+
+    if (u->factor == 1.0f) return;
+
+    if (numLiveUpdates == liveCapacity) 
+    {
+        liveCapacity = liveCapacity ? liveCapacity * 2 : 64;
+        liveUpdates = realloc(liveUpdates, sizeof(TrafficUpdate) * liveCapacity);
+    }
+    liveUpdates[numLiveUpdates++] = *u;
+}
+
+// Current live weights of the graph this thread has pinned
+TrafficSnapshot *acquireTraffic() {
+
+    Graph *g = activeGraph;
+
+    if (!__atomic_load_n(&g->traffic, __ATOMIC_ACQUIRE)) 
+    {
+        pthread_mutex_lock(&updateLock);
+        ensureTraffic(g);
+        pthread_mutex_unlock(&updateLock);
+    }
+
+    pthread_mutex_lock(&snapshotLock);
+    TrafficSnapshot *s = g->traffic;
+    s->refs++;
+    pthread_mutex_unlock(&snapshotLock);
+
+    return s;
+}
+
+void releaseTraffic(TrafficSnapshot *snapshot) {
+
+    if (!snapshot) return;
+
+    pthread_mutex_lock(&snapshotLock);
+    snapshot->refs--;
+    if (snapshot->refs == 0) reclaimRetired();      // only retired snapshots are ever freed
+    pthread_mutex_unlock(&snapshotLock);
+}
+
+// Called when a graph version is freed; searches may still hold its last snapshot
+void releaseGraphTraffic(Graph *g) {
+
+    pthread_mutex_lock(&snapshotLock);
+    retireSnapshot(g->traffic);
+    g->traffic = NULL;
+    pthread_mutex_unlock(&snapshotLock);
+
+    freePointIndex(g->trafficIndex);
+    g->trafficIndex = NULL;
+}
+
+// Applies a batch to the newest graph as one new snapshot. A caller that holds a version
+// is left pinned to the newest one; one that held none (the watcher) holds none after,
+// so an idle thread never keeps a retired version alive. Returns the number of edges patched.
+int applyTrafficUpdates(const TrafficUpdate updates[], int count, double *elapsedMs) {
+
+    double startMs = monotonicMs();
+    int hadPin = isGraphPinned();
+    Graph *g = pinGraph(NULL);
+
+    pthread_mutex_lock(&updateLock);
+
+    ensureTraffic(g);
+    TrafficSnapshot *next = newSnapshot(g->traffic);
+    int patched = patchSnapshot(g, next, updates, count);
+    for (int u = 0; u < count; u++) recordLiveUpdate(&updates[u]);
+
+    publishSnapshot(g, next);
+    __atomic_fetch_add(&graphVersion, 1, __ATOMIC_RELEASE);        // cached routes were priced on the old weights
+
+    pthread_mutex_unlock(&updateLock);
+
+    if (!hadPin) unpinGraph();
+    if (elapsedMs) *elapsedMs = monotonicMs() - startMs;
+    return patched;
+}
+
+// Makes updates the whole live state: a snapshot rebuilt from the base weights, so a
+// segment that is no longer listed is open again. It is published only when some edge
+// differs from the current snapshot. Pins like applyTrafficUpdates. Returns the edges
+// patched, *changed the edges that differ.
+int replaceTrafficState(const TrafficUpdate updates[], int count, int *changed, double *elapsedMs) {
+
+    double startMs = monotonicMs();
+    int hadPin = isGraphPinned();
+    Graph *g = pinGraph(NULL);
+
+    pthread_mutex_lock(&updateLock);
+
+    ensureTraffic(g);
+    TrafficSnapshot *next = newSnapshot(NULL);
+    next->version = g->traffic->version + 1;
+    int patched = patchSnapshot(g, next, updates, count);
+
+    int differ = 0;
+    for (int i = 0; i < numEdges; i++) differ += next->factor[i] != g->traffic->factor[i];
+
+    numLiveUpdates = 0;
+    for (int u = 0; u < count; u++) recordLiveUpdate(&updates[u]);
+
+    if (differ > 0) 
+    {
+        publishSnapshot(g, next);
+        __atomic_fetch_add(&graphVersion, 1, __ATOMIC_RELEASE);
+    }
+    else 
+    {
+        freeSnapshot(next);             // never published, cached routes stay good
+    }
+
+    pthread_mutex_unlock(&updateLock);
+
+    if (changed) *changed = differ;
+    if (!hadPin) unpinGraph();
+    if (elapsedMs) *elapsedMs = monotonicMs() - startMs;
+    return patched;
+}
+
+// The whole live state, one segment per line: fromLat,fromLon,toLat,toLon,<factor|closed|open>
+// A line covers the from -> to direction only, like the edges it matches; a road closed both
+// ways needs a second line with the ends swapped. Segments not listed run at their base
+// weights, so deleting a line reopens it. TRAFFIC commands to the server patch this state
+// until the file changes again.
+int applyTrafficFile(const char *filename) {
+
+    FILE *f = fopen(filename, "r");
+    if (!f) 
+    {
+        printf("Error opening %s\n", filename);
+        return -1;
+    }
+
+    TrafficUpdate *updates = malloc(sizeof(TrafficUpdate) * MAX_TRAFFIC_BATCH);
+    char line[256];
+    char *tokens[8];
+    int count = 0;
+
+    while (count < MAX_TRAFFIC_BATCH && fgets(line, sizeof(line), f)) 
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '#' || line[0] == '\0') continue;
+        if (split_csv(line, tokens, 8) != 5) continue;
+
+        TrafficUpdate *u = &updates[count];
+        u->fromLat = atof(tokens[0]);
+        u->fromLon = atof(tokens[1]);
+        u->toLat = atof(tokens[2]);
+        u->toLon = atof(tokens[3]);
+
+        if (strcmp(tokens[4], "closed") == 0) u->factor = 0.0f;
+        else if (strcmp(tokens[4], "open") == 0) u->factor = 1.0f;
+        else if (is_number_token(tokens[4]) && atof(tokens[4]) > 0) u->factor = (float)atof(tokens[4]);
+        else continue;
+
+        count++;
+    }
+
+    fclose(f);
+
+    double elapsedMs;
+    int changed;
+    int patched = replaceTrafficState(updates, count, &changed, &elapsedMs);
+    printf("Traffic: %d segments from %s cover %d edges, %d changed, in %.2f ms\n", count, filename, patched, changed,
+           elapsedMs);
+
+    free(updates);
+    return patched;
+}
+
+typedef struct 
+{
+    char filename[512];
+    int intervalMs;
+    time_t lastMtime;
+    off_t lastSize;
+} TrafficWatch;
+
+static void checkTrafficFile(TrafficWatch *watch) {
+
+    struct stat st;
+
+    if (stat(watch->filename, &st) != 0) return;
+    if (st.st_mtime == watch->lastMtime && st.st_size == watch->lastSize) return;
+
+    watch->lastMtime = st.st_mtime;
+    watch->lastSize = st.st_size;
+    applyTrafficFile(watch->filename);
+    fflush(stdout);
+}
+
+static void *trafficWatcher(void *arg) {
+
+    TrafficWatch *watch = (TrafficWatch *)arg;
+
+    while (1) 
+    {
+        usleep(watch->intervalMs * 1000);
+        checkTrafficFile(watch);
+    }
+
+    return NULL;
+}
+
+// Applies the file once up front, then polls it and rebuilds the live state from it whenever
+// its mtime or size changes. stat() keeps this portable, and a one second poll is well inside any feed period.
+int startTrafficWatcher(const char *filename, int intervalMs) {
+
+    TrafficWatch *watch = calloc(1, sizeof(TrafficWatch));
+    snprintf(watch->filename, sizeof(watch->filename), "%s", filename);
+    watch->intervalMs = intervalMs > 0 ? intervalMs : 1000;
+    watch->lastSize = -1;
+
+    checkTrafficFile(watch);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, trafficWatcher, watch) != 0) 
+    {
+        free(watch);
+        return -1;
+    }
+
+    pthread_detach(thread);
+    return 0;
+}
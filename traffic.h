@@ -0,0 +1,50 @@
+#ifndef traffic_H
+#define traffic_H
+
+// Live traffic: a per-edge speed factor on top of the speed profiles, 0 meaning closed.
+// Updates copy the current factors, patch the copy and publish it, so a search keeps
+// the snapshot it started with. A traffic file replaces the whole state instead. Old snapshots are freed once the last search lets go.
+// Each graph version has its own snapshots; updates still in force carry over on reload.
+
+#include "nodesAndEdges.h"
+
+#define TRAFFIC_MATCH_DEG 0.0001        // same tolerance the parsers join coordinates with
+
+typedef struct TrafficSnapshot 
+{
+    float *factor;
+    int numEdges;
+    int numClosed;          // edges with factor 0, so searches that cannot honour closures know to fall back
+    int version;
+    int refs;
+    struct TrafficSnapshot *retiredNext;
+} TrafficSnapshot;
+
+typedef struct 
+{
+    double fromLat;
+    double fromLon;
+    double toLat;
+    double toLon;
+    float factor;           // speed multiplier, 0 closes the segment, 1 restores it; from -> to only
+} TrafficUpdate;
+
+TrafficSnapshot *acquireTraffic();
+void releaseTraffic(TrafficSnapshot *snapshot);
+void releaseGraphTraffic(Graph *g);
+int applyTrafficUpdates(const TrafficUpdate updates[], int count, double *elapsedMs);
+int replaceTrafficState(const TrafficUpdate updates[], int count, int *changed, double *elapsedMs);
+int applyTrafficFile(const char *filename);
+int startTrafficWatcher(const char *filename, int intervalMs);
+
+static inline int isEdgeClosed(const TrafficSnapshot *t, int edgeIdx) {
+
+    return t->factor[edgeIdx] <= 0.0f;
+}
+
+static inline double trafficFactor(const TrafficSnapshot *t, int edgeIdx) {
+
+    return t->factor[edgeIdx];
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "mode.h"
+#include "nodesAndEdges.h"
+#include "spatialGrid.h"
+#include "timeHandling.h"
+#include "walkTransfers.h"
+
+#define MAX_WALK_CANDIDATES 4096
+
+// Links every transit stop to the road and transit nodes within MAX_WALK_DISTANCE_KM.
+// Stops are the named stations, the nodes in between are only shape points shared with roads.
+int buildWalkTransfers() {
+
+    double startMs = monotonicMs();
+
+    char *hasCar = calloc(numNodes + 1, 1);
+    char *stopFlag = calloc(numNodes + 1, 1);
+    unsigned char *transitModes = calloc(numNodes + 1, 1);          // bit per mode carried by the node
+
+    for (int i = 0; i < numEdges; i++) 
+    {
+        if (edges[i].mode == MODE_CAR) 
+        {
+            hasCar[edges[i].from] = 1;
+        }
+        else if (edges[i].mode != MODE_WALK) 
+        {
+            transitModes[edges[i].from] |= 1 << edges[i].mode;
+            if (isNamedStation(edges[i].from)) stopFlag[edges[i].from] = 1;
+        }
+    }
+
+    SpatialGrid grid;
+    buildNodeGrid(&grid, MAX_WALK_DISTANCE_KM);
+
+    int candidates[MAX_WALK_CANDIDATES];
+    int added = 0;
+    int baseEdges = numEdges;
+
+    for (int s = 0; s < numNodes; s++) 
+    {
+        if (!stopFlag[s]) continue;
+
+        int found = queryGridRadius(&grid, nodes[s].lat, nodes[s].lon, MAX_WALK_DISTANCE_KM, 
+                                    candidates, MAX_WALK_CANDIDATES);
+        if (found > MAX_WALK_CANDIDATES) found = MAX_WALK_CANDIDATES;
+
+        for (int k = 0; k < found; k++) 
+        {
+            int n = candidates[k];
+
+            if (n == s || (!hasCar[n] && !stopFlag[n])) continue;
+            if (transitModes[n] & transitModes[s]) continue;            // same line, the ride itself covers it
+            if (stopFlag[n] && n < s) continue;               // stop pairs are found from both sides
+
+            if (numEdges + 2 > MAX_NODES * 10) break;
+
+            double d = haversineDistance(nodes[s].lat, nodes[s].lon, nodes[n].lat, nodes[n].lon);
+            addEdge(s, n, MODE_WALK, d);
+            addEdge(n, s, MODE_WALK, d);
+            added += 2;
+        }
+    }
+
+    freeSpatialGrid(&grid);
+    free(hasCar);
+    free(stopFlag);
+    free(transitModes);
+
+    printf("Walk transfers: added %d edges (%d -> %d) in %.1f ms\n", added, baseEdges, numEdges, monotonicMs() - startMs);
+
+    return added;
+}
+
+// Walk edges are transfers, not free travel: they can start a trip or follow any ride, so a
+// route may drive up to a station and walk in, but two walks never chain into a free hike.
+// Only walk edges are gated, so every route that was possible without them still is.
+int isWalkTransferAllowed(int arrivalEdge, int edgeIdx) {
+
+    if (edges[edgeIdx].mode != MODE_WALK) return 1;
+    if (arrivalEdge < 0) return 1;              // leaving the start point on foot
+
+    Mode arrival = edges[arrivalEdge].mode;
+
+    return arrival != MODE_WALK;
+}
\ No newline at end of file
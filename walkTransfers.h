@@ -0,0 +1,7 @@
+#ifndef walkTransfers_H
+#define walkTransfers_H
+
+int buildWalkTransfers();
+int isWalkTransferAllowed(int arrivalEdge, int edgeIdx);
+
+#endif